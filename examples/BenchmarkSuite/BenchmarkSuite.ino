@@ -0,0 +1,348 @@
+/**
+ * @file BenchmarkSuite.ino
+ * @brief Example: Micro-benchmarks for the parse and URL building paths
+ *
+ * This example runs every response parser (parseCurrentWeather(),
+ * parseForecast(), parseAirPollutionList(), parseGeoLocations()) over
+ * recorded responses of several sizes, with both the ArduinoJson and the
+ * SAX parser, followed by the request path builders. For each case it
+ * prints:
+ * - ns/op: time per call, from a run of at least MIN_RUN_TIME_US
+ * - doc: most memory held by the JsonDocument during the call
+ * - heap: most heap in use during the call, above the level before it
+ * - stack: deepest stack use from the parse*() method down
+ *
+ * The memory columns come from one extra call with setMemoryStats()
+ * enabled, i.e. what the library itself measured inside that call
+ * (see getLastMemoryStats()). The heap is sampled at each JsonDocument
+ * allocation, so "heap" is a lower bound. The timed runs have the
+ * statistics off. The path builders do not use the heap, and their
+ * memory is not measured.
+ *
+ * The UNO R4 WiFi has 32 KB of SRAM, so the 40-item forecast (a 17 KB
+ * response plus its JsonDocument) and the 120-item air pollution list
+ * are left out there.
+ *
+ * Run it before and after a change on the same board to see whether the
+ * hot path got faster or slower. No WiFi connection or API key is
+ * required.
+ *
+ * Supported boards:
+ * - Arduino UNO R4 WiFi
+ * - ESP32 series
+ */
+
+#include <OpenWeatherMap.h>
+
+// Shortest measured run per case (microseconds)
+const unsigned long MIN_RUN_TIME_US = 200000;
+
+#if defined(ARDUINO_UNOWIFIR4)
+    #define LARGE_CASES 0
+    #define MAX_AIR_POLLUTION_ITEMS 24
+#else
+    #define LARGE_CASES 1
+    #define MAX_AIR_POLLUTION_ITEMS 120     // 5 days of hourly history
+#endif
+
+// Recorded /data/2.5/weather response
+const char CURRENT_WEATHER_JSON[] =
+    "{\"coord\":{\"lon\":121.4737,\"lat\":31.2304},"
+    "\"weather\":[{\"id\":803,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04d\"}],"
+    "\"base\":\"stations\","
+    "\"main\":{\"temp\":22.92,\"feels_like\":22.84,\"temp_min\":21.93,\"temp_max\":23.94,"
+    "\"pressure\":1016,\"humidity\":66,\"sea_level\":1016,\"grnd_level\":1015},"
+    "\"visibility\":10000,\"wind\":{\"speed\":5,\"deg\":110,\"gust\":7.2},"
+    "\"clouds\":{\"all\":75},\"dt\":1760592000,"
+    "\"sys\":{\"type\":2,\"id\":2002123,\"country\":\"CN\",\"sunrise\":1760566180,\"sunset\":1760607828},"
+    "\"timezone\":28800,\"id\":1796236,\"name\":\"Shanghai\",\"cod\":200}";
+
+// One /data/2.5/forecast list item; repeated to build a full response
+const char FORECAST_ITEM_JSON[] =
+    "{\"dt\":1760594400,\"main\":{\"temp\":23.1,\"feels_like\":23.05,\"temp_min\":22.4,"
+    "\"temp_max\":23.1,\"pressure\":1016,\"sea_level\":1016,\"grnd_level\":1015,"
+    "\"humidity\":65,\"temp_kf\":0.7},"
+    "\"weather\":[{\"id\":500,\"main\":\"Rain\",\"description\":\"light rain\",\"icon\":\"10d\"}],"
+    "\"clouds\":{\"all\":86},\"wind\":{\"speed\":5.32,\"deg\":104,\"gust\":7.01},"
+    "\"visibility\":10000,\"pop\":0.36,\"rain\":{\"3h\":0.28},\"sys\":{\"pod\":\"d\"},"
+    "\"dt_txt\":\"2025-10-16 06:00:00\"}";
+
+const char FORECAST_CITY_JSON[] =
+    "\"city\":{\"id\":1796236,\"name\":\"Shanghai\",\"coord\":{\"lat\":31.2304,\"lon\":121.4737},"
+    "\"country\":\"CN\",\"population\":22315474,\"timezone\":28800,"
+    "\"sunrise\":1760566180,\"sunset\":1760607828}";
+
+// One /data/2.5/air_pollution list item
+const char AIR_POLLUTION_ITEM_JSON[] =
+    "{\"main\":{\"aqi\":2},\"components\":{\"co\":216.96,\"no\":0,\"no2\":5.83,\"o3\":78.68,"
+    "\"so2\":2.71,\"pm2_5\":11.57,\"pm10\":15.3,\"nh3\":1.44},\"dt\":1760594400}";
+
+// One /geo/1.0/direct result
+const char GEO_LOCATION_JSON[] =
+    "{\"name\":\"London\",\"local_names\":{\"en\":\"London\",\"fr\":\"Londres\","
+    "\"de\":\"London\",\"es\":\"Londres\",\"ru\":\"Лондон\",\"zh\":\"伦敦\",\"ja\":\"ロンドン\"},"
+    "\"lat\":51.5073219,\"lon\":-0.1276474,\"country\":\"GB\",\"state\":\"England\"}";
+
+OpenWeatherMap weather;
+
+// Results are static to keep them off the stack
+OWM_CurrentWeather currentWeather;
+OWM_Forecast forecast;
+OWM_AirPollution pollution[MAX_AIR_POLLUTION_ITEMS];
+OWM_GeoLocation locations[OWM_MAX_GEO_RESULTS];
+
+// Input of the group path builder, allocated once the parse cases are done
+OWM_GeoLocation* cities = NULL;
+
+// Response being parsed by the current case
+String response;
+
+// Output of the path builders
+char path[384];
+
+// One benchmarked operation; returns false if it failed
+typedef bool (*BenchmarkFunction)();
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+        delay(100);
+    }
+
+    Serial.println();
+    Serial.println("OpenWeatherMap - Benchmark Suite");
+    Serial.println("================================");
+
+    // No network access is needed; the key is only stored
+    weather.begin("0123456789abcdef0123456789abcdef");
+    weather.setUnits(OWM_UNITS_METRIC);
+    weather.setLanguage("zh_cn");
+
+    printHeader("Response");
+
+    // Each response is built straight into the global String, so only
+    // one copy is in memory at a time
+    response = buildCurrentWeather();
+    benchmarkParsers("weather", OWM_ENDPOINT_CURRENT_WEATHER, runCurrentWeather);
+    response = buildForecast(8);
+    benchmarkParsers("forecast/8", OWM_ENDPOINT_FORECAST, runForecast);
+#if LARGE_CASES
+    response = buildForecast(40);
+    benchmarkParsers("forecast/40", OWM_ENDPOINT_FORECAST, runForecast);
+#endif
+    response = buildAirPollution(1);
+    benchmarkParsers("air_pollution/1", OWM_ENDPOINT_AIR_POLLUTION, runAirPollution);
+    response = buildAirPollution(24);
+    benchmarkParsers("air_pollution/24", OWM_ENDPOINT_AIR_POLLUTION, runAirPollution);
+#if LARGE_CASES
+    response = buildAirPollution(120);
+    benchmarkParsers("air_pollution/120", OWM_ENDPOINT_AIR_POLLUTION, runAirPollution);
+#endif
+    response = buildGeoLocations(1);
+    benchmarkParsers("geo/1", OWM_ENDPOINT_GEOCODING, runGeoLocations);
+    response = buildGeoLocations(OWM_MAX_GEO_RESULTS);
+    benchmarkParsers("geo/5", OWM_ENDPOINT_GEOCODING, runGeoLocations);
+
+    cities = new OWM_GeoLocation[OWM_MAX_GROUP_CITIES];
+    for (int i = 0; i < OWM_MAX_GROUP_CITIES; i++) {
+        cities[i].id = 1796236UL + i;
+    }
+    printHeader("Path");
+
+    benchmarkPath("weather", runCurrentWeatherPath);
+    benchmarkPath("forecast", runForecastPath);
+    benchmarkPath("air_pollution", runAirPollutionPath);
+    benchmarkPath("air_pollution/history", runAirPollutionHistoryPath);
+    benchmarkPath("group/20", runGroupPath);
+
+    Serial.println("\nDone.");
+}
+
+void loop() {
+    // Nothing to do
+    delay(10000);
+}
+
+// ============================================================================
+// Recorded Responses
+// ============================================================================
+
+String buildCurrentWeather() {
+    return CURRENT_WEATHER_JSON;
+}
+
+String buildForecast(int cnt) {
+    String json = "{\"cod\":\"200\",\"message\":0,\"cnt\":";
+    json += cnt;
+    json += ",\"list\":[";
+    for (int i = 0; i < cnt; i++) {
+        if (i > 0) json += ",";
+        json += FORECAST_ITEM_JSON;
+    }
+    json += "],";
+    json += FORECAST_CITY_JSON;
+    json += "}";
+    return json;
+}
+
+String buildAirPollution(int items) {
+    String json = "{\"coord\":{\"lon\":121.4737,\"lat\":31.2304},\"list\":[";
+    for (int i = 0; i < items; i++) {
+        if (i > 0) json += ",";
+        json += AIR_POLLUTION_ITEM_JSON;
+    }
+    json += "]}";
+    return json;
+}
+
+String buildGeoLocations(int results) {
+    String json = "[";
+    for (int i = 0; i < results; i++) {
+        if (i > 0) json += ",";
+        json += GEO_LOCATION_JSON;
+    }
+    json += "]";
+    return json;
+}
+
+// ============================================================================
+// Benchmarked Operations
+// ============================================================================
+
+bool runCurrentWeather() {
+    return weather.parseCurrentWeather(response, &currentWeather);
+}
+
+bool runForecast() {
+    return weather.parseForecast(response, &forecast);
+}
+
+bool runAirPollution() {
+    return weather.parseAirPollutionList(response, pollution, MAX_AIR_POLLUTION_ITEMS) > 0;
+}
+
+bool runGeoLocations() {
+    return weather.parseGeoLocations(response, locations, OWM_MAX_GEO_RESULTS) > 0;
+}
+
+bool runCurrentWeatherPath() {
+    weather.buildCurrentWeatherPath(31.2304, 121.4737, path, sizeof(path));
+    return true;
+}
+
+bool runForecastPath() {
+    weather.buildForecastPath(31.2304, 121.4737, 8, path, sizeof(path));
+    return true;
+}
+
+bool runAirPollutionPath() {
+    weather.buildAirPollutionPath(31.2304, 121.4737, path, sizeof(path));
+    return true;
+}
+
+bool runAirPollutionHistoryPath() {
+    weather.buildAirPollutionHistoryPath(31.2304, 121.4737, 1760000000UL, 1760432000UL,
+                                         path, sizeof(path));
+    return true;
+}
+
+bool runGroupPath() {
+    weather.buildGroupPath(cities, OWM_MAX_GROUP_CITIES, path, sizeof(path));
+    return true;
+}
+
+// ============================================================================
+// Harness
+// ============================================================================
+
+/**
+ * @brief Nanoseconds per call of fn, or 0 if a call failed
+ *
+ * Runs batches of doubling size until one takes at least
+ * MIN_RUN_TIME_US, so fast and slow cases get the same precision.
+ */
+unsigned long measure(BenchmarkFunction fn) {
+    // Warm-up call, also checks that the case works at all
+    if (!fn()) {
+        return 0;
+    }
+
+    unsigned long iterations = 1;
+    while (true) {
+        bool ok = true;
+        unsigned long start = micros();
+        for (unsigned long i = 0; i < iterations; i++) {
+            ok &= fn();
+        }
+        unsigned long elapsed = micros() - start;
+
+        if (!ok) {
+            return 0;
+        }
+        if (elapsed >= MIN_RUN_TIME_US) {
+            return (unsigned long)((unsigned long long)elapsed * 1000ULL / iterations);
+        }
+        iterations *= 2;
+    }
+}
+
+/**
+ * @brief Memory use of one call of fn, as measured by the library
+ */
+OWM_MemoryStats measureMemory(BenchmarkFunction fn) {
+    weather.setMemoryStats(true);
+    fn();
+    weather.setMemoryStats(false);
+    return weather.getLastMemoryStats();
+}
+
+void printHeader(const char* kind) {
+    char line[96];
+    snprintf(line, sizeof(line), "\n%-22s  %-11s  %6s  %10s  %7s  %7s  %6s",
+             kind, "Parser", "Bytes", "ns/op", "doc", "heap", "stack");
+    Serial.println(line);
+    Serial.println("----------------------  -----------  ------  ----------  -------  -------  ------");
+}
+
+void printRow(const char* name, const char* parser, size_t bytes,
+              unsigned long ns, const OWM_MemoryStats* memory) {
+    char line[96];
+    if (ns == 0) {
+        snprintf(line, sizeof(line), "%-22s  %-11s  %6u  (failed)",
+                 name, parser, (unsigned)bytes);
+    } else if (memory == NULL) {
+        snprintf(line, sizeof(line), "%-22s  %-11s  %6u  %10lu  %7s  %7s  %6s",
+                 name, parser, (unsigned)bytes, ns, "-", "-", "-");
+    } else {
+        snprintf(line, sizeof(line), "%-22s  %-11s  %6u  %10lu  %7u  %7u  %6u",
+                 name, parser, (unsigned)bytes, ns, (unsigned)memory->documentPeak,
+                 (unsigned)memory->heapPeak, (unsigned)memory->stackPeak);
+    }
+    Serial.println(line);
+}
+
+/**
+ * @brief Run one parse case over response with both parsers
+ */
+void benchmarkParsers(const char* name, OWM_Endpoint endpoint, BenchmarkFunction fn) {
+    const OWM_Parser parsers[] = { OWM_PARSER_ARDUINOJSON, OWM_PARSER_SAX };
+    const char* names[] = { "ArduinoJson", "SAX" };
+
+    for (int i = 0; i < 2; i++) {
+        weather.setParser(endpoint, parsers[i]);
+        unsigned long ns = measure(fn);
+        OWM_MemoryStats memory = measureMemory(fn);
+        printRow(name, names[i], response.length(), ns, &memory);
+    }
+
+    // Free the response before the next one is built
+    response = String();
+}
+
+/**
+ * @brief Run one path builder case
+ */
+void benchmarkPath(const char* name, BenchmarkFunction fn) {
+    unsigned long ns = measure(fn);
+    printRow(name, "-", strlen(path), ns, NULL);
+}
@@ -9,12 +9,16 @@
  * - Air Pollution API
  * - 5-Day Forecast API
  * 
+ * Periodic refreshes are run by OWM_Scheduler: refreshes that fall close
+ * together are fetched concurrently in one batch.
+ * 
  * Supported boards:
  * - Arduino UNO R4 WiFi
  * - ESP32 series
  */
 
 #include <OpenWeatherMap.h>
+#include <OWM_Scheduler.h>
 
 // WiFi credentials
 const char* WIFI_SSID = "YOUR_WIFI_SSID";
@@ -31,15 +35,20 @@ float longitude = 121.4737f;
 bool useCoordinates = false;
 
 OpenWeatherMap weather;
+OWM_Scheduler scheduler(weather);
+
+// Current weather, air quality and forecast kept up to date by the
+// scheduler (too large for the stack)
+OWM_Snapshot snapshot;
 
 // Update intervals (in milliseconds)
 const unsigned long WEATHER_UPDATE_INTERVAL = 600000;  // 10 minutes
 const unsigned long AQI_UPDATE_INTERVAL = 900000;       // 15 minutes
 const unsigned long FORECAST_UPDATE_INTERVAL = 3600000; // 1 hour
 
-unsigned long lastWeatherUpdate = 0;
-unsigned long lastAQIUpdate = 0;
-unsigned long lastForecastUpdate = 0;
+int weatherTask;
+int airQualityTask;
+int forecastTask;
 
 void setup() {
     Serial.begin(115200);
@@ -62,6 +71,15 @@ void setup() {
     weather.setTimeout(5000);  // 5 second timeout
     weather.setDebug(false);  // Set to true for debugging
     
+    // Register periodic refreshes (due times are jittered by 10%)
+    weatherTask = scheduler.addCurrentWeather(latitude, longitude, &snapshot.weather, 
+                                              WEATHER_UPDATE_INTERVAL);
+    airQualityTask = scheduler.addAirPollution(latitude, longitude, &snapshot.airPollution, 
+                                               AQI_UPDATE_INTERVAL);
+    forecastTask = scheduler.addForecast(latitude, longitude, &snapshot.forecast, 
+                                         FORECAST_UPDATE_INTERVAL, 8);
+    scheduler.onRefresh(onRefresh);
+    
     Serial.println("\nCommands:");
     Serial.println("  'w' - Get current weather");
     Serial.println("  'f' - Get 5-day forecast");
@@ -81,26 +99,9 @@ void loop() {
         handleCommand(cmd);
     }
     
-    // Auto-update based on intervals
-    unsigned long now = millis();
-    
-    if (now - lastWeatherUpdate >= WEATHER_UPDATE_INTERVAL) {
-        Serial.println("\n[Auto-update] Current weather...");
-        showCurrentWeather();
-        lastWeatherUpdate = now;
-    }
-    
-    if (now - lastAQIUpdate >= AQI_UPDATE_INTERVAL) {
-        Serial.println("\n[Auto-update] Air quality...");
-        showAirPollution();
-        lastAQIUpdate = now;
-    }
-    
-    if (now - lastForecastUpdate >= FORECAST_UPDATE_INTERVAL) {
-        Serial.println("\n[Auto-update] Forecast...");
-        showForecast();
-        lastForecastUpdate = now;
-    }
+    // Auto-update: runs whatever is due, refreshes due close together
+    // are fetched in one batch
+    scheduler.update();
 }
 
 void connectWiFi() {
@@ -169,15 +170,35 @@ void updateAllData() {
         resolveLocation();
     }
     
-    showCurrentWeather();
-    delay(500);
-    showAirPollution();
-    delay(500);
-    showForecastSummary();
-    
-    lastWeatherUpdate = millis();
-    lastAQIUpdate = millis();
-    lastForecastUpdate = millis();
+    // All three refreshes run now, concurrently; onRefresh() prints them
+    scheduler.setLocation(OWM_ALL_TASKS, latitude, longitude);
+    scheduler.refreshNow(OWM_ALL_TASKS);
+    scheduler.update();
+}
+
+void onRefresh(int task, OWM_Status status, void* userData) {
+    if (task == weatherTask) {
+        printHeader("CURRENT WEATHER");
+        if (isAvailable(status)) {
+            printCurrentWeather(snapshot.weather);
+        } else {
+            printError(status);
+        }
+    } else if (task == airQualityTask) {
+        printHeader("AIR QUALITY");
+        if (isAvailable(status)) {
+            printAirPollution(snapshot.airPollution);
+        } else {
+            printError(status);
+        }
+    } else if (task == forecastTask) {
+        printHeader("FORECAST SUMMARY (24h)");
+        if (isAvailable(status)) {
+            printForecastSummary(snapshot.forecast);
+        } else {
+            printError(status);
+        }
+    }
 }
 
 void resolveLocation() {
@@ -197,10 +218,32 @@ void resolveLocation() {
     }
 }
 
-void showCurrentWeather() {
+bool isAvailable(OWM_Status status) {
+    return status == OWM_STATUS_OK || status == OWM_STATUS_CACHED;
+}
+
+void printHeader(const char* title) {
     Serial.println("\n┌─────────────────────────────────────┐");
-    Serial.println("│         CURRENT WEATHER             │");
+    Serial.print("│ ");
+    Serial.print(title);
+    for (int i = strlen(title); i < 36; i++) {
+        Serial.print(" ");
+    }
+    Serial.println("│");
     Serial.println("└─────────────────────────────────────┘");
+}
+
+void printError(OWM_Status status) {
+    Serial.print("❌ Error: ");
+    if (status == OWM_STATUS_CANCELLED) {
+        Serial.println("not fetched");
+    } else {
+        Serial.println(weather.getLastError());
+    }
+}
+
+void showCurrentWeather() {
+    printHeader("CURRENT WEATHER");
     
     OWM_CurrentWeather data;
     bool success = useCoordinates ? 
@@ -208,93 +251,97 @@ void showCurrentWeather() {
                    weather.getCurrentWeatherByCity(cityName.c_str(), countryCode.c_str(), &data);
     
     if (success) {
-        Serial.print("📍 ");
-        Serial.print(data.name);
-        Serial.print(", ");
-        Serial.println(data.country);
-        
-        Serial.print("🌡️  Temperature: ");
-        Serial.print(data.main.temp, 1);
-        Serial.print("°C (feels like ");
-        Serial.print(data.main.feels_like, 1);
-        Serial.println("°C)");
-        
-        Serial.print("☁️  Conditions: ");
-        Serial.print(data.weather.main);
-        Serial.print(" - ");
-        Serial.println(data.weather.description);
-        
-        Serial.print("💧 Humidity: ");
-        Serial.print(data.main.humidity);
-        Serial.println("%");
-        
-        Serial.print("🌬️  Wind: ");
-        Serial.print(data.wind.speed, 1);
-        Serial.print(" m/s @ ");
-        Serial.print(data.wind.deg);
-        Serial.println("°");
-        
-        Serial.print("📊 Pressure: ");
-        Serial.print(data.main.pressure);
-        Serial.println(" hPa");
-        
-        Serial.print("👁️  Visibility: ");
-        Serial.print(data.visibility / 1000.0, 1);
-        Serial.println(" km");
+        printCurrentWeather(data);
     } else {
         Serial.print("❌ Error: ");
         Serial.println(weather.getLastError());
     }
 }
 
+void printCurrentWeather(const OWM_CurrentWeather& data) {
+    Serial.print("📍 ");
+    Serial.print(data.name);
+    Serial.print(", ");
+    Serial.println(data.country);
+    
+    Serial.print("🌡️  Temperature: ");
+    Serial.print(data.main.temp, 1);
+    Serial.print("°C (feels like ");
+    Serial.print(data.main.feels_like, 1);
+    Serial.println("°C)");
+    
+    Serial.print("☁️  Conditions: ");
+    Serial.print(data.weather.main);
+    Serial.print(" - ");
+    Serial.println(data.weather.description);
+    
+    Serial.print("💧 Humidity: ");
+    Serial.print(data.main.humidity);
+    Serial.println("%");
+    
+    Serial.print("🌬️  Wind: ");
+    Serial.print(data.wind.speed, 1);
+    Serial.print(" m/s @ ");
+    Serial.print(data.wind.deg);
+    Serial.println("°");
+    
+    Serial.print("📊 Pressure: ");
+    Serial.print(data.main.pressure);
+    Serial.println(" hPa");
+    
+    Serial.print("👁️  Visibility: ");
+    Serial.print(data.visibility / 1000.0, 1);
+    Serial.println(" km");
+}
+
 void showAirPollution() {
-    Serial.println("\n┌─────────────────────────────────────┐");
-    Serial.println("│          AIR QUALITY                │");
-    Serial.println("└─────────────────────────────────────┘");
+    printHeader("AIR QUALITY");
     
     OWM_AirPollution data;
     
     if (weather.getAirPollution(latitude, longitude, &data)) {
-        Serial.print("🌫️  Air Quality Index: ");
-        Serial.print(data.aqi);
-        Serial.print(" (");
-        Serial.print(OpenWeatherMap::getAQIDescription(data.aqi));
-        Serial.println(")");
-        
-        // Visual AQI bar
-        Serial.print("   [");
-        for (int i = 1; i <= 5; i++) {
-            if (i <= data.aqi) {
-                switch (i) {
-                    case 1: Serial.print("▓"); break;
-                    case 2: Serial.print("▓"); break;
-                    case 3: Serial.print("▓"); break;
-                    case 4: Serial.print("▓"); break;
-                    case 5: Serial.print("▓"); break;
-                }
-            } else {
-                Serial.print("░");
-            }
-        }
-        Serial.println("]");
-        
-        Serial.println("\n   Key pollutants (μg/m³):");
-        Serial.print("   PM2.5: ");
-        Serial.print(data.components.pm2_5, 1);
-        Serial.print("  |  PM10: ");
-        Serial.print(data.components.pm10, 1);
-        Serial.print("  |  O3: ");
-        Serial.println(data.components.o3, 1);
+        printAirPollution(data);
     } else {
         Serial.print("❌ Error: ");
         Serial.println(weather.getLastError());
     }
 }
 
+void printAirPollution(const OWM_AirPollution& data) {
+    Serial.print("🌫️  Air Quality Index: ");
+    Serial.print(data.aqi);
+    Serial.print(" (");
+    Serial.print(OpenWeatherMap::getAQIDescription(data.aqi));
+    Serial.println(")");
+    
+    // Visual AQI bar
+    Serial.print("   [");
+    for (int i = 1; i <= 5; i++) {
+        if (i <= data.aqi) {
+            switch (i) {
+                case 1: Serial.print("▓"); break;
+                case 2: Serial.print("▓"); break;
+                case 3: Serial.print("▓"); break;
+                case 4: Serial.print("▓"); break;
+                case 5: Serial.print("▓"); break;
+            }
+        } else {
+            Serial.print("░");
+        }
+    }
+    Serial.println("]");
+    
+    Serial.println("\n   Key pollutants (μg/m³):");
+    Serial.print("   PM2.5: ");
+    Serial.print(data.components.pm2_5, 1);
+    Serial.print("  |  PM10: ");
+    Serial.print(data.components.pm10, 1);
+    Serial.print("  |  O3: ");
+    Serial.println(data.components.o3, 1);
+}
+
 void showForecast() {
-    Serial.println("\n┌─────────────────────────────────────┐");
-    Serial.println("│         5-DAY FORECAST              │");
-    Serial.println("└─────────────────────────────────────┘");
+    printHeader("5-DAY FORECAST");
     
     OWM_Forecast forecast;
     
@@ -321,34 +368,25 @@ void showForecast() {
     }
 }
 
-void showForecastSummary() {
-    Serial.println("\n┌─────────────────────────────────────┐");
-    Serial.println("│       FORECAST SUMMARY (24h)        │");
-    Serial.println("└─────────────────────────────────────┘");
-    
-    OWM_Forecast forecast;
+void printForecastSummary(const OWM_Forecast& forecast) {
+    float minTemp = 999, maxTemp = -999;
+    float maxPop = 0;
     
-    // Get 8 items (24 hours)
-    if (weather.getForecast(latitude, longitude, &forecast, 8)) {
-        float minTemp = 999, maxTemp = -999;
-        float maxPop = 0;
-        
-        for (int i = 0; i < forecast.cnt; i++) {
-            if (forecast.items[i].main.temp < minTemp) minTemp = forecast.items[i].main.temp;
-            if (forecast.items[i].main.temp > maxTemp) maxTemp = forecast.items[i].main.temp;
-            if (forecast.items[i].pop > maxPop) maxPop = forecast.items[i].pop;
-        }
-        
-        Serial.print("🌡️  Next 24h: ");
-        Serial.print(minTemp, 0);
-        Serial.print("°C to ");
-        Serial.print(maxTemp, 0);
-        Serial.println("°C");
-        
-        Serial.print("🌧️  Max precipitation chance: ");
-        Serial.print(maxPop * 100, 0);
-        Serial.println("%");
+    for (int i = 0; i < forecast.cnt; i++) {
+        if (forecast.items[i].main.temp < minTemp) minTemp = forecast.items[i].main.temp;
+        if (forecast.items[i].main.temp > maxTemp) maxTemp = forecast.items[i].main.temp;
+        if (forecast.items[i].pop > maxPop) maxPop = forecast.items[i].pop;
     }
+    
+    Serial.print("🌡️  Next 24h: ");
+    Serial.print(minTemp, 0);
+    Serial.print("°C to ");
+    Serial.print(maxTemp, 0);
+    Serial.println("°C");
+    
+    Serial.print("🌧️  Max precipitation chance: ");
+    Serial.print(maxPop * 100, 0);
+    Serial.println("%");
 }
 
 void changeLocation() {
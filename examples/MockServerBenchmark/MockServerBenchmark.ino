@@ -0,0 +1,221 @@
+/**
+ * @file MockServerBenchmark.ino
+ * @brief Example: End-to-end throughput and latency against the mock server
+ *
+ * This example points the library at the local mock server in
+ * extras/mock_server (setServer()) and measures whole requests: sequential
+ * calls, concurrent batches at several concurrency levels, and the large
+ * forecast and air pollution responses. For each run it prints requests
+ * per second, latency percentiles and how many requests failed.
+ *
+ * Start the server on a computer in the same network first, e.g. with a
+ * slow, flaky link:
+ *
+ *     python3 extras/mock_server/mock_owm_server.py --latency 80 --jitter 40 \
+ *         --chunked --error-rate 0.05 --drop-rate 0.02
+ *
+ * No API key is required.
+ *
+ * Supported boards:
+ * - Arduino UNO R4 WiFi
+ * - ESP32 series
+ */
+
+#include <OpenWeatherMap.h>
+#include <OWM_Metrics.h>
+
+// WiFi credentials
+const char* WIFI_SSID = "YOUR_WIFI_SSID";
+const char* WIFI_PASSWORD = "YOUR_WIFI_PASSWORD";
+
+// Computer running mock_owm_server.py
+const char* MOCK_SERVER = "192.168.1.10";
+const uint16_t MOCK_PORT = 8080;
+
+// Requests per sequential run
+const int SEQUENTIAL_REQUESTS = 50;
+
+// Locations per batch and batches per concurrency level
+const int BATCH_SIZE = 20;
+const int BATCH_ROUNDS = 3;
+
+OpenWeatherMap weather;
+OWM_Metrics metrics;
+
+// Per-request latencies of the current run (microseconds)
+unsigned long latencies[SEQUENTIAL_REQUESTS];
+
+// Results are static to keep them off the stack
+OWM_CurrentWeather current;
+OWM_CurrentWeather batchResults[BATCH_SIZE];
+OWM_Status batchStatus[BATCH_SIZE];
+OWM_Coord batchCoords[BATCH_SIZE];
+OWM_Forecast forecast;
+OWM_AirPollution pollution[96];
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+        delay(100);
+    }
+
+    Serial.println();
+    Serial.println("OpenWeatherMap - Mock Server Benchmark");
+    Serial.println("======================================");
+
+    connectWiFi();
+
+    weather.begin("MOCK");
+    weather.setServer(MOCK_SERVER, MOCK_PORT);
+    weather.setCacheDuration(0);            // Every call goes to the server
+    weather.setParser(OWM_PARSER_SAX);
+    weather.setMetrics(&metrics);
+
+    for (int i = 0; i < BATCH_SIZE; i++) {
+        batchCoords[i].lat = 30.0f + i * 0.1f;
+        batchCoords[i].lon = 120.0f + i * 0.1f;
+    }
+
+    Serial.println("\nRun                   Requests  Failed     req/s    p50 ms    p90 ms    p99 ms");
+    Serial.println("--------------------  --------  ------  --------  --------  --------  --------");
+
+    runSequential();
+    runBatches(1);
+    runBatches(2);
+    runBatches(4);
+    runBatches(8);
+    runLargeResponses();
+
+    Serial.println("\nPrometheus metrics of all runs:\n");
+    metrics.writePrometheus(Serial);
+}
+
+void loop() {
+    // Nothing to do
+    delay(10000);
+}
+
+void connectWiFi() {
+    Serial.print("Connecting to WiFi");
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+
+    while (WiFi.status() != WL_CONNECTED) {
+        delay(500);
+        Serial.print(".");
+    }
+
+    Serial.println();
+    Serial.print("Connected! IP: ");
+    Serial.println(WiFi.localIP());
+}
+
+// ============================================================================
+// Runs
+// ============================================================================
+
+/**
+ * @brief One request at a time, each on a new connection
+ */
+void runSequential() {
+    int failed = 0;
+    unsigned long start = millis();
+    for (int i = 0; i < SEQUENTIAL_REQUESTS; i++) {
+        unsigned long begin = micros();
+        if (!weather.getCurrentWeather(31.2304f, 121.4737f, &current)) {
+            failed++;
+        }
+        latencies[i] = micros() - begin;
+    }
+    printRun("sequential", SEQUENTIAL_REQUESTS, failed, millis() - start,
+             latencies, SEQUENTIAL_REQUESTS);
+}
+
+/**
+ * @brief Batches over kept-alive connections
+ *
+ * Latency is per batch here: how long a full refresh of BATCH_SIZE
+ * locations takes.
+ */
+void runBatches(uint8_t concurrency) {
+    weather.setMaxConcurrency(concurrency);
+
+    int failed = 0;
+    unsigned long start = millis();
+    for (int round = 0; round < BATCH_ROUNDS; round++) {
+        unsigned long begin = micros();
+        failed += BATCH_SIZE - weather.getCurrentWeatherBatch(batchCoords, BATCH_SIZE,
+                                                              batchResults, batchStatus);
+        latencies[round] = micros() - begin;
+    }
+
+    char name[24];
+    snprintf(name, sizeof(name), "batch x%u (per batch)", concurrency);
+    printRun(name, BATCH_SIZE * BATCH_ROUNDS, failed, millis() - start,
+             latencies, BATCH_ROUNDS);
+}
+
+/**
+ * @brief The largest responses: 40 forecast items, 96 air pollution records
+ */
+void runLargeResponses() {
+    const int rounds = 10;
+
+    int failed = 0;
+    unsigned long start = millis();
+    for (int i = 0; i < rounds; i++) {
+        unsigned long begin = micros();
+        if (!weather.getForecast(31.2304f, 121.4737f, &forecast)) {
+            failed++;
+        }
+        latencies[i] = micros() - begin;
+    }
+    printRun("forecast/40", rounds, failed, millis() - start, latencies, rounds);
+
+    failed = 0;
+    start = millis();
+    for (int i = 0; i < rounds; i++) {
+        unsigned long begin = micros();
+        if (weather.getAirPollutionForecast(31.2304f, 121.4737f, pollution, 96) <= 0) {
+            failed++;
+        }
+        latencies[i] = micros() - begin;
+    }
+    printRun("air_pollution/96", rounds, failed, millis() - start, latencies, rounds);
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+
+/**
+ * @brief Latency at quantile q of the first count samples, in microseconds
+ */
+unsigned long percentile(unsigned long* samples, int count, float q) {
+    // Insertion sort; the runs are small
+    for (int i = 1; i < count; i++) {
+        unsigned long value = samples[i];
+        int j = i - 1;
+        while (j >= 0 && samples[j] > value) {
+            samples[j + 1] = samples[j];
+            j--;
+        }
+        samples[j + 1] = value;
+    }
+    return samples[(int)(q * (count - 1) + 0.5f)];
+}
+
+void printRun(const char* name, int requests, int failed, unsigned long elapsedMs,
+              unsigned long* samples, int count) {
+    // Tenths, so no float formatting is needed
+    unsigned long rate = elapsedMs > 0 ? requests * 10000UL / elapsedMs : 0;
+    unsigned long p50 = percentile(samples, count, 0.5f) / 100;
+    unsigned long p90 = percentile(samples, count, 0.9f) / 100;
+    unsigned long p99 = percentile(samples, count, 0.99f) / 100;
+
+    char line[112];
+    snprintf(line, sizeof(line),
+             "%-20s  %8d  %6d  %6lu.%lu  %6lu.%lu  %6lu.%lu  %6lu.%lu",
+             name, requests, failed, rate / 10, rate % 10,
+             p50 / 10, p50 % 10, p90 / 10, p90 % 10, p99 / 10, p99 % 10);
+    Serial.println(line);
+}
@@ -0,0 +1,370 @@
+/**
+ * @file ParserBenchmark.ino
+ * @brief Example: Compare the ArduinoJson and SAX response parsers
+ * 
+ * This example parses recorded API responses with both parsers and
+ * prints the time per parse and the memory each parser needs. It also
+ * compares number conversion: ArduinoJson's `| 0.0f` path, strtod(),
+ * owmParseDecimal() and the fixed-point owmParseFixed(). The last table
+ * row times the SAX tokenizer alone on a week of air pollution history,
+ * fed in network-sized pieces the way a download arrives. No WiFi
+ * connection or API key is required.
+ * 
+ * Supported boards:
+ * - Arduino UNO R4 WiFi
+ * - ESP32 series
+ */
+
+#include <OpenWeatherMap.h>
+#include <OWM_JsonParser.h>
+
+// Number of parses per measurement
+const int ITERATIONS = 20;
+
+// Recorded /data/2.5/weather response
+const char CURRENT_WEATHER_JSON[] =
+    "{\"coord\":{\"lon\":121.4737,\"lat\":31.2304},"
+    "\"weather\":[{\"id\":803,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04d\"}],"
+    "\"base\":\"stations\","
+    "\"main\":{\"temp\":22.92,\"feels_like\":22.84,\"temp_min\":21.93,\"temp_max\":23.94,"
+    "\"pressure\":1016,\"humidity\":66,\"sea_level\":1016,\"grnd_level\":1015},"
+    "\"visibility\":10000,\"wind\":{\"speed\":5,\"deg\":110,\"gust\":7.2},"
+    "\"clouds\":{\"all\":75},\"dt\":1760592000,"
+    "\"sys\":{\"type\":2,\"id\":2002123,\"country\":\"CN\",\"sunrise\":1760566180,\"sunset\":1760607828},"
+    "\"timezone\":28800,\"id\":1796236,\"name\":\"Shanghai\",\"cod\":200}";
+
+// One /data/2.5/forecast list item; repeated to build a full response
+const char FORECAST_ITEM_JSON[] =
+    "{\"dt\":1760594400,\"main\":{\"temp\":23.1,\"feels_like\":23.05,\"temp_min\":22.4,"
+    "\"temp_max\":23.1,\"pressure\":1016,\"sea_level\":1016,\"grnd_level\":1015,"
+    "\"humidity\":65,\"temp_kf\":0.7},"
+    "\"weather\":[{\"id\":500,\"main\":\"Rain\",\"description\":\"light rain\",\"icon\":\"10d\"}],"
+    "\"clouds\":{\"all\":86},\"wind\":{\"speed\":5.32,\"deg\":104,\"gust\":7.01},"
+    "\"visibility\":10000,\"pop\":0.36,\"rain\":{\"3h\":0.28},\"sys\":{\"pod\":\"d\"},"
+    "\"dt_txt\":\"2025-10-16 06:00:00\"}";
+
+const char FORECAST_CITY_JSON[] =
+    "\"city\":{\"id\":1796236,\"name\":\"Shanghai\",\"coord\":{\"lat\":31.2304,\"lon\":121.4737},"
+    "\"country\":\"CN\",\"population\":22315474,\"timezone\":28800,"
+    "\"sunrise\":1760566180,\"sunset\":1760607828}";
+
+// One /data/2.5/air_pollution list item
+const char AIR_POLLUTION_ITEM_JSON[] =
+    "{\"main\":{\"aqi\":2},\"components\":{\"co\":216.96,\"no\":0,\"no2\":5.83,\"o3\":78.68,"
+    "\"so2\":2.71,\"pm2_5\":11.57,\"pm10\":15.3,\"nh3\":1.44},\"dt\":1760594400}";
+
+#define AIR_POLLUTION_ITEMS 24
+
+// Air pollution history: 1 + 8 * HISTORY_BLOCKS hourly records (a week),
+// never held in memory as a whole
+#define HISTORY_BLOCKS 21
+
+// Typical numbers: coordinates, temperatures, concentrations
+const char* const NUMBERS[] = {
+    "121.4737", "31.2304", "22.92", "-3.41", "296.15", "1016", "5.32",
+    "216.96", "0.02", "78.68", "11.57", "15.3", "1.44", "0.36"
+};
+const int NUMBER_COUNT = sizeof(NUMBERS) / sizeof(NUMBERS[0]);
+
+OpenWeatherMap weather;
+
+// Large results are static to keep them off the stack
+OWM_Forecast forecast;
+OWM_AirPollution pollution[AIR_POLLUTION_ITEMS];
+
+String currentWeatherJson;
+String forecastJson;
+String airPollutionJson;
+
+/**
+ * @brief ArduinoJson allocator that tracks the peak number of bytes in use
+ */
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+    size_t current = 0;
+    size_t peak = 0;
+    
+    void* allocate(size_t size) override {
+        track(size);
+        size_t* block = (size_t*)malloc(size + sizeof(size_t));
+        if (!block) return NULL;
+        *block = size;
+        return block + 1;
+    }
+    
+    void deallocate(void* ptr) override {
+        if (!ptr) return;
+        size_t* block = (size_t*)ptr - 1;
+        current -= *block;
+        free(block);
+    }
+    
+    void* reallocate(void* ptr, size_t newSize) override {
+        size_t* block = (size_t*)ptr - 1;
+        current -= *block;
+        track(newSize);
+        block = (size_t*)realloc(block, newSize + sizeof(size_t));
+        if (!block) return NULL;
+        *block = newSize;
+        return block + 1;
+    }
+    
+private:
+    void track(size_t size) {
+        current += size;
+        if (current > peak) peak = current;
+    }
+};
+
+/**
+ * @brief Counts values, so only the tokenizer is timed
+ */
+class CountingHandler : public OWM_JsonHandler {
+public:
+    long values = 0;
+    
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length) override {
+        values++;
+        return true;
+    }
+};
+
+void setup() {
+    Serial.begin(115200);
+    while (!Serial) {
+        delay(100);
+    }
+    
+    Serial.println();
+    Serial.println("OpenWeatherMap - Parser Benchmark");
+    Serial.println("=================================");
+    
+    buildResponses();
+    
+    // No network access is needed; the key is only stored
+    weather.begin("BENCHMARK");
+    
+    Serial.println("\nResponse            Bytes  Parser        us/parse   Peak memory");
+    Serial.println("------------------  -----  -----------  ---------  -----------");
+    
+    benchmarkCurrentWeather();
+    benchmarkForecast();
+    benchmarkAirPollution();
+    benchmarkAirPollutionHistory();
+    benchmarkNumbers();
+    
+    Serial.print("\nSAX parser state: ");
+    Serial.print(sizeof(OWM_JsonParser));
+    Serial.println(" bytes (no heap)");
+}
+
+void loop() {
+    // Nothing to do
+    delay(10000);
+}
+
+/**
+ * @brief Assemble full-size responses from the recorded fragments
+ */
+void buildResponses() {
+    currentWeatherJson = CURRENT_WEATHER_JSON;
+    
+    forecastJson = "{\"cod\":\"200\",\"message\":0,\"cnt\":40,\"list\":[";
+    for (int i = 0; i < 40; i++) {
+        if (i > 0) forecastJson += ",";
+        forecastJson += FORECAST_ITEM_JSON;
+    }
+    forecastJson += "],";
+    forecastJson += FORECAST_CITY_JSON;
+    forecastJson += "}";
+    
+    airPollutionJson = "{\"coord\":{\"lon\":121.4737,\"lat\":31.2304},\"list\":[";
+    for (int i = 0; i < AIR_POLLUTION_ITEMS; i++) {
+        if (i > 0) airPollutionJson += ",";
+        airPollutionJson += AIR_POLLUTION_ITEM_JSON;
+    }
+    airPollutionJson += "]}";
+}
+
+/**
+ * @brief Peak ArduinoJson memory for deserializing a response
+ */
+size_t arduinoJsonPeak(const String& json) {
+    CountingAllocator allocator;
+    {
+        JsonDocument doc(&allocator);
+        deserializeJson(doc, json);
+    }
+    return allocator.peak;
+}
+
+void printRow(const char* response, size_t bytes, const char* parser,
+              unsigned long elapsed, size_t memory, bool ok) {
+    char line[96];
+    snprintf(line, sizeof(line), "%-18s  %5u  %-11s  %9lu  %6u bytes%s",
+             response, (unsigned)bytes, parser, elapsed / ITERATIONS,
+             (unsigned)memory, ok ? "" : "  (parse failed)");
+    Serial.println(line);
+}
+
+void benchmarkCurrentWeather() {
+    OWM_CurrentWeather data;
+    
+    weather.setParser(OWM_ENDPOINT_CURRENT_WEATHER, OWM_PARSER_ARDUINOJSON);
+    bool ok = true;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok &= weather.parseCurrentWeather(currentWeatherJson, &data);
+    }
+    printRow("Current weather", currentWeatherJson.length(), "ArduinoJson",
+             micros() - start, arduinoJsonPeak(currentWeatherJson), ok);
+    
+    weather.setParser(OWM_ENDPOINT_CURRENT_WEATHER, OWM_PARSER_SAX);
+    ok = true;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok &= weather.parseCurrentWeather(currentWeatherJson, &data);
+    }
+    printRow("Current weather", currentWeatherJson.length(), "SAX",
+             micros() - start, sizeof(OWM_JsonParser), ok);
+}
+
+void benchmarkForecast() {
+    weather.setParser(OWM_ENDPOINT_FORECAST, OWM_PARSER_ARDUINOJSON);
+    bool ok = true;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok &= weather.parseForecast(forecastJson, &forecast);
+    }
+    printRow("Forecast (40)", forecastJson.length(), "ArduinoJson",
+             micros() - start, arduinoJsonPeak(forecastJson), ok);
+    
+    weather.setParser(OWM_ENDPOINT_FORECAST, OWM_PARSER_SAX);
+    ok = true;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok &= weather.parseForecast(forecastJson, &forecast);
+    }
+    printRow("Forecast (40)", forecastJson.length(), "SAX",
+             micros() - start, sizeof(OWM_JsonParser), ok);
+}
+
+void benchmarkAirPollution() {
+    weather.setParser(OWM_ENDPOINT_AIR_POLLUTION, OWM_PARSER_ARDUINOJSON);
+    bool ok = true;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok &= weather.parseAirPollutionList(airPollutionJson, pollution, AIR_POLLUTION_ITEMS) > 0;
+    }
+    printRow("Air pollution (24)", airPollutionJson.length(), "ArduinoJson",
+             micros() - start, arduinoJsonPeak(airPollutionJson), ok);
+    
+    weather.setParser(OWM_ENDPOINT_AIR_POLLUTION, OWM_PARSER_SAX);
+    ok = true;
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        ok &= weather.parseAirPollutionList(airPollutionJson, pollution, AIR_POLLUTION_ITEMS) > 0;
+    }
+    printRow("Air pollution (24)", airPollutionJson.length(), "SAX",
+             micros() - start, sizeof(OWM_JsonParser), ok);
+}
+
+void benchmarkAirPollutionHistory() {
+    // First record, then blocks of 8 more, then the closing brackets
+    String head = "{\"coord\":{\"lon\":121.4737,\"lat\":31.2304},\"list\":[";
+    head += AIR_POLLUTION_ITEM_JSON;
+    String block;
+    for (int i = 0; i < 8; i++) {
+        block += ",";
+        block += AIR_POLLUTION_ITEM_JSON;
+    }
+    const char tail[] = "]}";
+    size_t bytes = head.length() + block.length() * HISTORY_BLOCKS + strlen(tail);
+    
+    CountingHandler handler;
+    OWM_JsonParser parser(&handler);
+    bool ok = true;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        parser.reset();
+        parser.feed(head.c_str(), head.length());
+        for (int b = 0; b < HISTORY_BLOCKS; b++) {
+            // About 1.5 KB per piece, a few TCP segments
+            parser.feed(block.c_str(), block.length());
+        }
+        parser.feed(tail, strlen(tail));
+        ok &= parser.finish();
+    }
+    unsigned long elapsed = micros() - start;
+    
+    char line[112];
+    snprintf(line, sizeof(line), "%-18s  %5u  %-11s  %9lu  %6u bytes%s  (%lu ns/byte)",
+             "Air history (169)", (unsigned)bytes, "SAX tokens", elapsed / ITERATIONS,
+             (unsigned)sizeof(OWM_JsonParser), ok ? "" : "  (parse failed)",
+             (unsigned long)(elapsed * 1000.0 / ITERATIONS / bytes));
+    Serial.println(line);
+}
+
+void benchmarkNumbers() {
+    Serial.println("\nNumber conversion   ns/number");
+    Serial.println("------------------  ---------");
+    
+    const long total = (long)ITERATIONS * NUMBER_COUNT;
+    volatile float sink = 0;
+    volatile long fixedSink = 0;
+    
+    // ArduinoJson: deserialize a number array and read with | 0.0f
+    String array = "[";
+    for (int i = 0; i < NUMBER_COUNT; i++) {
+        if (i > 0) array += ",";
+        array += NUMBERS[i];
+    }
+    array += "]";
+    
+    JsonDocument doc;
+    unsigned long start = micros();
+    for (int n = 0; n < ITERATIONS; n++) {
+        deserializeJson(doc, array);
+        for (int i = 0; i < NUMBER_COUNT; i++) {
+            sink = sink + (doc[i] | 0.0f);
+        }
+    }
+    printNumberRow("ArduinoJson | 0.0f", micros() - start, total);
+    
+    start = micros();
+    for (int n = 0; n < ITERATIONS; n++) {
+        for (int i = 0; i < NUMBER_COUNT; i++) {
+            sink = sink + (float)strtod(NUMBERS[i], NULL);
+        }
+    }
+    printNumberRow("strtod()", micros() - start, total);
+    
+    start = micros();
+    for (int n = 0; n < ITERATIONS; n++) {
+        for (int i = 0; i < NUMBER_COUNT; i++) {
+            sink = sink + owmParseDecimal(NUMBERS[i]);
+        }
+    }
+    printNumberRow("owmParseDecimal()", micros() - start, total);
+    
+    start = micros();
+    for (int n = 0; n < ITERATIONS; n++) {
+        for (int i = 0; i < NUMBER_COUNT; i++) {
+            fixedSink = fixedSink + owmParseFixed(NUMBERS[i], OWM_FIXED_VALUE_DECIMALS);
+        }
+    }
+    printNumberRow("owmParseFixed()", micros() - start, total);
+    
+    Serial.print("\nOWM_FixedWeather: ");
+    Serial.print(sizeof(OWM_FixedWeather));
+    Serial.print(" bytes, OWM_CurrentWeather: ");
+    Serial.print(sizeof(OWM_CurrentWeather));
+    Serial.println(" bytes");
+}
+
+void printNumberRow(const char* name, unsigned long elapsed, long count) {
+    char line[48];
+    snprintf(line, sizeof(line), "%-18s  %9lu", name, elapsed * 1000UL / count);
+    Serial.println(line);
+}
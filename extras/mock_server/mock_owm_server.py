@@ -0,0 +1,450 @@
+#!/usr/bin/env python3
+"""
+Local mock of the OpenWeatherMap API for load and fault testing.
+
+Serves the recorded responses in fixtures/ for the endpoints the library
+uses, so the transport code can be measured without the real service or
+an API key. Point a board at it with:
+
+    weather.setServer("192.168.1.10", 8080);
+
+Endpoints:
+    /data/2.5/weather                   fixtures/weather.json (coord and id follow the query)
+    /data/2.5/group?id=1,2,...          one weather record per id
+    /data/2.5/forecast[?cnt=N]          fixtures/forecast.json, first N items
+    /data/2.5/air_pollution             fixtures/air_pollution.json
+    /data/2.5/air_pollution/forecast    fixtures/air_pollution_forecast.json
+    /data/2.5/air_pollution/history     same list, limited to [start, end]
+    /geo/1.0/direct, /geo/1.0/reverse   fixtures/geo_direct.json, first `limit` results
+    /geo/1.0/zip                        fixtures/geo_zip.json
+    /__stats                            request counters (JSON)
+
+Faults and network conditions are set on the command line, e.g.
+
+    python3 mock_owm_server.py --latency 80 --jitter 40 --bandwidth 20000 \\
+        --chunked --error-rate 0.05 --drop-rate 0.02
+
+With --replay FILE the responses come from a recording made with
+OWM_Recorder instead of the fixtures: each request gets the next recorded
+response for its path (appid ignored), cycling when they run out, with
+the recorded timing unless --replay-timing fast is given.
+
+Only the Python 3 standard library is needed.
+"""
+
+import argparse
+import gzip
+import json
+import os
+import random
+import socket
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+FIXTURES = os.path.join(os.path.dirname(os.path.abspath(__file__)), "fixtures")
+
+
+def load_fixture(name):
+    with open(os.path.join(FIXTURES, name + ".json"), encoding="utf-8") as f:
+        return json.load(f)
+
+
+class Stats:
+    """Counters shared by all connections."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.connections = 0
+        self.requests = 0
+        self.responses = {}
+        self.drops = 0
+        self.bytes_sent = 0
+        self.started = time.time()
+
+    def count(self, field, amount=1):
+        with self.lock:
+            setattr(self, field, getattr(self, field) + amount)
+
+    def count_response(self, code):
+        with self.lock:
+            self.responses[code] = self.responses.get(code, 0) + 1
+
+    def snapshot(self):
+        with self.lock:
+            elapsed = max(time.time() - self.started, 1e-6)
+            return {
+                "uptime_s": round(elapsed, 1),
+                "connections": self.connections,
+                "requests": self.requests,
+                "requests_per_s": round(self.requests / elapsed, 2),
+                "responses": {str(k): v for k, v in sorted(self.responses.items())},
+                "drops": self.drops,
+                "bytes_sent": self.bytes_sent,
+            }
+
+
+def strip_api_key(path):
+    """Remove the appid parameter like OWM_Recorder does."""
+    start = 0
+    while True:
+        key = path.find("appid=", start)
+        if key <= 0:
+            return path
+        if path[key - 1] in "?&":
+            break
+        start = key + 1
+    end = path.find("&", key)
+    if end >= 0:
+        return path[:key] + path[end + 1:]
+    return path[:key - 1]
+
+
+class Recording:
+    """Responses of an OWM_Recorder file, by request path."""
+
+    def __init__(self, filename):
+        self.lock = threading.Lock()
+        self.entries = {}
+        self.next = {}
+        with open(filename, "rb") as f:
+            if f.readline().rstrip(b"\r\n") != b"OWMREC 1":
+                raise ValueError("%s is not a recording" % filename)
+            while True:
+                line = f.readline().rstrip(b"\r\n")
+                if not line.startswith(b">"):
+                    break
+                fields = line[1:].split(None, 5)
+                connect_us, ttfb_us, total_us, length = (int(v) for v in fields[1:5])
+                data = f.read(length)
+                f.read(1)
+                path = fields[5].decode("utf-8", "replace")
+                self.entries.setdefault(path, []).append((connect_us, ttfb_us, total_us, data))
+
+    def __len__(self):
+        return sum(len(v) for v in self.entries.values())
+
+    def take(self, path):
+        path = strip_api_key(path)
+        with self.lock:
+            entries = self.entries.get(path)
+            if not entries:
+                return None
+            index = self.next.get(path, 0)
+            self.next[path] = index + 1
+            return entries[index % len(entries)]
+
+
+class Drop(Exception):
+    """Raised to close the connection without finishing the response."""
+
+
+class MockHandler(BaseHTTPRequestHandler):
+    # HTTP/1.1 so keep-alive and chunked encoding work like the real API
+    protocol_version = "HTTP/1.1"
+
+    def version_string(self):
+        return "openresty"
+
+    def setup(self):
+        super().setup()
+        self.server.stats.count("connections")
+        self.served = 0
+
+    def log_message(self, fmt, *args):
+        if self.server.options.verbose:
+            sys.stderr.write("%s %s\n" % (self.address_string(), fmt % args))
+
+    # ------------------------------------------------------------------
+    # Request handling
+    # ------------------------------------------------------------------
+
+    def do_GET(self):
+        opts = self.server.options
+        stats = self.server.stats
+        stats.count("requests")
+        self.served += 1
+
+        url = urlparse(self.path)
+        query = {k: v[-1] for k, v in parse_qs(url.query).items()}
+
+        if url.path == "/__stats":
+            self.send_body(200, json.dumps(stats.snapshot()).encode())
+            return
+
+        try:
+            self.delay(opts.latency, opts.jitter)
+
+            if random.random() < opts.drop_rate and opts.drop_mode == "before":
+                raise Drop()
+
+            if random.random() < opts.error_rate:
+                code = random.choice(opts.error_codes)
+                body = {"cod": code, "message": "mock error"}
+                if code == 429:
+                    body["message"] = ("Your account is temporary blocked due to "
+                                       "exceeding of requests limitation of your subscription type.")
+                self.send_body(code, json.dumps(body).encode())
+                return
+
+            if opts.api_key and query.get("appid") != opts.api_key:
+                self.send_body(401, b'{"cod":401,"message":"Invalid API key."}')
+                return
+
+            if self.server.recording is not None:
+                self.send_recorded()
+                return
+
+            body = self.route(url.path, query)
+            if body is None:
+                self.send_body(404, b'{"cod":"404","message":"Internal error"}')
+                return
+            self.send_body(200, json.dumps(body, ensure_ascii=False,
+                                           separators=(",", ":")).encode("utf-8"))
+        except Drop:
+            stats.count("drops")
+            self.close_connection = True
+            try:
+                self.connection.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+        except (BrokenPipeError, ConnectionResetError):
+            self.close_connection = True
+
+    def route(self, path, query):
+        fixtures = self.server.fixtures
+        lat = float(query.get("lat", 0) or 0)
+        lon = float(query.get("lon", 0) or 0)
+
+        if path == "/data/2.5/weather":
+            record = dict(fixtures["weather"])
+            if "lat" in query:
+                record["coord"] = {"lon": lon, "lat": lat}
+            if "id" in query:
+                record["id"] = int(query["id"])
+            return record
+
+        if path == "/data/2.5/group":
+            records = []
+            for city in query.get("id", "").split(","):
+                if city.isdigit():
+                    record = dict(fixtures["weather"])
+                    record["id"] = int(city)
+                    records.append(record)
+            return {"cnt": len(records), "list": records}
+
+        if path == "/data/2.5/forecast":
+            forecast = dict(fixtures["forecast"])
+            cnt = int(query.get("cnt", 0) or 0)
+            if cnt > 0:
+                forecast["list"] = forecast["list"][:cnt]
+            forecast["cnt"] = len(forecast["list"])
+            return forecast
+
+        if path == "/data/2.5/air_pollution":
+            return fixtures["air_pollution"]
+
+        if path == "/data/2.5/air_pollution/forecast":
+            return fixtures["air_pollution_forecast"]
+
+        if path == "/data/2.5/air_pollution/history":
+            history = dict(fixtures["air_pollution_forecast"])
+            start = int(query.get("start", 0) or 0)
+            end = int(query.get("end", 0) or 0) or 2 ** 32
+            history["list"] = [r for r in history["list"] if start <= r["dt"] <= end]
+            return history
+
+        if path in ("/geo/1.0/direct", "/geo/1.0/reverse"):
+            limit = int(query.get("limit", 5) or 5)
+            return fixtures["geo_direct"][:limit]
+
+        if path == "/geo/1.0/zip":
+            return fixtures["geo_zip"]
+
+        return None
+
+    # ------------------------------------------------------------------
+    # Response writing
+    # ------------------------------------------------------------------
+
+    def send_body(self, code, body):
+        opts = self.server.options
+        stats = self.server.stats
+        stats.count_response(code)
+
+        # Fault injection: the library sends no Accept-Encoding and
+        # rejects an encoded body as an invalid response
+        use_gzip = opts.gzip
+        if use_gzip:
+            body = gzip.compress(body)
+
+        # Chunked encoding is only valid for HTTP/1.1 requests
+        http11 = self.request_version == "HTTP/1.1"
+        chunked = opts.chunked and http11
+
+        keep_alive = http11 and self.headers.get("Connection", "").lower() != "close"
+        if opts.max_requests and self.served >= opts.max_requests:
+            keep_alive = False
+        self.close_connection = not keep_alive
+
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json; charset=utf-8")
+        if use_gzip:
+            self.send_header("Content-Encoding", "gzip")
+        if chunked:
+            self.send_header("Transfer-Encoding", "chunked")
+        else:
+            self.send_header("Content-Length", str(len(body)))
+        self.send_header("Connection", "keep-alive" if keep_alive else "close")
+        self.send_header("Access-Control-Allow-Origin", "*")
+        self.end_headers()
+        self.wfile.flush()
+
+        if chunked:
+            size = opts.chunk_size
+            data = b"".join(b"%x\r\n" % len(body[i:i + size]) + body[i:i + size] + b"\r\n"
+                            for i in range(0, len(body), size))
+            data += b"0\r\n\r\n"
+        else:
+            data = body
+
+        # Drop somewhere in the body (chunk framing included)
+        cut = None
+        if random.random() < opts.drop_rate and opts.drop_mode == "body" and body:
+            cut = random.randrange(len(data))
+        self.write_throttled(data, cut)
+
+    def send_recorded(self):
+        """Send a recorded response byte for byte."""
+        entry = self.server.recording.take(self.path)
+        if entry is None:
+            self.send_body(404, b'{"cod":"404","message":"Not in the recording"}')
+            return
+        connect_us, ttfb_us, total_us, data = entry
+
+        realtime = self.server.options.replay_timing == "realtime"
+        if realtime:
+            time.sleep((connect_us + ttfb_us) / 1e6)
+
+        head, _, _ = data.partition(b"\r\n\r\n")
+        status = head.split(b"\r\n", 1)[0].split()
+        self.server.stats.count_response(int(status[1]) if len(status) > 1 else 0)
+        headers = head.lower()
+        framed = b"content-length:" in headers or b"chunked" in headers
+        self.close_connection = (self.request_version != "HTTP/1.1" or not framed or
+                                 b"connection: close" in headers)
+
+        # Spread the rest over the recorded transfer time
+        transfer = max(total_us - ttfb_us, 0) / 1e6 if realtime else 0
+        slices = max(1, min(len(data) // 256, int(transfer * 100)))
+        step = -(-len(data) // slices)
+        for i in range(0, len(data), step):
+            self.send_raw(data[i:i + step])
+            if transfer:
+                time.sleep(transfer / slices)
+
+    def write_throttled(self, data, cut):
+        """Write data at the configured bandwidth, dropping at offset cut."""
+        opts = self.server.options
+        if cut is not None:
+            self.send_raw(data[:cut])
+            raise Drop()
+
+        if opts.bandwidth <= 0:
+            self.send_raw(data)
+            return
+
+        # Send in 10 ms slices so slow links look like a real one
+        step = max(1, opts.bandwidth // 100)
+        for i in range(0, len(data), step):
+            self.send_raw(data[i:i + step])
+            time.sleep(len(data[i:i + step]) / opts.bandwidth)
+
+    def send_raw(self, data):
+        self.wfile.write(data)
+        self.wfile.flush()
+        self.server.stats.count("bytes_sent", len(data))
+
+    def delay(self, ms, jitter):
+        wait = ms + (random.uniform(-jitter, jitter) if jitter else 0)
+        if wait > 0:
+            time.sleep(wait / 1000.0)
+
+
+class MockServer(ThreadingHTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, address, options):
+        super().__init__(address, MockHandler)
+        self.options = options
+        self.stats = Stats()
+        self.recording = Recording(options.replay) if options.replay else None
+        self.fixtures = {name: load_fixture(name) for name in (
+            "weather", "forecast", "air_pollution", "air_pollution_forecast",
+            "geo_direct", "geo_zip")}
+
+
+def parse_args(argv):
+    p = argparse.ArgumentParser(description="Local mock of the OpenWeatherMap API")
+    p.add_argument("--host", default="0.0.0.0", help="address to listen on (default 0.0.0.0)")
+    p.add_argument("--port", type=int, default=8080, help="port (default 8080)")
+    p.add_argument("--latency", type=float, default=0, help="delay before each response (ms)")
+    p.add_argument("--jitter", type=float, default=0, help="random +/- added to the latency (ms)")
+    p.add_argument("--bandwidth", type=int, default=0,
+                   help="response bytes per second per connection (0 = unlimited)")
+    p.add_argument("--chunked", action="store_true",
+                   help="use chunked transfer encoding for HTTP/1.1 requests")
+    p.add_argument("--chunk-size", type=int, default=512, help="chunk size (default 512)")
+    p.add_argument("--gzip", action="store_true",
+                   help="gzip every body (fault injection: the library rejects it)")
+    p.add_argument("--error-rate", type=float, default=0,
+                   help="fraction of requests answered with an error code")
+    p.add_argument("--error-codes", default="429,500,502,503",
+                   help="error codes to pick from (default 429,500,502,503)")
+    p.add_argument("--drop-rate", type=float, default=0,
+                   help="fraction of requests whose connection is dropped")
+    p.add_argument("--drop-mode", choices=("before", "body"), default="body",
+                   help="drop before the response or in the middle of the body (default)")
+    p.add_argument("--max-requests", type=int, default=0,
+                   help="close keep-alive connections after this many requests (0 = never)")
+    p.add_argument("--replay", metavar="FILE", default="",
+                   help="serve the responses of an OWM_Recorder recording instead of the fixtures")
+    p.add_argument("--replay-timing", choices=("realtime", "fast"), default="realtime",
+                   help="reproduce the recorded latency and transfer time (default) or not")
+    p.add_argument("--api-key", default="", help="reject other appid values with 401")
+    p.add_argument("--stats-interval", type=float, default=10,
+                   help="print counters every N seconds (0 = only on exit)")
+    p.add_argument("-v", "--verbose", action="store_true", help="log every request")
+    options = p.parse_args(argv)
+    options.error_codes = [int(c) for c in options.error_codes.split(",") if c]
+    return options
+
+
+def main(argv=None):
+    options = parse_args(argv)
+    server = MockServer((options.host, options.port), options)
+    print("Mock OpenWeatherMap server on http://%s:%d" % (options.host, options.port))
+    if server.recording is not None:
+        print("Replaying %d recorded responses from %s" % (len(server.recording), options.replay))
+
+    if options.stats_interval > 0:
+        def report():
+            while True:
+                time.sleep(options.stats_interval)
+                print(json.dumps(server.stats.snapshot()), flush=True)
+        threading.Thread(target=report, daemon=True).start()
+
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        print(json.dumps(server.stats.snapshot()))
+
+
+if __name__ == "__main__":
+    main()
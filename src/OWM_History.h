@@ -0,0 +1,311 @@
+/**
+ * @file OWM_History.h
+ * @brief Fixed-capacity observation history with hourly and daily roll-ups
+ *
+ * OWM_WeatherHistory records every OWM_CurrentWeather passed to record()
+ * in three tiers:
+ * - raw: the most recent observations
+ * - hourly: min/mean/max of every completed hour
+ * - daily: min/mean/max of every completed (local) day
+ *
+ * All tiers are ring buffers sized by template parameters, so the memory
+ * footprint is sizeof(OWM_WeatherHistory<...>) and known at compile time.
+ */
+
+#ifndef OWM_HISTORY_H
+#define OWM_HISTORY_H
+
+#include "OpenWeatherMap.h"
+
+/**
+ * @brief Compact observation kept in the raw tier
+ */
+struct OWM_WeatherSample {
+    unsigned long dt;     // Time of data calculation (unix, UTC)
+    float temp;           // Temperature
+    float humidity;       // Humidity (%)
+    float pressure;       // Atmospheric pressure (hPa)
+    float wind_speed;     // Wind speed
+};
+
+/**
+ * @brief Min/mean/max of one quantity over a bucket
+ */
+struct OWM_StatRange {
+    float min;
+    float mean;
+    float max;
+};
+
+/**
+ * @brief Aggregated observations of one hour or one day
+ */
+struct OWM_WeatherAggregate {
+    unsigned long start;  // Bucket start (unix, UTC)
+    uint16_t count;       // Number of raw observations in the bucket
+    OWM_StatRange temp;
+    OWM_StatRange humidity;
+    OWM_StatRange pressure;
+    OWM_StatRange wind_speed;
+};
+
+/**
+ * @brief Fixed-size ring buffer, index 0 is the newest element
+ */
+template <typename T, size_t N>
+class OWM_Ring {
+public:
+    OWM_Ring() : _head(0), _count(0) {}
+
+    void push(const T& item) {
+        _items[_head] = item;
+        _head = (_head + 1) % N;
+        if (_count < N) {
+            _count++;
+        }
+    }
+
+    bool get(size_t index, T* out) const {
+        if (index >= _count) {
+            return false;
+        }
+        *out = _items[(_head + N - 1 - index) % N];
+        return true;
+    }
+
+    size_t size() const { return _count; }
+    size_t capacity() const { return N; }
+    void clear() { _head = 0; _count = 0; }
+
+private:
+    T _items[N];
+    size_t _head;
+    size_t _count;
+};
+
+/**
+ * @brief Running min/sum/max of one quantity
+ */
+struct OWM_StatAccumulator {
+    float min;
+    float max;
+    float sum;
+
+    void reset() { min = 0; max = 0; sum = 0; }
+
+    void add(float value, bool first) {
+        if (first || value < min) min = value;
+        if (first || value > max) max = value;
+        sum += value;
+    }
+
+    void add(const OWM_StatRange& range, uint16_t weight, bool first) {
+        if (first || range.min < min) min = range.min;
+        if (first || range.max > max) max = range.max;
+        sum += range.mean * weight;
+    }
+
+    OWM_StatRange result(uint16_t count) const {
+        OWM_StatRange range;
+        range.min = min;
+        range.max = max;
+        range.mean = count > 0 ? sum / count : 0;
+        return range;
+    }
+};
+
+/**
+ * @brief Open bucket being filled before it is pushed into a tier
+ */
+struct OWM_AggregateBuilder {
+    long key;             // Hour or day number; -1 when empty
+    unsigned long start;
+    uint16_t count;
+    OWM_StatAccumulator temp;
+    OWM_StatAccumulator humidity;
+    OWM_StatAccumulator pressure;
+    OWM_StatAccumulator wind_speed;
+
+    void reset() {
+        key = -1;
+        start = 0;
+        count = 0;
+        temp.reset();
+        humidity.reset();
+        pressure.reset();
+        wind_speed.reset();
+    }
+
+    void add(const OWM_WeatherSample& s) {
+        bool first = (count == 0);
+        temp.add(s.temp, first);
+        humidity.add(s.humidity, first);
+        pressure.add(s.pressure, first);
+        wind_speed.add(s.wind_speed, first);
+        count++;
+    }
+
+    void add(const OWM_WeatherAggregate& a) {
+        bool first = (count == 0);
+        temp.add(a.temp, a.count, first);
+        humidity.add(a.humidity, a.count, first);
+        pressure.add(a.pressure, a.count, first);
+        wind_speed.add(a.wind_speed, a.count, first);
+        count += a.count;
+    }
+
+    OWM_WeatherAggregate result() const {
+        OWM_WeatherAggregate a;
+        a.start = start;
+        a.count = count;
+        a.temp = temp.result(count);
+        a.humidity = humidity.result(count);
+        a.pressure = pressure.result(count);
+        a.wind_speed = wind_speed.result(count);
+        return a;
+    }
+};
+
+/**
+ * @brief Three-tier observation history for one location
+ * @tparam RAW Number of raw observations kept
+ * @tparam HOURLY Number of completed hours kept
+ * @tparam DAILY Number of completed days kept
+ */
+template <size_t RAW = 12, size_t HOURLY = 48, size_t DAILY = 30>
+class OWM_WeatherHistory {
+public:
+    OWM_WeatherHistory() {
+        clear();
+    }
+
+    /**
+     * @brief Remove all observations and aggregates
+     */
+    void clear() {
+        _raw.clear();
+        _hourly.clear();
+        _daily.clear();
+        _hour.reset();
+        _day.reset();
+        _lastDt = 0;
+        _timezone = 0;
+    }
+
+    /**
+     * @brief Record an observation (e.g. after getCurrentWeather())
+     *
+     * Repeated fetches of the same observation (same dt) and observations
+     * older than the last one are ignored. Days are split at local
+     * midnight using the timezone reported with the observation.
+     *
+     * @param weather Observation to record
+     * @return true if the observation was stored
+     */
+    bool record(const OWM_CurrentWeather* weather) {
+        if (weather->dt == 0 || weather->dt <= _lastDt) {
+            return false;
+        }
+        _lastDt = weather->dt;
+        _timezone = weather->timezone;
+
+        OWM_WeatherSample sample;
+        sample.dt = weather->dt;
+        sample.temp = weather->main.temp;
+        sample.humidity = weather->main.humidity;
+        sample.pressure = weather->main.pressure;
+        sample.wind_speed = weather->wind.speed;
+        _raw.push(sample);
+
+        // Close the open hour once an observation from a later hour arrives
+        long hour = (long)(sample.dt / 3600UL);
+        if (_hour.key != hour) {
+            closeHour();
+            _hour.key = hour;
+            _hour.start = (unsigned long)hour * 3600UL;
+        }
+        _hour.add(sample);
+        return true;
+    }
+
+    /**
+     * @brief Get a raw observation (0 = newest)
+     */
+    bool getRaw(size_t index, OWM_WeatherSample* out) const {
+        return _raw.get(index, out);
+    }
+
+    /**
+     * @brief Get a completed hour (0 = most recent)
+     */
+    bool getHourly(size_t index, OWM_WeatherAggregate* out) const {
+        return _hourly.get(index, out);
+    }
+
+    /**
+     * @brief Get a completed day (0 = most recent)
+     */
+    bool getDaily(size_t index, OWM_WeatherAggregate* out) const {
+        return _daily.get(index, out);
+    }
+
+    /**
+     * @brief Get the hour that is still being filled
+     * @return false if no observation has been recorded yet
+     */
+    bool getCurrentHour(OWM_WeatherAggregate* out) const {
+        if (_hour.count == 0) {
+            return false;
+        }
+        *out = _hour.result();
+        return true;
+    }
+
+    /**
+     * @brief Get the day that is still being filled (completed hours only)
+     * @return false if no hour has been completed today
+     */
+    bool getCurrentDay(OWM_WeatherAggregate* out) const {
+        if (_day.count == 0) {
+            return false;
+        }
+        *out = _day.result();
+        return true;
+    }
+
+    size_t rawCount() const { return _raw.size(); }
+    size_t hourlyCount() const { return _hourly.size(); }
+    size_t dailyCount() const { return _daily.size(); }
+
+private:
+    OWM_Ring<OWM_WeatherSample, RAW> _raw;
+    OWM_Ring<OWM_WeatherAggregate, HOURLY> _hourly;
+    OWM_Ring<OWM_WeatherAggregate, DAILY> _daily;
+    OWM_AggregateBuilder _hour;
+    OWM_AggregateBuilder _day;
+    unsigned long _lastDt;
+    int _timezone;
+
+    void closeHour() {
+        if (_hour.count == 0) {
+            return;
+        }
+        OWM_WeatherAggregate hourly = _hour.result();
+        _hourly.push(hourly);
+        _hour.reset();
+
+        // Roll the completed hour into its local day
+        long day = (long)(hourly.start + _timezone) / 86400L;
+        if (_day.key != day) {
+            if (_day.count > 0) {
+                _daily.push(_day.result());
+            }
+            _day.reset();
+            _day.key = day;
+            _day.start = (unsigned long)(day * 86400L - _timezone);
+        }
+        _day.add(hourly);
+    }
+};
+
+#endif // OWM_HISTORY_H
@@ -0,0 +1,978 @@
+/**
+ * @file OWM_JsonParser.cpp
+ * @brief Schema-specialized SAX parser implementation
+ */
+
+#include "OWM_JsonParser.h"
+
+// Tokenizer states
+enum {
+    ST_VALUE,           // Expecting a value
+    ST_VALUE_OR_END,    // Expecting a value or ']' (just after '[')
+    ST_KEY,             // Expecting a key (after ',' in an object)
+    ST_KEY_OR_END,      // Expecting a key or '}' (just after '{')
+    ST_COLON,           // Expecting ':' after a key
+    ST_AFTER_VALUE,     // Expecting ',', '}' or ']'
+    ST_STRING,
+    ST_ESCAPE,
+    ST_UNICODE,
+    ST_NUMBER,
+    ST_LITERAL,
+    ST_DONE,
+    ST_ERROR,
+    ST_STOPPED
+};
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+// ============================================================================
+// Word-at-a-time Scanning
+// ============================================================================
+
+/*
+ * feed() hands runs of plain bytes to these scanners instead of stepping
+ * the state machine once per byte: string bodies up to the next quote or
+ * backslash, number bodies up to their terminator, and whitespace up to
+ * the next structural byte. Each looks at one machine word at a time (4
+ * bytes on the 32-bit boards, 8 on 64-bit hosts) while the run is at
+ * least a word long and finishes byte by byte. Words are loaded with
+ * memcpy so unaligned input is fine.
+ *
+ * Most tokens in compact responses are shorter than a word (air
+ * pollution keys are 2-10 characters, values 1-10 digits), so the byte
+ * loops matter as much as the word tests: they are small and inlined
+ * into feed(), where step() costs a switch and a call per byte.
+ */
+
+typedef size_t owm_word_t;
+
+#define OWM_WORD_ONES  ((owm_word_t)-1 / 0xFF)
+#define OWM_WORD_HIGHS (OWM_WORD_ONES * 0x80)
+
+static inline owm_word_t broadcast(uint8_t c) {
+    return OWM_WORD_ONES * c;
+}
+
+static inline bool hasZeroByte(owm_word_t v) {
+    return ((v - OWM_WORD_ONES) & ~v & OWM_WORD_HIGHS) != 0;
+}
+
+static inline owm_word_t loadWord(const char* data) {
+    owm_word_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+// Every byte of the word is '0'..'9': the high nibble is 3, and stays 3
+// after adding 6 (which carries into it for ':' to '?')
+static inline bool allDigits(owm_word_t v) {
+    const owm_word_t nibbles = broadcast(0xF0);
+    const owm_word_t threes = broadcast(0x30);
+    return (v & nibbles) == threes && ((v + broadcast(0x06)) & nibbles) == threes;
+}
+
+static inline bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E';
+}
+
+static inline size_t scanString(const char* data, size_t length) {
+    const owm_word_t quotes = broadcast('"');
+    const owm_word_t escapes = broadcast('\\');
+    size_t i = 0;
+
+    while (i + sizeof(owm_word_t) <= length) {
+        owm_word_t word = loadWord(data + i);
+        if (hasZeroByte(word ^ quotes) || hasZeroByte(word ^ escapes)) {
+            break;
+        }
+        i += sizeof(owm_word_t);
+    }
+
+    // Locate the exact byte (or finish a short tail)
+    while (i < length && data[i] != '"' && data[i] != '\\') {
+        i++;
+    }
+    return i;
+}
+
+static inline size_t scanNumber(const char* data, size_t length) {
+    size_t i = 0;
+    while (i + sizeof(owm_word_t) <= length && allDigits(loadWord(data + i))) {
+        i += sizeof(owm_word_t);
+    }
+    while (i < length && isNumberChar(data[i])) {
+        i++;
+    }
+    return i;
+}
+
+static inline size_t skipSpace(const char* data, size_t length) {
+    // Compact responses have none: one compare and out
+    if (length == 0 || !isSpace(data[0])) {
+        return 0;
+    }
+    const owm_word_t spaces = broadcast(' ');
+    size_t i = 1;
+    while (i + sizeof(owm_word_t) <= length && loadWord(data + i) == spaces) {
+        i += sizeof(owm_word_t);
+    }
+    while (i < length && isSpace(data[i])) {
+        i++;
+    }
+    return i;
+}
+
+size_t owmJsonScanString(const char* data, size_t length) {
+    return scanString(data, length);
+}
+
+// ============================================================================
+// Tokenizer
+// ============================================================================
+
+OWM_JsonParser::OWM_JsonParser(OWM_JsonHandler* handler) {
+    _handler = handler;
+    reset();
+}
+
+void OWM_JsonParser::reset() {
+    _depth = -1;
+    _state = ST_VALUE;
+    _isKey = false;
+    _tokenLen = 0;
+    _token[0] = '\0';
+    _unicodeDigits = 0;
+    _unicode = 0;
+}
+
+bool OWM_JsonParser::feed(const char* data, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        // Take plain runs in one go; only the byte that ends a run (a
+        // quote, escape, terminator or structural byte) goes through the
+        // state machine
+        size_t run;
+        switch (_state) {
+            case ST_STRING:
+                run = scanString(data + i, length - i);
+                appendRun(data + i, run);
+                break;
+            case ST_NUMBER:
+                run = scanNumber(data + i, length - i);
+                appendRun(data + i, run);
+                break;
+            case ST_VALUE:
+            case ST_VALUE_OR_END:
+            case ST_KEY:
+            case ST_KEY_OR_END:
+            case ST_COLON:
+            case ST_AFTER_VALUE:
+                run = skipSpace(data + i, length - i);
+                break;
+            default:
+                run = 0;
+                break;
+        }
+        i += run;
+        if (i == length) {
+            break;
+        }
+        if (!step(data[i++])) {
+            return _state == ST_DONE;
+        }
+    }
+    return _state != ST_ERROR && _state != ST_STOPPED;
+}
+
+bool OWM_JsonParser::finish() {
+    return _state == ST_DONE;
+}
+
+bool OWM_JsonParser::done() const {
+    return _state == ST_DONE;
+}
+
+bool OWM_JsonParser::stopped() const {
+    return _state == ST_STOPPED;
+}
+
+// Returns false once no further input is wanted (done, error or stopped)
+bool OWM_JsonParser::step(char c) {
+    switch (_state) {
+        case ST_VALUE:
+        case ST_VALUE_OR_END:
+            if (isSpace(c)) return true;
+            if (c == ']' && _state == ST_VALUE_OR_END) {
+                return closeContainer();
+            }
+            return beginValue(c);
+
+        case ST_KEY:
+        case ST_KEY_OR_END:
+            if (isSpace(c)) return true;
+            if (c == '"') {
+                _isKey = true;
+                _tokenLen = 0;
+                _state = ST_STRING;
+                return true;
+            }
+            if (c == '}' && _state == ST_KEY_OR_END) {
+                return closeContainer();
+            }
+            break;
+
+        case ST_COLON:
+            if (isSpace(c)) return true;
+            if (c == ':') {
+                _state = ST_VALUE;
+                return true;
+            }
+            break;
+
+        case ST_AFTER_VALUE:
+            if (isSpace(c)) return true;
+            if (c == ',') {
+                OWM_JsonFrame& top = _path[_depth];
+                if (top.isArray) {
+                    top.index++;
+                    _state = ST_VALUE;
+                } else {
+                    top.key = OWM_KEY_UNKNOWN;
+                    _state = ST_KEY;
+                }
+                return true;
+            }
+            if (c == '}' || c == ']') {
+                if ((c == ']') != _path[_depth].isArray) {
+                    break;
+                }
+                return closeContainer();
+            }
+            break;
+
+        case ST_STRING:
+            if (c == '"') {
+                _token[_tokenLen] = '\0';
+                if (_isKey) {
+                    _path[_depth].key = owmJsonKeyId(_token, _tokenLen);
+                    _isKey = false;
+                    _state = ST_COLON;
+                    return true;
+                }
+                return endScalar(OWM_JSON_STRING);
+            }
+            if (c == '\\') {
+                _state = ST_ESCAPE;
+                return true;
+            }
+            appendToken(c);
+            return true;
+
+        case ST_ESCAPE:
+            _state = ST_STRING;
+            switch (c) {
+                case 'b': appendToken('\b'); return true;
+                case 'f': appendToken('\f'); return true;
+                case 'n': appendToken('\n'); return true;
+                case 'r': appendToken('\r'); return true;
+                case 't': appendToken('\t'); return true;
+                case 'u':
+                    _unicode = 0;
+                    _unicodeDigits = 0;
+                    _state = ST_UNICODE;
+                    return true;
+                default:  appendToken(c); return true;  // '"', '\\', '/'
+            }
+
+        case ST_UNICODE: {
+            uint8_t digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else break;
+            _unicode = (_unicode << 4) | digit;
+            if (++_unicodeDigits == 4) {
+                appendUtf8(_unicode);
+                _state = ST_STRING;
+            }
+            return true;
+        }
+
+        case ST_NUMBER:
+            if ((c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' ||
+                c == 'e' || c == 'E') {
+                appendToken(c);
+                return true;
+            }
+            _token[_tokenLen] = '\0';
+            if (!endScalar(OWM_JSON_NUMBER)) {
+                return false;
+            }
+            return step(c);  // The terminator belongs to the next token
+
+        case ST_LITERAL:
+            if (c >= 'a' && c <= 'z') {
+                appendToken(c);
+                return true;
+            }
+            _token[_tokenLen] = '\0';
+            if (strcmp(_token, "true") == 0) {
+                if (!endScalar(OWM_JSON_TRUE)) return false;
+            } else if (strcmp(_token, "false") == 0) {
+                if (!endScalar(OWM_JSON_FALSE)) return false;
+            } else if (strcmp(_token, "null") == 0) {
+                if (!endScalar(OWM_JSON_NULL)) return false;
+            } else {
+                break;
+            }
+            return step(c);
+
+        case ST_DONE:
+        case ST_ERROR:
+        case ST_STOPPED:
+            return false;
+    }
+
+    _state = ST_ERROR;
+    return false;
+}
+
+bool OWM_JsonParser::beginValue(char c) {
+    if (c == '{' || c == '[') {
+        if (_depth + 1 >= OWM_JSON_MAX_DEPTH) {
+            _state = ST_ERROR;
+            return false;
+        }
+        _depth++;
+        OWM_JsonFrame& frame = _path[_depth];
+        frame.key = OWM_KEY_UNKNOWN;
+        frame.isArray = (c == '[');
+        frame.index = 0;
+        _state = frame.isArray ? ST_VALUE_OR_END : ST_KEY_OR_END;
+        return true;
+    }
+
+    _tokenLen = 0;
+    if (c == '"') {
+        _isKey = false;
+        _state = ST_STRING;
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        appendToken(c);
+        _state = ST_NUMBER;
+        return true;
+    }
+    if (c == 't' || c == 'f' || c == 'n') {
+        appendToken(c);
+        _state = ST_LITERAL;
+        return true;
+    }
+
+    _state = ST_ERROR;
+    return false;
+}
+
+bool OWM_JsonParser::endScalar(OWM_JsonType type) {
+    if (_depth < 0) {
+        // Bare scalar document; nothing a schema handler is interested in
+        _state = ST_DONE;
+        return false;
+    }
+    if (!_handler->onValue(_path, _depth, type, _token, _tokenLen)) {
+        _state = ST_STOPPED;
+        return false;
+    }
+    _state = ST_AFTER_VALUE;
+    return true;
+}
+
+bool OWM_JsonParser::closeContainer() {
+    if (!_handler->onEnd(_path, _depth)) {
+        _state = ST_STOPPED;
+        return false;
+    }
+    _depth--;
+    if (_depth < 0) {
+        _state = ST_DONE;
+        return false;
+    }
+    _state = ST_AFTER_VALUE;
+    return true;
+}
+
+void OWM_JsonParser::appendToken(char c) {
+    if (_tokenLen < OWM_JSON_TOKEN_SIZE - 1) {
+        _token[_tokenLen++] = c;
+    }
+}
+
+void OWM_JsonParser::appendRun(const char* data, size_t length) {
+    size_t room = OWM_JSON_TOKEN_SIZE - 1 - _tokenLen;
+    if (length > room) {
+        length = room;
+    }
+    memcpy(_token + _tokenLen, data, length);
+    _tokenLen += length;
+}
+
+void OWM_JsonParser::appendUtf8(uint16_t cp) {
+    if (cp < 0x80) {
+        appendToken((char)cp);
+    } else if (cp < 0x800) {
+        appendToken((char)(0xC0 | (cp >> 6)));
+        appendToken((char)(0x80 | (cp & 0x3F)));
+    } else {
+        appendToken((char)(0xE0 | (cp >> 12)));
+        appendToken((char)(0x80 | ((cp >> 6) & 0x3F)));
+        appendToken((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+// ============================================================================
+// Number Parsing
+// ============================================================================
+
+// Largest number of significant digits that fits in a uint32_t
+#define OWM_DECIMAL_MAX_DIGITS 9
+
+static const float kPow10[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const uint32_t kPow10Int[] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL,
+    100000000UL, 1000000000UL
+};
+
+/**
+ * Decimal number as mantissa * 10^exponent
+ */
+struct OWM_Decimal {
+    uint32_t mantissa;
+    int exponent;
+    bool negative;
+};
+
+static void scanDecimal(const char* p, OWM_Decimal* d) {
+    d->mantissa = 0;
+    d->exponent = 0;
+    d->negative = false;
+
+    if (*p == '-') {
+        d->negative = true;
+        p++;
+    }
+
+    int digits = 0;
+    for (; *p >= '0' && *p <= '9'; p++) {
+        if (digits < OWM_DECIMAL_MAX_DIGITS) {
+            d->mantissa = d->mantissa * 10 + (*p - '0');
+            if (d->mantissa != 0) digits++;
+        } else {
+            d->exponent++;    // Dropped integer digit
+        }
+    }
+
+    if (*p == '.') {
+        for (p++; *p >= '0' && *p <= '9'; p++) {
+            if (digits < OWM_DECIMAL_MAX_DIGITS) {
+                d->mantissa = d->mantissa * 10 + (*p - '0');
+                d->exponent--;
+                if (d->mantissa != 0) digits++;
+            }
+        }
+    }
+
+    if (*p == 'e' || *p == 'E') {
+        p++;
+        bool negativeExp = false;
+        if (*p == '-' || *p == '+') {
+            negativeExp = (*p == '-');
+            p++;
+        }
+        int exp = 0;
+        for (; *p >= '0' && *p <= '9'; p++) {
+            if (exp < 1000) exp = exp * 10 + (*p - '0');
+        }
+        d->exponent += negativeExp ? -exp : exp;
+    }
+}
+
+float owmParseDecimal(const char* text) {
+    OWM_Decimal d;
+    scanDecimal(text, &d);
+
+    if (d.exponent < -10 || d.exponent > 10) {
+        return (float)strtod(text, NULL);
+    }
+    
+    // Up to 2^24 the mantissa and the power of ten are exact floats, so
+    // the one float operation rounds correctly. Longer mantissas (8-9
+    // digits, e.g. geocoding coordinates) would be rounded twice; in
+    // double both operands are still exact and the result matches
+    // (float)strtod()
+    float value;
+    if (d.mantissa <= 16777216UL) {
+        value = d.exponent >= 0 ? (float)d.mantissa * kPow10[d.exponent]
+                                : (float)d.mantissa / kPow10[-d.exponent];
+    } else {
+        value = d.exponent >= 0 ? (float)((double)d.mantissa * kPow10[d.exponent])
+                                : (float)((double)d.mantissa / kPow10[-d.exponent]);
+    }
+    return d.negative ? -value : value;
+}
+
+long owmParseFixed(const char* text, uint8_t decimals) {
+    OWM_Decimal d;
+    scanDecimal(text, &d);
+
+    int shift = d.exponent + decimals;
+    int64_t value;
+    if (shift >= 0) {
+        value = d.mantissa;
+        for (int i = 0; i < shift && value <= INT32_MAX; i++) {
+            value *= 10;
+        }
+        if (value > INT32_MAX) value = INT32_MAX;
+    } else if (-shift <= OWM_DECIMAL_MAX_DIGITS) {
+        uint32_t divisor = kPow10Int[-shift];
+        value = ((uint64_t)d.mantissa + divisor / 2) / divisor;
+    } else {
+        value = 0;
+    }
+    return d.negative ? -(long)value : (long)value;
+}
+
+// ============================================================================
+// Value Conversion
+// ============================================================================
+
+static float toFloat(OWM_JsonType type, const char* text) {
+    return type == OWM_JSON_NUMBER ? owmParseDecimal(text) : 0.0f;
+}
+
+static long toFixed(OWM_JsonType type, const char* text, uint8_t decimals) {
+    return type == OWM_JSON_NUMBER ? owmParseFixed(text, decimals) : 0L;
+}
+
+static int toInt(OWM_JsonType type, const char* text) {
+    return type == OWM_JSON_NUMBER ? (int)strtol(text, NULL, 10) : 0;
+}
+
+static unsigned long toULong(OWM_JsonType type, const char* text) {
+    return type == OWM_JSON_NUMBER ? strtoul(text, NULL, 10) : 0UL;
+}
+
+static void toString(OWM_JsonType type, const char* text, char* dest, size_t size) {
+    if (type == OWM_JSON_STRING) {
+        strncpy(dest, text, size - 1);
+        dest[size - 1] = '\0';
+    }
+}
+
+// ============================================================================
+// Field Table Walker
+// ============================================================================
+
+/*
+ * Follow path[0..depth] through a field table starting at base and store
+ * the value in the member it leads to. Keys without a table entry, array
+ * elements other than the first of an OWM_FIELD_FIRST array and type
+ * mismatches are ignored.
+ */
+static void applyValue(const OWM_FieldTable* table, void* base, const OWM_JsonFrame* p,
+                       int depth, OWM_JsonType type, const char* text) {
+    uint8_t* dest = (uint8_t*)base;
+    int level = 0;
+
+    while (level <= depth) {
+        if (p[level].isArray) {
+            return;
+        }
+        const OWM_Field* field = owmFindField(table, p[level].key);
+        if (field == NULL) {
+            return;
+        }
+        dest += field->offset;
+
+        if (field->type == OWM_FIELD_OBJECT) {
+            table = field->sub;
+            level++;
+            continue;
+        }
+        if (field->type == OWM_FIELD_FIRST) {
+            // Skip the array frame; only element 0 is stored
+            if (level + 1 > depth || !p[level + 1].isArray || p[level + 1].index != 0) {
+                return;
+            }
+            table = field->sub;
+            level += 2;
+            continue;
+        }
+        if (level != depth) {
+            return;     // Scalar member but the JSON value is nested deeper
+        }
+
+        switch (field->type) {
+            case OWM_FIELD_INT:
+                owmStoreInt(dest, field->size, toInt(type, text));
+                break;
+            case OWM_FIELD_ULONG: {
+                unsigned long value = toULong(type, text);
+                if (field->size == sizeof(uint32_t)) {
+                    uint32_t value32 = value;
+                    memcpy(dest, &value32, sizeof(value32));
+                } else {
+                    memcpy(dest, &value, sizeof(value));
+                }
+                break;
+            }
+            case OWM_FIELD_FLOAT: {
+                float value = toFloat(type, text);
+                memcpy(dest, &value, sizeof(value));
+                break;
+            }
+            case OWM_FIELD_FIXED:
+                owmStoreInt(dest, field->size, toFixed(type, text, field->decimals));
+                break;
+            case OWM_FIELD_STRING:
+                toString(type, text, (char*)dest, field->size);
+                break;
+        }
+        return;
+    }
+}
+
+// ============================================================================
+// OWM_SchemaHandler
+// ============================================================================
+
+OWM_SchemaHandler::OWM_SchemaHandler(const OWM_FieldTable* table, void* base) {
+    setTarget(table, base);
+}
+
+void OWM_SchemaHandler::setTarget(const OWM_FieldTable* table, void* base) {
+    _table = table;
+    _base = base;
+}
+
+bool OWM_SchemaHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                const char* text, size_t length) {
+    if (_table != NULL) {
+        applyValue(_table, _base, p, depth, type, text);
+    }
+    return true;
+}
+
+// ============================================================================
+// OWM_CurrentWeatherHandler
+// ============================================================================
+
+OWM_CurrentWeatherHandler::OWM_CurrentWeatherHandler(OWM_CurrentWeather* weather) {
+    _weather = weather;
+}
+
+bool OWM_CurrentWeatherHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                        const char* text, size_t length) {
+    applyValue(&owmCurrentWeatherSchema, _weather, p, depth, type, text);
+    return true;
+}
+
+// ============================================================================
+// OWM_CurrentWeatherListHandler
+// ============================================================================
+
+OWM_CurrentWeatherListHandler::OWM_CurrentWeatherListHandler(OWM_CurrentWeather* list,
+                                                             int maxItems) {
+    _list = list;
+    _maxItems = maxItems;
+    _count = 0;
+}
+
+bool OWM_CurrentWeatherListHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                            const char* text, size_t length) {
+    if (depth >= 2 && p[0].key == OWM_KEY_LIST && p[1].index < _maxItems) {
+        applyValue(&owmCurrentWeatherSchema, &_list[p[1].index], p + 2, depth - 2, type, text);
+    }
+    return true;
+}
+
+bool OWM_CurrentWeatherListHandler::onEnd(const OWM_JsonFrame* p, int depth) {
+    if (depth == 2 && p[0].key == OWM_KEY_LIST && _count < _maxItems) {
+        _count = p[1].index + 1;
+    }
+    return true;
+}
+
+// ============================================================================
+// OWM_ForecastHandler
+// ============================================================================
+
+OWM_ForecastHandler::OWM_ForecastHandler(OWM_Forecast* forecast) {
+    setTarget(forecast);
+}
+
+void OWM_ForecastHandler::setTarget(OWM_Forecast* forecast) {
+    _forecast = forecast;
+}
+
+bool OWM_ForecastHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                  const char* text, size_t length) {
+    OWM_Forecast* f = _forecast;
+
+    if (p[0].key == OWM_KEY_LIST) {
+        // list[i] lives at depth 2; items past the array size are skipped
+        if (depth >= 2 && p[1].index < OWM_MAX_FORECAST_ITEMS) {
+            applyValue(&owmForecastItemSchema, &f->items[p[1].index], p + 2, depth - 2,
+                       type, text);
+        }
+        return true;
+    }
+
+    applyValue(&owmForecastSchema, f, p, depth, type, text);
+    if (f->cnt > OWM_MAX_FORECAST_ITEMS) {
+        f->cnt = OWM_MAX_FORECAST_ITEMS;
+    }
+    return true;
+}
+
+// ============================================================================
+// OWM_AirPollutionListHandler
+// ============================================================================
+
+OWM_AirPollutionListHandler::OWM_AirPollutionListHandler(OWM_AirPollution* list, int maxItems) {
+    setTarget(list, maxItems);
+}
+
+void OWM_AirPollutionListHandler::setTarget(OWM_AirPollution* list, int maxItems) {
+    _list = list;
+    _maxItems = maxItems;
+    _count = 0;
+}
+
+bool OWM_AirPollutionListHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                          const char* text, size_t length) {
+    if (depth >= 2 && p[0].key == OWM_KEY_LIST && p[1].index < _maxItems) {
+        applyValue(&owmAirPollutionSchema, &_list[p[1].index], p + 2, depth - 2, type, text);
+    }
+    return true;
+}
+
+bool OWM_AirPollutionListHandler::onEnd(const OWM_JsonFrame* p, int depth) {
+    // A list element closed
+    if (depth == 2 && p[0].key == OWM_KEY_LIST && _count < _maxItems) {
+        _count = p[1].index + 1;
+    }
+    return true;
+}
+
+// ============================================================================
+// OWM_ListItemHandler
+// ============================================================================
+
+OWM_ListItemHandler::OWM_ListItemHandler(const OWM_FieldTable* table, void* item,
+                                         size_t itemSize, OWM_ListItemCallback callback,
+                                         void* context, bool countAll) {
+    _table = table;
+    _item = item;
+    _itemSize = itemSize;
+    _callback = callback;
+    _context = context;
+    _countAll = countAll;
+    _delivering = true;
+    _foundList = false;
+    _count = 0;
+    memset(_item, 0, _itemSize);
+}
+
+bool OWM_ListItemHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                  const char* text, size_t length) {
+    if (_delivering && depth >= 2 && p[0].key == OWM_KEY_LIST && p[1].isArray) {
+        applyValue(_table, _item, p + 2, depth - 2, type, text);
+    }
+    return true;
+}
+
+bool OWM_ListItemHandler::onEnd(const OWM_JsonFrame* p, int depth) {
+    if (depth == 2 && p[0].key == OWM_KEY_LIST && p[1].isArray) {
+        return deliver(p[1].index);
+    }
+    if (depth == 1 && p[0].key == OWM_KEY_LIST && p[1].isArray) {
+        _foundList = true;      // Possibly empty
+    }
+    return true;
+}
+
+bool OWM_ListItemHandler::deliver(int index) {
+    _foundList = true;
+    _count = index + 1;
+    if (!_delivering) {
+        return true;            // Only counting
+    }
+
+    bool more = _callback(_item, index, _context);
+    memset(_item, 0, _itemSize);
+    if (!more) {
+        _delivering = false;
+        return _countAll;
+    }
+    return true;
+}
+
+// ============================================================================
+// OWM_GeoListHandler
+// ============================================================================
+
+OWM_GeoListHandler::OWM_GeoListHandler(OWM_GeoLocation* locations, int maxResults) {
+    _locations = locations;
+    _maxResults = maxResults;
+    _count = 0;
+    _rootIsArray = false;
+}
+
+bool OWM_GeoListHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                 const char* text, size_t length) {
+    if (p[0].isArray && depth >= 1 && p[0].index < _maxResults) {
+        applyValue(&owmGeoLocationSchema, &_locations[p[0].index], p + 1, depth - 1,
+                   type, text);
+    }
+    return true;
+}
+
+bool OWM_GeoListHandler::onEnd(const OWM_JsonFrame* p, int depth) {
+    if (depth == 0) {
+        _rootIsArray = p[0].isArray;
+    } else if (depth == 1 && p[0].isArray && _count < _maxResults) {
+        _count = p[0].index + 1;
+    }
+    return true;
+}
+
+// ============================================================================
+// OWM_GeoZipHandler
+// ============================================================================
+
+OWM_GeoZipHandler::OWM_GeoZipHandler(OWM_GeoLocation* location) {
+    _location = location;
+}
+
+bool OWM_GeoZipHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                const char* text, size_t length) {
+    applyValue(&owmGeoLocationSchema, _location, p, depth, type, text);
+    return true;
+}
+
+// ============================================================================
+// Fixed-point Schemas
+// ============================================================================
+
+static const OWM_Field kFixedCoordFields[] = {
+    OWM_FIXED_ENTRY(OWM_FixedWeather, LAT, lat, OWM_FIXED_COORD_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedWeather, LON, lon, OWM_FIXED_COORD_DECIMALS),
+};
+static OWM_FIELD_TABLE(kFixedCoord, kFixedCoordFields);
+
+static const OWM_Field kFixedConditionFields[] = {
+    OWM_FIELD_ENTRY(OWM_FixedWeather, ID, OWM_FIELD_INT, weather_id),
+};
+static OWM_FIELD_TABLE(kFixedCondition, kFixedConditionFields);
+
+static const OWM_Field kFixedMainFields[] = {
+    OWM_FIXED_ENTRY(OWM_FixedWeather, TEMP, temp, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedWeather, FEELS_LIKE, feels_like, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedWeather, TEMP_MIN, temp_min, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedWeather, TEMP_MAX, temp_max, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIELD_ENTRY(OWM_FixedWeather, PRESSURE, OWM_FIELD_INT, pressure),
+    OWM_FIELD_ENTRY(OWM_FixedWeather, HUMIDITY, OWM_FIELD_INT, humidity),
+};
+static OWM_FIELD_TABLE(kFixedMain, kFixedMainFields);
+
+static const OWM_Field kFixedWindFields[] = {
+    OWM_FIXED_ENTRY(OWM_FixedWeather, SPEED, wind_speed, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIELD_ENTRY(OWM_FixedWeather, DEG, OWM_FIELD_INT, wind_deg),
+};
+static OWM_FIELD_TABLE(kFixedWind, kFixedWindFields);
+
+static const OWM_Field kFixedCloudsFields[] = {
+    OWM_FIELD_ENTRY(OWM_FixedWeather, ALL, OWM_FIELD_INT, clouds),
+};
+static OWM_FIELD_TABLE(kFixedClouds, kFixedCloudsFields);
+
+static const OWM_Field kFixedWeatherFields[] = {
+    OWM_FLAT_ENTRY(COORD, kFixedCoord),
+    { OWM_KEY_WEATHER, OWM_FIELD_FIRST, 0, 0, 0, &kFixedCondition },
+    OWM_FLAT_ENTRY(MAIN, kFixedMain),
+    OWM_FLAT_ENTRY(WIND, kFixedWind),
+    OWM_FLAT_ENTRY(CLOUDS, kFixedClouds),
+    OWM_FIELD_ENTRY(OWM_FixedWeather, DT, OWM_FIELD_ULONG, dt),
+    OWM_FIELD_ENTRY(OWM_FixedWeather, TIMEZONE, OWM_FIELD_INT, timezone),
+};
+static OWM_FIELD_TABLE(kFixedWeather, kFixedWeatherFields);
+
+static const OWM_Field kFixedAqiFields[] = {
+    OWM_FIELD_ENTRY(OWM_FixedAirPollution, AQI, OWM_FIELD_INT, aqi),
+};
+static OWM_FIELD_TABLE(kFixedAqi, kFixedAqiFields);
+
+static const OWM_Field kFixedComponentsFields[] = {
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, CO, co, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, NO, no, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, NO2, no2, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, O3, o3, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, SO2, so2, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, PM2_5, pm2_5, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, PM10, pm10, OWM_FIXED_VALUE_DECIMALS),
+    OWM_FIXED_ENTRY(OWM_FixedAirPollution, NH3, nh3, OWM_FIXED_VALUE_DECIMALS),
+};
+static OWM_FIELD_TABLE(kFixedComponents, kFixedComponentsFields);
+
+static const OWM_Field kFixedAirPollutionFields[] = {
+    OWM_FIELD_ENTRY(OWM_FixedAirPollution, DT, OWM_FIELD_ULONG, dt),
+    OWM_FLAT_ENTRY(MAIN, kFixedAqi),
+    OWM_FLAT_ENTRY(COMPONENTS, kFixedComponents),
+};
+static OWM_FIELD_TABLE(kFixedAirPollution, kFixedAirPollutionFields);
+
+// ============================================================================
+// OWM_FixedWeatherHandler
+// ============================================================================
+
+OWM_FixedWeatherHandler::OWM_FixedWeatherHandler(OWM_FixedWeather* weather) {
+    _weather = weather;
+}
+
+bool OWM_FixedWeatherHandler::onValue(const OWM_JsonFrame* p, int depth, OWM_JsonType type,
+                                      const char* text, size_t length) {
+    applyValue(&kFixedWeather, _weather, p, depth, type, text);
+    return true;
+}
+
+// ============================================================================
+// OWM_FixedAirPollutionListHandler
+// ============================================================================
+
+OWM_FixedAirPollutionListHandler::OWM_FixedAirPollutionListHandler(OWM_FixedAirPollution* list,
+                                                                   int maxItems) {
+    _list = list;
+    _maxItems = maxItems;
+    _count = 0;
+}
+
+bool OWM_FixedAirPollutionListHandler::onValue(const OWM_JsonFrame* p, int depth,
+                                               OWM_JsonType type, const char* text,
+                                               size_t length) {
+    if (depth >= 2 && p[0].key == OWM_KEY_LIST && p[1].index < _maxItems) {
+        applyValue(&kFixedAirPollution, &_list[p[1].index], p + 2, depth - 2, type, text);
+    }
+    return true;
+}
+
+bool OWM_FixedAirPollutionListHandler::onEnd(const OWM_JsonFrame* p, int depth) {
+    if (depth == 2 && p[0].key == OWM_KEY_LIST && _count < _maxItems) {
+        _count = p[1].index + 1;
+    }
+    return true;
+}
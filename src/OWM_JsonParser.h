@@ -0,0 +1,435 @@
+/**
+ * @file OWM_JsonParser.h
+ * @brief Schema-specialized SAX parser for OpenWeatherMap responses
+ *
+ * OWM_JsonParser is a byte-at-a-time JSON tokenizer that never builds a
+ * document tree. It keeps one frame per nesting level (key id, container
+ * type, array index) and reports every scalar value together with that
+ * path to an OWM_JsonHandler. The handlers in this file know the layout
+ * of each OpenWeatherMap response and write values straight into the
+ * OWM_* structs, so a response is parsed in a single pass with
+ * O(depth) state and no heap allocation.
+ *
+ * Object keys are mapped to small integer ids (OWM_JsonKey) as soon as
+ * they are read, and the handlers locate struct members through the
+ * field tables in OWM_Schema.h instead of comparing strings.
+ */
+
+#ifndef OWM_JSONPARSER_H
+#define OWM_JSONPARSER_H
+
+#include "OWM_Schema.h"
+
+// Maximum nesting depth (OpenWeatherMap responses use at most 4)
+#define OWM_JSON_MAX_DEPTH 10
+
+// Longest string or number kept; longer tokens are truncated
+#define OWM_JSON_TOKEN_SIZE 72
+
+/**
+ * @brief Scalar value types reported to handlers
+ */
+enum OWM_JsonType {
+    OWM_JSON_STRING,
+    OWM_JSON_NUMBER,
+    OWM_JSON_TRUE,
+    OWM_JSON_FALSE,
+    OWM_JSON_NULL
+};
+
+/**
+ * @brief Length of the plain run at the start of a string body
+ *
+ * Scans a word at a time for the first '"' or '\\'.
+ *
+ * @return Number of bytes before the first quote or backslash
+ */
+size_t owmJsonScanString(const char* data, size_t length);
+
+// ============================================================================
+// Number Parsing
+// ============================================================================
+
+// Fixed-point scales used by OWM_FixedWeather and OWM_FixedAirPollution
+#define OWM_FIXED_COORD_DECIMALS 5    // Coordinates in 1e-5 degrees
+#define OWM_FIXED_VALUE_DECIMALS 2    // Temperatures, speeds, concentrations in 1/100
+
+/**
+ * @brief Parse a JSON number into a float
+ *
+ * Accumulates up to 9 significant digits in an integer and applies the
+ * decimal exponent with a single table multiply or divide: in float for
+ * up to 7 significant digits (correctly rounded), in double for 8-9
+ * digits (same result as (float)strtod()). Exponents beyond +/-10 fall
+ * back to strtod(); digits past the 9th are dropped.
+ */
+float owmParseDecimal(const char* text);
+
+/**
+ * @brief Parse a JSON number into a scaled integer
+ *
+ * Returns value * 10^decimals rounded half away from zero, without any
+ * floating point arithmetic, e.g. owmParseFixed("-12.345", 2) == -1235.
+ */
+long owmParseFixed(const char* text, uint8_t decimals);
+
+/**
+ * @brief One nesting level of the current parse position
+ *
+ * For objects, key is the id of the member being parsed; for arrays,
+ * index is the position of the element being parsed.
+ */
+struct OWM_JsonFrame {
+    uint8_t key;
+    bool isArray;
+    uint16_t index;
+};
+
+/**
+ * @brief Receives parse events
+ *
+ * path[0..depth] describes where the event happened: path[depth] is the
+ * innermost container. Return false from any event to stop parsing.
+ */
+class OWM_JsonHandler {
+public:
+    virtual ~OWM_JsonHandler() {}
+
+    /**
+     * @brief A scalar value was read
+     * @param text Value text, NUL-terminated (strings are unescaped)
+     */
+    virtual bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                         const char* text, size_t length) = 0;
+
+    /**
+     * @brief The container at path[depth] was closed
+     */
+    virtual bool onEnd(const OWM_JsonFrame* path, int depth) { return true; }
+};
+
+/**
+ * @brief Resumable SAX tokenizer
+ */
+class OWM_JsonParser {
+public:
+    OWM_JsonParser(OWM_JsonHandler* handler);
+
+    /**
+     * @brief Prepare for a new document
+     */
+    void reset();
+
+    /**
+     * @brief Parse the next piece of the document
+     * @return false on a syntax error or if the handler stopped parsing
+     */
+    bool feed(const char* data, size_t length);
+
+    /**
+     * @brief Check that a complete document was parsed
+     */
+    bool finish();
+
+    /**
+     * @brief True once the root container has been closed
+     */
+    bool done() const;
+
+    /**
+     * @brief True if parsing stopped because the handler asked to
+     */
+    bool stopped() const;
+
+private:
+    OWM_JsonHandler* _handler;
+    OWM_JsonFrame _path[OWM_JSON_MAX_DEPTH];
+    int8_t _depth;
+    uint8_t _state;
+    bool _isKey;
+    char _token[OWM_JSON_TOKEN_SIZE];
+    uint8_t _tokenLen;
+    uint8_t _unicodeDigits;
+    uint16_t _unicode;
+
+    bool step(char c);
+    bool beginValue(char c);
+    bool endScalar(OWM_JsonType type);
+    bool closeContainer();
+    void appendToken(char c);
+    void appendRun(const char* data, size_t length);
+    void appendUtf8(uint16_t codepoint);
+};
+
+// ============================================================================
+// Schema Handlers
+// ============================================================================
+
+/**
+ * @brief Any response whose root object is described by a field table
+ *
+ * Can be re-targeted, so a fixed set of handlers serves a stream of
+ * requests (see setMaxConcurrency()).
+ */
+class OWM_SchemaHandler : public OWM_JsonHandler {
+public:
+    OWM_SchemaHandler(const OWM_FieldTable* table = NULL, void* base = NULL);
+    void setTarget(const OWM_FieldTable* table, void* base);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+
+private:
+    const OWM_FieldTable* _table;
+    void* _base;
+};
+
+/**
+ * @brief /data/2.5/weather
+ */
+class OWM_CurrentWeatherHandler : public OWM_JsonHandler {
+public:
+    OWM_CurrentWeatherHandler(OWM_CurrentWeather* weather);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+
+private:
+    OWM_CurrentWeather* _weather;
+};
+
+/**
+ * @brief /data/2.5/group ("list" of current weather records)
+ */
+class OWM_CurrentWeatherListHandler : public OWM_JsonHandler {
+public:
+    OWM_CurrentWeatherListHandler(OWM_CurrentWeather* list, int maxItems);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+    bool onEnd(const OWM_JsonFrame* path, int depth);
+
+    /**
+     * @brief Number of records stored
+     */
+    int count() const { return _count; }
+
+private:
+    OWM_CurrentWeather* _list;
+    int _maxItems;
+    int _count;
+};
+
+/**
+ * @brief /data/2.5/forecast
+ */
+class OWM_ForecastHandler : public OWM_JsonHandler {
+public:
+    OWM_ForecastHandler(OWM_Forecast* forecast = NULL);
+    void setTarget(OWM_Forecast* forecast);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+
+private:
+    OWM_Forecast* _forecast;
+};
+
+/**
+ * @brief /data/2.5/air_pollution[/forecast|/history]
+ */
+class OWM_AirPollutionListHandler : public OWM_JsonHandler {
+public:
+    OWM_AirPollutionListHandler(OWM_AirPollution* list = NULL, int maxItems = 0);
+    void setTarget(OWM_AirPollution* list, int maxItems);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+    bool onEnd(const OWM_JsonFrame* path, int depth);
+
+    /**
+     * @brief Number of records stored
+     */
+    int count() const { return _count; }
+
+private:
+    OWM_AirPollution* _list;
+    int _maxItems;
+    int _count;
+};
+
+/**
+ * @brief Called by OWM_ListItemHandler for every element of "list"
+ * @param item The filled item (cleared again after the call)
+ * @param index Zero-based position of the element
+ * @return false to stop delivering elements
+ */
+typedef bool (*OWM_ListItemCallback)(void* item, int index, void* context);
+
+/**
+ * @brief Elements of "list" one at a time (forecastEach() and the *Each() methods)
+ *
+ * Fills a single item through a field table and hands it to the
+ * callback as soon as its element closes, so memory does not depend on
+ * the length of the list. Parsing stops when the callback does, unless
+ * countAll is set: then the remaining elements are only counted.
+ */
+class OWM_ListItemHandler : public OWM_JsonHandler {
+public:
+    OWM_ListItemHandler(const OWM_FieldTable* table, void* item, size_t itemSize,
+                        OWM_ListItemCallback callback, void* context, bool countAll = false);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+    bool onEnd(const OWM_JsonFrame* path, int depth);
+
+    /**
+     * @brief Hand the item of element index to the callback and clear it
+     *
+     * Called by onEnd(); the ArduinoJson streaming path fills item()
+     * itself and calls it directly.
+     *
+     * @return false once no further elements are wanted
+     */
+    bool deliver(int index);
+
+    const OWM_FieldTable* table() const { return _table; }
+    void* item() const { return _item; }
+
+    /**
+     * @brief True until the callback has returned false
+     */
+    bool delivering() const { return _delivering; }
+
+    /**
+     * @brief Number of elements read
+     */
+    int count() const { return _count; }
+
+    /**
+     * @brief True once an element or the end of "list" has been seen
+     */
+    bool foundList() const { return _foundList; }
+
+private:
+    const OWM_FieldTable* _table;
+    void* _item;
+    size_t _itemSize;
+    OWM_ListItemCallback _callback;
+    void* _context;
+    bool _countAll;
+    bool _delivering;
+    bool _foundList;
+    int _count;
+};
+
+/**
+ * @brief /geo/1.0/direct and /geo/1.0/reverse (root array)
+ */
+class OWM_GeoListHandler : public OWM_JsonHandler {
+public:
+    OWM_GeoListHandler(OWM_GeoLocation* locations, int maxResults);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+    bool onEnd(const OWM_JsonFrame* path, int depth);
+
+    /**
+     * @brief Number of locations stored, or -1 if the root was not an array
+     */
+    int count() const { return _rootIsArray ? _count : -1; }
+
+private:
+    OWM_GeoLocation* _locations;
+    int _maxResults;
+    int _count;
+    bool _rootIsArray;
+};
+
+/**
+ * @brief /geo/1.0/zip
+ */
+class OWM_GeoZipHandler : public OWM_JsonHandler {
+public:
+    OWM_GeoZipHandler(OWM_GeoLocation* location);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+
+private:
+    OWM_GeoLocation* _location;
+};
+
+// ============================================================================
+// Fixed-point Results
+// ============================================================================
+
+/**
+ * @brief Current weather in fixed-point form
+ *
+ * Less than a third of the size of OWM_CurrentWeather and exact for the
+ * precision the API reports. Filled by OWM_FixedWeatherHandler.
+ */
+struct OWM_FixedWeather {
+    int32_t lat;          // Latitude (1e-5 degrees)
+    int32_t lon;          // Longitude (1e-5 degrees)
+    int16_t temp;         // Temperature (1/100 unit)
+    int16_t feels_like;   // Feels like temperature (1/100 unit)
+    int16_t temp_min;     // Minimum temperature (1/100 unit)
+    int16_t temp_max;     // Maximum temperature (1/100 unit)
+    uint16_t pressure;    // Atmospheric pressure (hPa)
+    uint8_t humidity;     // Humidity (%)
+    uint8_t clouds;       // Cloudiness (%)
+    uint16_t wind_speed;  // Wind speed (1/100 unit)
+    uint16_t wind_deg;    // Wind direction (degrees)
+    uint16_t weather_id;  // Weather condition id
+    uint32_t dt;          // Time of data calculation (unix, UTC)
+    int32_t timezone;     // Shift from UTC (seconds)
+};
+
+/**
+ * @brief Air pollution record in fixed-point form
+ *
+ * Concentrations are in 1/100 μg/m³. Filled by
+ * OWM_FixedAirPollutionListHandler.
+ */
+struct OWM_FixedAirPollution {
+    uint32_t dt;          // Date and time (unix, UTC)
+    uint8_t aqi;          // Air Quality Index (1-5)
+    int32_t co;
+    int32_t no;
+    int32_t no2;
+    int32_t o3;
+    int32_t so2;
+    int32_t pm2_5;
+    int32_t pm10;
+    int32_t nh3;
+};
+
+/**
+ * @brief /data/2.5/weather into OWM_FixedWeather
+ */
+class OWM_FixedWeatherHandler : public OWM_JsonHandler {
+public:
+    OWM_FixedWeatherHandler(OWM_FixedWeather* weather);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+
+private:
+    OWM_FixedWeather* _weather;
+};
+
+/**
+ * @brief /data/2.5/air_pollution[/forecast|/history] into OWM_FixedAirPollution
+ */
+class OWM_FixedAirPollutionListHandler : public OWM_JsonHandler {
+public:
+    OWM_FixedAirPollutionListHandler(OWM_FixedAirPollution* list, int maxItems);
+    bool onValue(const OWM_JsonFrame* path, int depth, OWM_JsonType type,
+                 const char* text, size_t length);
+    bool onEnd(const OWM_JsonFrame* path, int depth);
+
+    /**
+     * @brief Number of records stored
+     */
+    int count() const { return _count; }
+
+private:
+    OWM_FixedAirPollution* _list;
+    int _maxItems;
+    int _count;
+};
+
+#endif // OWM_JSONPARSER_H
@@ -0,0 +1,197 @@
+/**
+ * @file OWM_Metrics.cpp
+ * @brief Request metrics and Prometheus exporter implementation
+ */
+
+#include "OWM_Metrics.h"
+
+static const uint32_t kLatencyBounds[] = OWM_METRICS_LATENCY_BOUNDS;
+static const uint32_t kSizeBounds[] = OWM_METRICS_SIZE_BOUNDS;
+
+// Label values, indexed by OWM_Endpoint and OWM_Status
+static const char* const kEndpointNames[OWM_ENDPOINT_COUNT] = {
+    "current_weather", "forecast", "air_pollution", "geocoding"
+};
+static const char* const kStatusNames[OWM_STATUS_COUNT] = {
+    "ok", "cached", "connection_failed", "timeout", "http_error", "parse_error", "cancelled",
+    "invalid_response"
+};
+static const char* const kResultNames[2] = { "ok", "error" };
+
+// Index of the first bucket whose bound is >= value (count for the open bucket)
+static uint8_t bucketOf(const uint32_t* bounds, uint8_t count, uint32_t value) {
+    uint8_t i = 0;
+    while (i < count && value > bounds[i]) {
+        i++;
+    }
+    return i;
+}
+
+OWM_Metrics::OWM_Metrics() {
+    reset();
+}
+
+void OWM_Metrics::reset() {
+    memset(_stats, 0, sizeof(_stats));
+}
+
+void OWM_Metrics::record(OWM_Endpoint endpoint, OWM_Status status, const OWM_Timings* timings,
+                         int httpCode) {
+    if (endpoint >= OWM_ENDPOINT_COUNT || status >= OWM_STATUS_COUNT) {
+        return;
+    }
+    EndpointStats& s = _stats[endpoint];
+    s.outcomes[status]++;
+    if (httpCode == 429) {
+        s.rateLimited++;
+    }
+    if (timings == NULL) {
+        return;
+    }
+
+    int failed = (status != OWM_STATUS_OK);
+    uint32_t ms = timings->total / 1000;
+    s.latency[failed][bucketOf(kLatencyBounds, OWM_METRICS_LATENCY_BUCKETS - 1, ms)]++;
+    s.latencySumMs[failed] += ms;
+    s.size[bucketOf(kSizeBounds, OWM_METRICS_SIZE_BUCKETS - 1, timings->bodyBytes)]++;
+    s.sizeSum += timings->bodyBytes;
+}
+
+uint32_t OWM_Metrics::count(OWM_Endpoint endpoint, OWM_Status status) const {
+    if (endpoint >= OWM_ENDPOINT_COUNT || status >= OWM_STATUS_COUNT) {
+        return 0;
+    }
+    return _stats[endpoint].outcomes[status];
+}
+
+uint32_t OWM_Metrics::latencyQuantile(OWM_Endpoint endpoint, float q, bool failed) const {
+    if (endpoint >= OWM_ENDPOINT_COUNT) {
+        return 0;
+    }
+    const uint32_t* latency = _stats[endpoint].latency[failed ? 1 : 0];
+
+    uint32_t total = 0;
+    for (int i = 0; i < OWM_METRICS_LATENCY_BUCKETS; i++) {
+        total += latency[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Smallest bucket holding at least q of the samples (nearest rank)
+    float r = ceilf(q * total);
+    uint32_t rank = (r < 1.0f) ? 1 : (r > total) ? total : (uint32_t)r;
+    uint32_t seen = 0;
+    for (int i = 0; i < OWM_METRICS_LATENCY_BUCKETS - 1; i++) {
+        seen += latency[i];
+        if (seen >= rank) {
+            return kLatencyBounds[i];
+        }
+    }
+    return 0xFFFFFFFFUL;
+}
+
+void OWM_Metrics::writePrometheus(Print& out) const {
+    out.println("# HELP owm_requests_total Requests by endpoint and outcome");
+    out.println("# TYPE owm_requests_total counter");
+    for (int e = 0; e < OWM_ENDPOINT_COUNT; e++) {
+        for (int s = 0; s < OWM_STATUS_COUNT; s++) {
+            out.print("owm_requests_total{endpoint=\"");
+            out.print(kEndpointNames[e]);
+            out.print("\",outcome=\"");
+            out.print(kStatusNames[s]);
+            out.print("\"} ");
+            out.println(_stats[e].outcomes[s]);
+        }
+    }
+
+    out.println("# HELP owm_rate_limited_total HTTP 429 responses");
+    out.println("# TYPE owm_rate_limited_total counter");
+    for (int e = 0; e < OWM_ENDPOINT_COUNT; e++) {
+        out.print("owm_rate_limited_total{endpoint=\"");
+        out.print(kEndpointNames[e]);
+        out.print("\"} ");
+        out.println(_stats[e].rateLimited);
+    }
+
+    writeHistogram(out, "owm_request_duration_seconds", "Latency of network requests", true);
+    writeHistogram(out, "owm_response_body_bytes", "Response body size", false);
+}
+
+void OWM_Metrics::writeHistogram(Print& out, const char* name, const char* help,
+                                 bool latency) const {
+    const uint32_t* bounds = latency ? kLatencyBounds : kSizeBounds;
+    uint8_t buckets = latency ? OWM_METRICS_LATENCY_BUCKETS : OWM_METRICS_SIZE_BUCKETS;
+
+    out.print("# HELP ");
+    out.print(name);
+    out.print(" ");
+    out.println(help);
+    out.print("# TYPE ");
+    out.print(name);
+    out.println(" histogram");
+
+    // Latency has one series per result, body size one per endpoint
+    for (int e = 0; e < OWM_ENDPOINT_COUNT; e++) {
+        const EndpointStats& s = _stats[e];
+        if (latency) {
+            for (int r = 0; r < 2; r++) {
+                writeSeries(out, name, e, kResultNames[r], s.latency[r], buckets, bounds,
+                            true, s.latencySumMs[r]);
+            }
+        } else {
+            writeSeries(out, name, e, NULL, s.size, buckets, bounds, false, s.sizeSum);
+        }
+    }
+}
+
+void OWM_Metrics::writeSeries(Print& out, const char* name, int endpoint, const char* result,
+                              const uint32_t* counts, uint8_t buckets, const uint32_t* bounds,
+                              bool latency, uint32_t sum) const {
+    // Prometheus buckets are cumulative
+    uint32_t cumulative = 0;
+    for (int i = 0; i < buckets; i++) {
+        cumulative += counts[i];
+        out.print(name);
+        out.print("_bucket{endpoint=\"");
+        out.print(kEndpointNames[endpoint]);
+        if (result != NULL) {
+            out.print("\",result=\"");
+            out.print(result);
+        }
+        out.print("\",le=\"");
+        if (i == buckets - 1) {
+            out.print("+Inf");
+        } else if (latency) {
+            out.print(bounds[i] / 1000.0f, 3);
+        } else {
+            out.print(bounds[i]);
+        }
+        out.print("\"} ");
+        out.println(cumulative);
+    }
+
+    out.print(name);
+    out.print("_sum{endpoint=\"");
+    out.print(kEndpointNames[endpoint]);
+    if (result != NULL) {
+        out.print("\",result=\"");
+        out.print(result);
+    }
+    out.print("\"} ");
+    if (latency) {
+        out.println(sum / 1000.0f, 3);     // Kept in ms
+    } else {
+        out.println(sum);
+    }
+
+    out.print(name);
+    out.print("_count{endpoint=\"");
+    out.print(kEndpointNames[endpoint]);
+    if (result != NULL) {
+        out.print("\",result=\"");
+        out.print(result);
+    }
+    out.print("\"} ");
+    out.println(cumulative);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file OWM_Metrics.h
+ * @brief Request counters and latency/size histograms with a Prometheus exporter
+ *
+ * Attach an OWM_Metrics to a client with OpenWeatherMap::setMetrics() and
+ * every request is counted per endpoint and outcome (OWM_Status), cache
+ * hits included. Network requests also go into fixed-bucket histograms of
+ * their latency (OWM_Timings::total, kept apart for successful and failed
+ * requests so timeouts do not skew the percentiles) and body size, and
+ * HTTP 429 responses are counted separately. A request is counted once,
+ * after its body has been parsed.
+ *
+ * writePrometheus() prints everything in the Prometheus text format, so a
+ * gateway can serve it from its own HTTP handler; p50/p99 latency, cache
+ * hit ratio and 429 rate are then histogram_quantile() and rate() queries.
+ *
+ * All counters are 32-bit words written only by the task that uses the
+ * client. Readers on other tasks (e.g. an async web server) need no lock:
+ * each value is read whole, and a scrape that races an update is off by
+ * at most that one request.
+ */
+
+#ifndef OWM_METRICS_H
+#define OWM_METRICS_H
+
+#include "OpenWeatherMap.h"
+
+// Latency bucket bounds in ms (a last, open bucket catches the rest)
+#define OWM_METRICS_LATENCY_BOUNDS { 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000 }
+#define OWM_METRICS_LATENCY_BUCKETS 11
+
+// Body size bucket bounds in bytes
+#define OWM_METRICS_SIZE_BOUNDS { 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536 }
+#define OWM_METRICS_SIZE_BUCKETS 10
+
+// Number of OWM_Status values
+#define OWM_STATUS_COUNT (OWM_STATUS_INVALID_RESPONSE + 1)
+
+class OWM_Metrics {
+public:
+    OWM_Metrics();
+
+    /**
+     * @brief Clear all counters
+     */
+    void reset();
+
+    /**
+     * @brief Count one request (called by the library)
+     * @param endpoint Endpoint group of the request
+     * @param status Outcome
+     * @param timings Timings of a network request, NULL for cache hits
+     * @param httpCode HTTP status code (0 if none was received)
+     */
+    void record(OWM_Endpoint endpoint, OWM_Status status, const OWM_Timings* timings,
+                int httpCode);
+
+    /**
+     * @brief Number of requests with the given outcome
+     */
+    uint32_t count(OWM_Endpoint endpoint, OWM_Status status) const;
+
+    /**
+     * @brief Upper bound of the latency bucket holding quantile q
+     * @param q Quantile (e.g. 0.99)
+     * @param failed false for requests with OWM_STATUS_OK, true for the rest
+     * @return Latency in ms, 0 without samples, 0xFFFFFFFF in the open bucket
+     */
+    uint32_t latencyQuantile(OWM_Endpoint endpoint, float q, bool failed = false) const;
+
+    /**
+     * @brief Print all metrics in the Prometheus text exposition format
+     */
+    void writePrometheus(Print& out) const;
+
+private:
+    struct EndpointStats {
+        uint32_t outcomes[OWM_STATUS_COUNT];
+        uint32_t rateLimited;
+        uint32_t latency[2][OWM_METRICS_LATENCY_BUCKETS];   // [failed]
+        uint32_t latencySumMs[2];
+        uint32_t size[OWM_METRICS_SIZE_BUCKETS];
+        uint32_t sizeSum;
+    };
+
+    EndpointStats _stats[OWM_ENDPOINT_COUNT];
+
+    void writeHistogram(Print& out, const char* name, const char* help, bool latency) const;
+    void writeSeries(Print& out, const char* name, int endpoint, const char* result,
+                     const uint32_t* counts, uint8_t buckets, const uint32_t* bounds,
+                     bool latency, uint32_t sum) const;
+};
+
+#endif // OWM_METRICS_H
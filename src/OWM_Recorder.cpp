@@ -0,0 +1,494 @@
+/**
+ * @file OWM_Recorder.cpp
+ * @brief Record and replay of HTTP exchanges implementation
+ */
+
+#include "OWM_Recorder.h"
+
+// Initial size of a recorded response buffer
+#define OWM_RECORD_INITIAL_BUFFER 1024
+
+// Removes the appid parameter, so recordings hold no API key
+static void stripApiKey(char* path) {
+    char* key = strstr(path, "appid=");
+    while (key != NULL && (key == path || (key[-1] != '?' && key[-1] != '&'))) {
+        key = strstr(key + 1, "appid=");
+    }
+    if (key == NULL) {
+        return;
+    }
+
+    char* end = strchr(key, '&');
+    if (end != NULL) {
+        memmove(key, end + 1, strlen(end + 1) + 1);
+    } else {
+        key[-1] = '\0';     // Last parameter: drop it with its separator
+    }
+}
+
+// ============================================================================
+// OWM_Recorder
+// ============================================================================
+
+OWM_Recorder::OWM_Recorder() {
+    _out = NULL;
+    _in = NULL;
+    _timing = OWM_REPLAY_FAST;
+    _startMs = 0;
+    _exchanges = 0;
+    _misses = 0;
+    _pendingCount = 0;
+}
+
+OWM_Recorder::~OWM_Recorder() {
+    stop();
+}
+
+void OWM_Recorder::record(Print& out) {
+    stop();
+    _out = &out;
+    _startMs = millis();
+    _exchanges = 0;
+    _misses = 0;
+    _out->print(OWM_RECORD_HEADER);
+    _out->print('\n');
+}
+
+bool OWM_Recorder::replay(Stream& in, OWM_ReplayTiming timing) {
+    stop();
+
+    char line[16];
+    size_t len = in.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[len] = '\0';
+    if (len > 0 && line[len - 1] == '\r') {
+        line[len - 1] = '\0';
+    }
+    if (strcmp(line, OWM_RECORD_HEADER) != 0) {
+        return false;
+    }
+
+    _in = &in;
+    _timing = timing;
+    _exchanges = 0;
+    _misses = 0;
+    return true;
+}
+
+void OWM_Recorder::stop() {
+    while (_pendingCount > 0) {
+        dropPending(0);
+    }
+    _out = NULL;
+    _in = NULL;
+}
+
+bool OWM_Recorder::recording() const {
+    return _out != NULL;
+}
+
+bool OWM_Recorder::replaying() const {
+    return _in != NULL;
+}
+
+OWM_ReplayTiming OWM_Recorder::timing() const {
+    return _timing;
+}
+
+uint32_t OWM_Recorder::exchanges() const {
+    return _exchanges;
+}
+
+uint32_t OWM_Recorder::misses() const {
+    return _misses;
+}
+
+void OWM_Recorder::write(const char* path, unsigned long connectUs, unsigned long ttfbUs,
+                         unsigned long totalUs, const uint8_t* data, size_t length) {
+    if (_out == NULL) {
+        return;
+    }
+    _out->print("> ");
+    _out->print(millis() - _startMs);
+    _out->print(' ');
+    _out->print(connectUs);
+    _out->print(' ');
+    _out->print(ttfbUs);
+    _out->print(' ');
+    _out->print(totalUs);
+    _out->print(' ');
+    _out->print((unsigned long)length);
+    _out->print(' ');
+    _out->print(path);
+    _out->print('\n');
+    if (length > 0) {
+        _out->write(data, length);
+    }
+    _out->print('\n');
+    _exchanges++;
+}
+
+bool OWM_Recorder::take(const char* path, OWM_RecordedExchange* exchange) {
+    if (_in == NULL) {
+        _misses++;
+        return false;
+    }
+
+    // Entries skipped by earlier requests first (concurrent requests
+    // finish in a different order each time)
+    for (uint8_t i = 0; i < _pendingCount; i++) {
+        if (strcmp(_pending[i].path, path) == 0) {
+            *exchange = _pending[i];
+            free(exchange->path);
+            exchange->path = NULL;
+            for (uint8_t j = i + 1; j < _pendingCount; j++) {
+                _pending[j - 1] = _pending[j];
+            }
+            _pendingCount--;
+            _exchanges++;
+            return true;
+        }
+    }
+
+    // Then read ahead; an entry nobody asks for is dropped once it is the
+    // oldest of a full lookahead
+    for (int read = 0; read < OWM_REPLAY_LOOKAHEAD; read++) {
+        OWM_RecordedExchange entry;
+        if (!readEntry(&entry)) {
+            break;
+        }
+        if (strcmp(entry.path, path) == 0) {
+            *exchange = entry;
+            free(exchange->path);
+            exchange->path = NULL;
+            _exchanges++;
+            return true;
+        }
+        if (_pendingCount == OWM_REPLAY_LOOKAHEAD) {
+            dropPending(0);
+        }
+        _pending[_pendingCount++] = entry;
+    }
+
+    _misses++;
+    return false;
+}
+
+bool OWM_Recorder::readEntry(OWM_RecordedExchange* exchange) {
+    char line[OWM_RECORD_MAX_LINE + 64];
+    size_t len = _in->readBytesUntil('\n', line, sizeof(line) - 1);
+    line[len] = '\0';
+    if (len > 0 && line[len - 1] == '\r') {
+        line[len - 1] = '\0';
+    }
+    if (line[0] != '>') {
+        return false;
+    }
+
+    // "> ms connect ttfb total length path"
+    char* p = line + 1;
+    strtoul(p, &p, 10);
+    exchange->connectUs = strtoul(p, &p, 10);
+    exchange->ttfbUs = strtoul(p, &p, 10);
+    exchange->totalUs = strtoul(p, &p, 10);
+    exchange->length = strtoul(p, &p, 10);
+    if (*p != ' ') {
+        return false;
+    }
+
+    exchange->data = (uint8_t*)malloc(exchange->length > 0 ? exchange->length : 1);
+    exchange->path = strdup(p + 1);
+    if (exchange->data == NULL || exchange->path == NULL) {
+        free(exchange->data);
+        free(exchange->path);
+        return false;
+    }
+    if (_in->readBytes((char*)exchange->data, exchange->length) != exchange->length) {
+        free(exchange->data);
+        free(exchange->path);
+        return false;
+    }
+    _in->read();        // Newline after the data
+    return true;
+}
+
+void OWM_Recorder::dropPending(uint8_t index) {
+    free(_pending[index].path);
+    free(_pending[index].data);
+    for (uint8_t i = index + 1; i < _pendingCount; i++) {
+        _pending[i - 1] = _pending[i];
+    }
+    _pendingCount--;
+}
+
+// ============================================================================
+// OWM_RecorderClient
+// ============================================================================
+
+OWM_RecorderClient::OWM_RecorderClient() {
+    _recorder = NULL;
+    _network = NULL;
+    _data = NULL;
+    _capacity = 0;
+    reset();
+}
+
+OWM_RecorderClient::~OWM_RecorderClient() {
+    free(_data);
+}
+
+void OWM_RecorderClient::reset() {
+    _lineLength = 0;
+    _lineDone = false;
+    _sending = false;
+    _pending = false;
+    _length = 0;
+    _position = 0;
+    _missed = false;
+    _connectUs = 0;
+    _sentUs = 0;
+    _ttfbUs = 0;
+    _totalUs = 0;
+}
+
+void OWM_RecorderClient::beginRecord(OWM_Recorder* recorder, Client* network,
+                                     unsigned long connectUs) {
+    reset();
+    _recorder = recorder;
+    _network = network;
+    _connectUs = connectUs;
+}
+
+void OWM_RecorderClient::beginReplay(OWM_Recorder* recorder) {
+    free(_data);
+    _data = NULL;
+    _capacity = 0;
+    reset();
+    _recorder = recorder;
+    _network = NULL;
+}
+
+int OWM_RecorderClient::connect(IPAddress ip, uint16_t port) {
+    return 0;       // Opened by the library (beginRecord(), beginReplay())
+}
+
+int OWM_RecorderClient::connect(const char* host, uint16_t port) {
+    return 0;
+}
+
+#if defined(ESP32)
+int OWM_RecorderClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+    return 0;
+}
+
+int OWM_RecorderClient::connect(const char* host, uint16_t port, int32_t timeout) {
+    return 0;
+}
+#endif
+
+size_t OWM_RecorderClient::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t OWM_RecorderClient::write(const uint8_t* buffer, size_t size) {
+    if (_recorder == NULL) {
+        return 0;
+    }
+    if (!_sending) {
+        startRequest();
+    }
+    captureRequest(buffer, size);
+    return _network != NULL ? _network->write(buffer, size) : size;
+}
+
+int OWM_RecorderClient::available() {
+    if (_network != NULL) {
+        return _network->available();
+    }
+    size_t ready = replayable();
+    return ready > _position ? ready - _position : 0;
+}
+
+int OWM_RecorderClient::read() {
+    uint8_t b;
+    return read(&b, 1) == 1 ? b : -1;
+}
+
+int OWM_RecorderClient::read(uint8_t* buffer, size_t size) {
+    if (_network != NULL) {
+        int n = _network->read(buffer, size);
+        if (n > 0) {
+            capture(buffer, n);
+        }
+        return n;
+    }
+
+    size_t ready = replayable();
+    if (ready <= _position) {
+        return -1;
+    }
+    size_t n = ready - _position;
+    if (n > size) {
+        n = size;
+    }
+    memcpy(buffer, _data + _position, n);
+    _position += n;
+    _sending = false;
+    return n;
+}
+
+int OWM_RecorderClient::peek() {
+    if (_network != NULL) {
+        return _network->peek();
+    }
+    return replayable() > _position ? _data[_position] : -1;
+}
+
+void OWM_RecorderClient::flush() {
+    if (_network != NULL) {
+        _network->flush();
+    }
+}
+
+void OWM_RecorderClient::stop() {
+    finishExchange();
+    if (_network != NULL) {
+        _network->stop();
+    }
+    _recorder = NULL;
+}
+
+uint8_t OWM_RecorderClient::connected() {
+    if (_recorder == NULL) {
+        return 0;
+    }
+    if (_network != NULL) {
+        return _network->connected();
+    }
+    // A replayed connection closes once its one response is consumed
+    if (!_lineDone) {
+        return 1;
+    }
+    return !_missed && _position < _length;
+}
+
+OWM_RecorderClient::operator bool() {
+    return connected();
+}
+
+void OWM_RecorderClient::startRequest() {
+    if (_pending) {
+        finishExchange();       // Next request on a kept-alive connection
+    }
+    _pending = true;
+    _sending = true;
+    _lineLength = 0;
+    _lineDone = false;
+    _length = 0;
+    _position = 0;
+    _missed = false;
+    _sentUs = micros();
+}
+
+void OWM_RecorderClient::captureRequest(const uint8_t* buffer, size_t size) {
+    for (size_t i = 0; i < size && !_lineDone; i++) {
+        if (buffer[i] != '\n') {
+            if (_lineLength < sizeof(_line) - 1) {
+                _line[_lineLength++] = buffer[i];
+            }
+            continue;
+        }
+
+        // "GET <path> HTTP/1.x": keep the path
+        _line[_lineLength] = '\0';
+        char* path = strchr(_line, ' ');
+        path = (path != NULL) ? path + 1 : _line;
+        char* version = strrchr(path, ' ');
+        if (version != NULL) {
+            *version = '\0';
+        }
+        memmove(_line, path, strlen(path) + 1);
+        stripApiKey(_line);
+        _lineDone = true;
+
+        if (_network == NULL) {
+            OWM_RecordedExchange exchange;
+            _sentUs = micros();
+            if (_recorder->take(_line, &exchange)) {
+                _data = exchange.data;
+                _length = exchange.length;
+                _connectUs = exchange.connectUs;
+                _ttfbUs = exchange.ttfbUs;
+                _totalUs = exchange.totalUs;
+            } else {
+                _missed = true;
+            }
+        }
+    }
+}
+
+void OWM_RecorderClient::capture(const uint8_t* buffer, size_t size) {
+    unsigned long now = micros();
+    if (_sending) {
+        _sending = false;
+        _ttfbUs = now - _sentUs;
+    }
+    _totalUs = now - _sentUs;
+
+    if (_length + size > _capacity) {
+        size_t capacity = _capacity > 0 ? _capacity : OWM_RECORD_INITIAL_BUFFER;
+        while (capacity < _length + size) {
+            capacity *= 2;
+        }
+        uint8_t* grown = (uint8_t*)realloc(_data, capacity);
+        if (grown == NULL) {
+            return;     // Out of memory: the recording of this response is cut
+        }
+        _data = grown;
+        _capacity = capacity;
+    }
+    memcpy(_data + _length, buffer, size);
+    _length += size;
+}
+
+void OWM_RecorderClient::finishExchange() {
+    if (!_pending) {
+        return;
+    }
+    _pending = false;
+    _sending = false;
+
+    if (_network != NULL) {
+        if (_lineDone && _recorder != NULL) {
+            _recorder->write(_line, _connectUs, _ttfbUs, _totalUs, _data, _length);
+        }
+        _connectUs = 0;         // Later requests reuse this connection
+        _length = 0;
+    } else {
+        free(_data);
+        _data = NULL;
+        _length = 0;
+        _position = 0;
+    }
+}
+
+size_t OWM_RecorderClient::replayable() {
+    if (_data == NULL || _recorder == NULL) {
+        return 0;
+    }
+    if (_recorder->timing() == OWM_REPLAY_FAST) {
+        return _length;
+    }
+
+    // Nothing until the recorded connect time and time to first byte
+    // have passed, then the rest at the recorded transfer rate
+    unsigned long elapsed = micros() - _sentUs;
+    unsigned long first = _connectUs + _ttfbUs;
+    if (elapsed < first) {
+        return 0;
+    }
+    unsigned long transfer = _totalUs > _ttfbUs ? _totalUs - _ttfbUs : 0;
+    if (elapsed - first >= transfer || _length == 0) {
+        return _length;
+    }
+    return 1 + (size_t)((uint64_t)(_length - 1) * (elapsed - first) / transfer);
+}
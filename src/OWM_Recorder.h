@@ -0,0 +1,191 @@
+/**
+ * @file OWM_Recorder.h
+ * @brief Record HTTP exchanges and replay them without a network
+ *
+ * Attach an OWM_Recorder to a client with OpenWeatherMap::setRecorder().
+ * While recording, every response the library receives is written to a
+ * Print (usually a File) together with its request path and timing. While
+ * replaying, no connection is made: each request is answered with the
+ * recorded response for the same path, either at once or with the
+ * recorded time to first byte and transfer time. A day of real traffic
+ * can be captured once and replayed to compare cache, parser and
+ * scheduler settings on identical input.
+ *
+ * The API key (appid) is removed from recorded paths, so recordings can
+ * be shared and replayed with any key. extras/mock_server serves the same
+ * files to other devices (--replay).
+ *
+ * File format, one entry per exchange:
+ *
+ *     OWMREC 1
+ *     > <ms> <connect us> <ttfb us> <total us> <length> <path>
+ *     <length bytes: status line, headers and body as received>
+ *
+ * ms is when the exchange ended, in millis() since recording started;
+ * connect is 0 for a request sent on a kept-alive connection.
+ */
+
+#ifndef OWM_RECORDER_H
+#define OWM_RECORDER_H
+
+#include "OpenWeatherMap.h"
+
+// First line of a recording
+#define OWM_RECORD_HEADER "OWMREC 1"
+
+// Longest request line kept (longer paths are cut)
+#define OWM_RECORD_MAX_LINE 400
+
+// Recorded exchanges held back while replay looks ahead for a path
+#define OWM_REPLAY_LOOKAHEAD 8
+
+// Replay speed
+enum OWM_ReplayTiming {
+    OWM_REPLAY_FAST,        // Every response is available at once
+    OWM_REPLAY_REALTIME     // Recorded connect time, time to first byte and transfer time
+};
+
+// One recorded exchange
+struct OWM_RecordedExchange {
+    char* path;                 // Request path without appid (heap)
+    uint8_t* data;              // Response as received (heap)
+    size_t length;
+    unsigned long connectUs;
+    unsigned long ttfbUs;
+    unsigned long totalUs;
+};
+
+class OWM_Recorder {
+public:
+    OWM_Recorder();
+    ~OWM_Recorder();
+
+    /**
+     * @brief Start recording every exchange to out
+     *
+     * out must stay valid until stop(). Nothing is written to it while
+     * a response is being received; each exchange is written whole when
+     * it ends.
+     */
+    void record(Print& out);
+
+    /**
+     * @brief Start answering requests from a recording
+     *
+     * Requests are matched by path in recording order. A request whose
+     * path does not come up within OWM_REPLAY_LOOKAHEAD entries (or after
+     * the end of the file) fails as if the connection was closed.
+     *
+     * @param in Recording; must stay valid until stop()
+     * @param timing Serve responses at once or with the recorded timing
+     * @return true on success, false if in is not a recording
+     */
+    bool replay(Stream& in, OWM_ReplayTiming timing = OWM_REPLAY_FAST);
+
+    /**
+     * @brief Stop recording or replaying
+     */
+    void stop();
+
+    bool recording() const;
+    bool replaying() const;
+    OWM_ReplayTiming timing() const;
+
+    /**
+     * @brief Exchanges recorded or replayed so far
+     */
+    uint32_t exchanges() const;
+
+    /**
+     * @brief Requests that had no recorded response while replaying
+     */
+    uint32_t misses() const;
+
+    /**
+     * @brief Write one exchange to the recording (called by the library)
+     */
+    void write(const char* path, unsigned long connectUs, unsigned long ttfbUs,
+               unsigned long totalUs, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Take the next recorded exchange for path (called by the library)
+     *
+     * On success the caller owns exchange->data and must free() it;
+     * exchange->path is NULL.
+     */
+    bool take(const char* path, OWM_RecordedExchange* exchange);
+
+private:
+    Print* _out;
+    Stream* _in;
+    OWM_ReplayTiming _timing;
+    unsigned long _startMs;
+    uint32_t _exchanges;
+    uint32_t _misses;
+    OWM_RecordedExchange _pending[OWM_REPLAY_LOOKAHEAD];   // Read ahead, oldest first
+    uint8_t _pendingCount;
+
+    bool readEntry(OWM_RecordedExchange* exchange);
+    void dropPending(uint8_t index);
+};
+
+/**
+ * @brief Connection used while recording or replaying (used by the library)
+ *
+ * Recording: forwards everything to the network client and keeps a copy
+ * of the response. Replaying: answers from the recorder.
+ */
+class OWM_RecorderClient : public Client {
+public:
+    OWM_RecorderClient();
+    virtual ~OWM_RecorderClient();
+
+    void beginRecord(OWM_Recorder* recorder, Client* network, unsigned long connectUs);
+    void beginReplay(OWM_Recorder* recorder);
+
+    int connect(IPAddress ip, uint16_t port);
+    int connect(const char* host, uint16_t port);
+#if defined(ESP32)
+    int connect(IPAddress ip, uint16_t port, int32_t timeout);
+    int connect(const char* host, uint16_t port, int32_t timeout);
+#endif
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buffer, size_t size);
+    int available();
+    int read();
+    int read(uint8_t* buffer, size_t size);
+    int peek();
+    void flush();
+    void stop();
+    uint8_t connected();
+    operator bool();
+
+    using Print::write;
+
+private:
+    OWM_Recorder* _recorder;
+    Client* _network;               // NULL when replaying
+    char _line[OWM_RECORD_MAX_LINE];  // Request line being written
+    size_t _lineLength;
+    bool _lineDone;                 // _line holds the whole request path
+    bool _sending;                  // Between the first request byte and the first response byte
+    bool _pending;                  // An exchange has started and was not finished yet
+    uint8_t* _data;                 // Response (received or replayed)
+    size_t _length;
+    size_t _capacity;
+    size_t _position;               // Replay: next byte to serve
+    bool _missed;                   // Replay: no recording for the request
+    unsigned long _connectUs;
+    unsigned long _sentUs;          // micros() when the request started
+    unsigned long _ttfbUs;
+    unsigned long _totalUs;
+
+    void reset();
+    void startRequest();
+    void captureRequest(const uint8_t* buffer, size_t size);
+    void capture(const uint8_t* buffer, size_t size);
+    void finishExchange();
+    size_t replayable();
+};
+
+#endif // OWM_RECORDER_H
@@ -0,0 +1,362 @@
+/**
+ * @file OWM_Scheduler.cpp
+ * @brief Periodic refresh scheduler implementation
+ */
+
+#include "OWM_Scheduler.h"
+
+// Length of a budget day (ms)
+#define OWM_DAY_MS 86400000UL
+
+// Forecast items (3 h each) that make up the precipitation outlook
+#define OWM_OUTLOOK_ITEMS 2
+
+// Due times are compared as signed differences so millis() may wrap
+static inline bool dueBy(unsigned long due, unsigned long time) {
+    return (long)(due - time) <= 0;
+}
+
+// Change between two readings, in steps
+static inline float steps(float a, float b, float step) {
+    return fabs(a - b) / step;
+}
+
+OWM_Scheduler::OWM_Scheduler(OpenWeatherMap& client) {
+    _client = &client;
+    memset(_tasks, 0, sizeof(_tasks));
+    _jitterPercent = OWM_DEFAULT_JITTER_PERCENT;
+    _coalesceWindow = OWM_DEFAULT_COALESCE_WINDOW;
+    _startSpread = 0;
+    _callback = NULL;
+    _userData = NULL;
+    _dailyBudget = 0;
+    _callsToday = 0;
+    _dayStart = millis();
+}
+
+int OWM_Scheduler::addCurrentWeather(float lat, float lon, OWM_CurrentWeather* result,
+                                     unsigned long period) {
+    return addTask(OWM_ENDPOINT_CURRENT_WEATHER, lat, lon, 0, result, period);
+}
+
+int OWM_Scheduler::addAirPollution(float lat, float lon, OWM_AirPollution* result,
+                                   unsigned long period) {
+    return addTask(OWM_ENDPOINT_AIR_POLLUTION, lat, lon, 0, result, period);
+}
+
+int OWM_Scheduler::addForecast(float lat, float lon, OWM_Forecast* result,
+                               unsigned long period, int cnt) {
+    return addTask(OWM_ENDPOINT_FORECAST, lat, lon, cnt, result, period);
+}
+
+int OWM_Scheduler::addTask(OWM_Endpoint endpoint, float lat, float lon, int cnt,
+                           void* result, unsigned long period) {
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+        Task& t = _tasks[i];
+        if (t.used) {
+            continue;
+        }
+        t.used = true;
+        t.endpoint = endpoint;
+        t.lat = lat;
+        t.lon = lon;
+        t.cnt = cnt;
+        t.result = result;
+        t.period = period;
+        t.minPeriod = 0;
+        t.maxPeriod = 0;
+        t.hasLast = false;
+        t.pop = 0;
+        t.due = millis();
+        if (_startSpread > 0) {
+            t.due += random(_startSpread + 1);
+        }
+        t.status = OWM_STATUS_CANCELLED;
+        return i;
+    }
+    return -1;
+}
+
+bool OWM_Scheduler::remove(int task) {
+    if (!isValid(task)) {
+        return false;
+    }
+    _tasks[task].used = false;
+    return true;
+}
+
+void OWM_Scheduler::setLocation(int task, float lat, float lon) {
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+        if ((task == OWM_ALL_TASKS || task == i) && _tasks[i].used) {
+            _tasks[i].lat = lat;
+            _tasks[i].lon = lon;
+        }
+    }
+}
+
+void OWM_Scheduler::refreshNow(int task) {
+    unsigned long now = millis();
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+        if ((task == OWM_ALL_TASKS || task == i) && _tasks[i].used) {
+            _tasks[i].due = now;
+        }
+    }
+}
+
+bool OWM_Scheduler::setAdaptive(int task, unsigned long minPeriod, unsigned long maxPeriod) {
+    if (!isValid(task) || minPeriod == 0 || minPeriod > maxPeriod) {
+        return false;
+    }
+    Task& t = _tasks[task];
+    t.minPeriod = minPeriod;
+    t.maxPeriod = maxPeriod;
+    t.period = constrain(t.period, minPeriod, maxPeriod);
+    return true;
+}
+
+void OWM_Scheduler::setDailyBudget(unsigned long calls) {
+    _dailyBudget = calls;
+}
+
+unsigned long OWM_Scheduler::getPeriod(int task) const {
+    return isValid(task) ? _tasks[task].period : 0;
+}
+
+unsigned long OWM_Scheduler::getCallsToday() const {
+    return _callsToday;
+}
+
+void OWM_Scheduler::setJitter(uint8_t percent) {
+    _jitterPercent = percent > 100 ? 100 : percent;
+}
+
+void OWM_Scheduler::setCoalesceWindow(unsigned long window) {
+    _coalesceWindow = window;
+}
+
+void OWM_Scheduler::setStartSpread(unsigned long spread) {
+    _startSpread = spread;
+}
+
+void OWM_Scheduler::onRefresh(RefreshCallback callback, void* userData) {
+    _callback = callback;
+    _userData = userData;
+}
+
+int OWM_Scheduler::update() {
+    unsigned long now = millis();
+
+    bool anyDue = false;
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS && !anyDue; i++) {
+        anyDue = _tasks[i].used && dueBy(_tasks[i].due, now);
+    }
+    if (!anyDue) {
+        _client->refreshDns();      // Idle: keep the server address fresh
+        return 0;
+    }
+
+    // Budget used up: nothing runs until the next day
+    if (!startDay(now)) {
+        for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+            if (_tasks[i].used && dueBy(_tasks[i].due, now)) {
+                _tasks[i].due = _dayStart + OWM_DAY_MS;
+            }
+        }
+        return 0;
+    }
+
+    // Everything due now or within the window goes into one batch, up to
+    // the calls left today. Tasks due now come first; the ones left out
+    // stay due and wait for the next update() (or the next day).
+    unsigned long allowed = OWM_SCHEDULER_MAX_TASKS;
+    if (_dailyBudget > 0 && _dailyBudget - _callsToday < allowed) {
+        allowed = _dailyBudget - _callsToday;
+    }
+    OWM_Request requests[OWM_SCHEDULER_MAX_TASKS];
+    int taskOf[OWM_SCHEDULER_MAX_TASKS];
+    int count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS && (unsigned long)count < allowed; i++) {
+            const Task& t = _tasks[i];
+            if (!t.used || dueBy(t.due, now) != (pass == 0) ||
+                !dueBy(t.due, now + _coalesceWindow)) {
+                continue;
+            }
+            OWM_Request& r = requests[count];
+            r.endpoint = t.endpoint;
+            r.lat = t.lat;
+            r.lon = t.lon;
+            r.cnt = t.cnt;
+            r.result = t.result;
+            taskOf[count++] = i;
+        }
+    }
+
+    _client->fetchRequests(requests, count);
+
+    for (int n = 0; n < count; n++) {
+        Task& t = _tasks[taskOf[n]];
+        t.status = requests[n].status;
+        if (t.status != OWM_STATUS_CACHED && t.status != OWM_STATUS_CANCELLED &&
+            t.status != OWM_STATUS_CONNECTION_FAILED) {
+            _callsToday++;
+        }
+        if (t.status == OWM_STATUS_OK) {
+            adapt(t);
+        }
+    }
+
+    float scale = budgetScale(now);
+    for (int n = 0; n < count; n++) {
+        Task& t = _tasks[taskOf[n]];
+        unsigned long wait = t.period;
+        if (t.status != OWM_STATUS_OK && t.status != OWM_STATUS_CACHED &&
+            wait > OWM_SCHEDULER_RETRY_DELAY) {
+            wait = OWM_SCHEDULER_RETRY_DELAY;
+        }
+        if (scale > 1) {
+            wait = (unsigned long)min((float)OWM_DAY_MS, wait * scale);
+        }
+        t.due = now + jitter(wait);
+    }
+
+    // Callbacks last, so they may add, remove or move tasks
+    if (_callback != NULL) {
+        for (int n = 0; n < count; n++) {
+            _callback(taskOf[n], requests[n].status, _userData);
+        }
+    }
+    return count;
+}
+
+unsigned long OWM_Scheduler::timeUntilNext() const {
+    unsigned long now = millis();
+    unsigned long next = 0xFFFFFFFFUL;
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+        const Task& t = _tasks[i];
+        if (!t.used) {
+            continue;
+        }
+        if (dueBy(t.due, now)) {
+            return 0;
+        }
+        if (t.due - now < next) {
+            next = t.due - now;
+        }
+    }
+    return next;
+}
+
+OWM_Status OWM_Scheduler::getStatus(int task) const {
+    return isValid(task) ? _tasks[task].status : OWM_STATUS_CANCELLED;
+}
+
+void OWM_Scheduler::adapt(Task& t) {
+    if (t.endpoint == OWM_ENDPOINT_FORECAST) {
+        const OWM_Forecast* f = (const OWM_Forecast*)t.result;
+        t.pop = 0;
+        for (int i = 0; i < f->cnt && i < OWM_OUTLOOK_ITEMS; i++) {
+            t.pop = max(t.pop, f->items[i].pop);
+        }
+        return;
+    }
+
+    float score = volatility(t);
+    if (t.minPeriod == 0 || score < 0) {
+        return;
+    }
+
+    // Rain on the way: weather is about to change
+    if (t.endpoint == OWM_ENDPOINT_CURRENT_WEATHER &&
+        upcomingPop(t) >= OWM_ADAPTIVE_POP_THRESHOLD) {
+        score = max(score, 1.0f);
+    }
+
+    if (score >= 1) {
+        t.period /= 2;
+    } else if (score < 0.25f) {
+        t.period += t.period / 2;
+    }
+    t.period = constrain(t.period, t.minPeriod, t.maxPeriod);
+}
+
+float OWM_Scheduler::volatility(Task& t) {
+    float values[4] = {0, 0, 0, 0};
+    if (t.endpoint == OWM_ENDPOINT_CURRENT_WEATHER) {
+        const OWM_CurrentWeather* w = (const OWM_CurrentWeather*)t.result;
+        values[0] = w->main.temp;
+        values[1] = w->main.pressure;
+        values[2] = w->wind.speed;
+    } else {
+        const OWM_AirPollution* a = (const OWM_AirPollution*)t.result;
+        values[0] = a->aqi;
+        values[1] = a->components.pm2_5;
+    }
+
+    // Largest change of any value since the last refresh, -1 for the first
+    float score = -1;
+    if (t.hasLast) {
+        if (t.endpoint == OWM_ENDPOINT_CURRENT_WEATHER) {
+            score = max(steps(values[0], t.last[0], OWM_ADAPTIVE_TEMP_STEP),
+                        max(steps(values[1], t.last[1], OWM_ADAPTIVE_PRESSURE_STEP),
+                            steps(values[2], t.last[2], OWM_ADAPTIVE_WIND_STEP)));
+        } else {
+            score = max(steps(values[0], t.last[0], 1.0f),
+                        steps(values[1], t.last[1], OWM_ADAPTIVE_PM2_5_STEP));
+        }
+    }
+
+    memcpy(t.last, values, sizeof(values));
+    t.hasLast = true;
+    return score;
+}
+
+float OWM_Scheduler::upcomingPop(const Task& t) const {
+    float pop = 0;
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+        const Task& f = _tasks[i];
+        if (f.used && f.endpoint == OWM_ENDPOINT_FORECAST &&
+            fabs(f.lat - t.lat) < 0.01 && fabs(f.lon - t.lon) < 0.01) {
+            pop = max(pop, f.pop);
+        }
+    }
+    return pop;
+}
+
+bool OWM_Scheduler::startDay(unsigned long now) {
+    if (now - _dayStart >= OWM_DAY_MS) {
+        _dayStart += (now - _dayStart) / OWM_DAY_MS * OWM_DAY_MS;
+        _callsToday = 0;
+    }
+    return _dailyBudget == 0 || _callsToday < _dailyBudget;
+}
+
+float OWM_Scheduler::budgetScale(unsigned long now) const {
+    if (_dailyBudget == 0 || _callsToday >= _dailyBudget) {
+        return 1;
+    }
+
+    // Calls the current periods would make in the rest of the day
+    float left = (float)(_dayStart + OWM_DAY_MS - now);
+    float projected = 0;
+    for (int i = 0; i < OWM_SCHEDULER_MAX_TASKS; i++) {
+        if (_tasks[i].used && _tasks[i].period > 0) {
+            projected += left / _tasks[i].period;
+        }
+    }
+
+    float remaining = (float)(_dailyBudget - _callsToday);
+    return projected > remaining ? projected / remaining : 1;
+}
+
+unsigned long OWM_Scheduler::jitter(unsigned long wait) const {
+    unsigned long range = wait / 100 * _jitterPercent;
+    if (range == 0) {
+        return wait;
+    }
+    return wait - range + random(2 * range + 1);
+}
+
+bool OWM_Scheduler::isValid(int task) const {
+    return task >= 0 && task < OWM_SCHEDULER_MAX_TASKS && _tasks[task].used;
+}
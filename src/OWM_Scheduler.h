@@ -0,0 +1,237 @@
+/**
+ * @file OWM_Scheduler.h
+ * @brief Periodic refresh of registered locations and endpoints
+ *
+ * OWM_Scheduler replaces hand-written millis() intervals. Each task is one
+ * endpoint (current weather, air quality or forecast) for one location,
+ * refreshed into a caller-owned result every period. Call update() from
+ * loop():
+ * - Every due time is jittered by up to +/- setJitter() percent of the
+ *   period, so devices that booted together drift apart instead of
+ *   polling the API in the same second.
+ * - setStartSpread() delays each task's first refresh by a random amount,
+ *   for fleets that power up at the same time.
+ * - When a task is due, every task due within setCoalesceWindow() is
+ *   pulled forward and all of them run as one concurrent batch
+ *   (OpenWeatherMap::fetchRequests()).
+ * - While no task is due, update() keeps the server address in the DNS
+ *   cache fresh (OpenWeatherMap::refreshDns()).
+ *
+ * Tasks made adaptive with setAdaptive() change their period after every
+ * refresh: it is halved when the data moved by more than one step (see
+ * the OWM_ADAPTIVE_* steps), or when the forecast for the same location
+ * expects rain within 6 hours, and grows by half when the data barely
+ * moved. setDailyBudget() caps the number of API calls per day; periods
+ * are stretched as needed to stay within it.
+ *
+ * Jitter uses random(); seed it (randomSeed()) with something unique per
+ * device on boards without a hardware random number generator.
+ */
+
+#ifndef OWM_SCHEDULER_H
+#define OWM_SCHEDULER_H
+
+#include "OpenWeatherMap.h"
+
+// Maximum number of tasks per scheduler
+#define OWM_SCHEDULER_MAX_TASKS 8
+
+// Default jitter (percent of the period)
+#define OWM_DEFAULT_JITTER_PERCENT 10
+
+// Default coalescing window (ms)
+#define OWM_DEFAULT_COALESCE_WINDOW 30000
+
+// Delay before retrying a failed refresh, if shorter than the period (ms)
+#define OWM_SCHEDULER_RETRY_DELAY 60000
+
+// Task id meaning "every task"
+#define OWM_ALL_TASKS -1
+
+// Change that counts as one step of volatility for adaptive tasks
+#define OWM_ADAPTIVE_TEMP_STEP 1.0f        // Temperature (degrees)
+#define OWM_ADAPTIVE_PRESSURE_STEP 1.0f    // Pressure (hPa)
+#define OWM_ADAPTIVE_WIND_STEP 1.5f        // Wind speed
+#define OWM_ADAPTIVE_PM2_5_STEP 5.0f       // PM2.5 (μg/m³); any AQI change is one step
+
+// Probability of precipitation that shortens current weather periods
+#define OWM_ADAPTIVE_POP_THRESHOLD 0.5f
+
+class OWM_Scheduler {
+public:
+    /**
+     * @brief Called for every task refreshed by update()
+     * @param task Task id returned by the add*() method
+     * @param status Outcome; the result is only valid for OK and CACHED
+     * @param userData User pointer passed to onRefresh()
+     */
+    typedef void (*RefreshCallback)(int task, OWM_Status status, void* userData);
+
+    /**
+     * @brief Construct a scheduler that refreshes through client
+     */
+    OWM_Scheduler(OpenWeatherMap& client);
+
+    /**
+     * @brief Refresh current weather for a location every period
+     * @param lat Latitude
+     * @param lon Longitude
+     * @param result Weather structure kept up to date
+     * @param period Refresh period (ms)
+     * @return Task id, or -1 if the scheduler is full
+     */
+    int addCurrentWeather(float lat, float lon, OWM_CurrentWeather* result,
+                          unsigned long period);
+
+    /**
+     * @brief Refresh current air quality for a location every period
+     * @return Task id, or -1 if the scheduler is full
+     */
+    int addAirPollution(float lat, float lon, OWM_AirPollution* result,
+                        unsigned long period);
+
+    /**
+     * @brief Refresh the 5-day forecast for a location every period
+     * @param cnt Number of timestamps (0 for all)
+     * @return Task id, or -1 if the scheduler is full
+     */
+    int addForecast(float lat, float lon, OWM_Forecast* result,
+                    unsigned long period, int cnt = 0);
+
+    /**
+     * @brief Stop refreshing a task (its id may be reused)
+     * @return true on success, false if no such task
+     */
+    bool remove(int task);
+
+    /**
+     * @brief Move a task (or OWM_ALL_TASKS) to a new location
+     *
+     * Does not change when the task is due; combine with refreshNow().
+     */
+    void setLocation(int task, float lat, float lon);
+
+    /**
+     * @brief Make a task (or OWM_ALL_TASKS) due immediately
+     */
+    void refreshNow(int task);
+
+    /**
+     * @brief Let a task's period follow how fast its data changes
+     *
+     * The period given when the task was added is the starting point.
+     * Forecast tasks keep their period but supply the precipitation
+     * outlook for current weather tasks at the same location.
+     *
+     * @param minPeriod Shortest period (ms)
+     * @param maxPeriod Longest period (ms)
+     * @return true on success, false if no such task or min > max
+     */
+    bool setAdaptive(int task, unsigned long minPeriod, unsigned long maxPeriod);
+
+    /**
+     * @brief Limit the number of API calls per day
+     *
+     * Periods of all tasks are stretched when the current rate would
+     * exceed what is left of the budget; once it is used up no refresh
+     * runs until the current day (24 h periods counted from the
+     * scheduler's creation) is over. A coalesced batch never holds more
+     * requests than calls are left. Cached results and failed
+     * connections do not count.
+     *
+     * @param calls Calls per day (0 for no limit)
+     */
+    void setDailyBudget(unsigned long calls);
+
+    /**
+     * @brief Get a task's current period (ms), before jitter
+     */
+    unsigned long getPeriod(int task) const;
+
+    /**
+     * @brief Get the number of API calls made in the current day
+     */
+    unsigned long getCallsToday() const;
+
+    /**
+     * @brief Set the random variation of every due time
+     * @param percent Maximum shift, in percent of the period (0 to disable)
+     */
+    void setJitter(uint8_t percent);
+
+    /**
+     * @brief Set how far ahead due tasks are pulled into the current batch
+     * @param window Window in milliseconds (0 to run only tasks already due)
+     */
+    void setCoalesceWindow(unsigned long window);
+
+    /**
+     * @brief Delay the first refresh of tasks added afterwards
+     * @param spread Maximum random delay in milliseconds (default 0)
+     */
+    void setStartSpread(unsigned long spread);
+
+    /**
+     * @brief Set the function called after each task is refreshed
+     */
+    void onRefresh(RefreshCallback callback, void* userData = NULL);
+
+    /**
+     * @brief Run every task that is due; call from loop()
+     * @return Number of tasks refreshed (0 if none was due)
+     */
+    int update();
+
+    /**
+     * @brief Milliseconds until the next task is due
+     * @return 0 if a task is due now, 0xFFFFFFFF if there are no tasks
+     */
+    unsigned long timeUntilNext() const;
+
+    /**
+     * @brief Outcome of the last refresh of a task
+     * @return OWM_STATUS_CANCELLED before the first refresh
+     */
+    OWM_Status getStatus(int task) const;
+
+private:
+    struct Task {
+        bool used;
+        OWM_Endpoint endpoint;
+        float lat;
+        float lon;
+        int cnt;
+        void* result;
+        unsigned long period;     // Current period
+        unsigned long minPeriod;  // Adaptive bounds, 0 if the period is fixed
+        unsigned long maxPeriod;
+        unsigned long due;
+        OWM_Status status;
+        bool hasLast;             // last[] holds the previous values
+        float last[4];            // Values compared between refreshes
+        float pop;                // Forecast tasks: rain chance in the next 6 h
+    };
+
+    OpenWeatherMap* _client;
+    Task _tasks[OWM_SCHEDULER_MAX_TASKS];
+    uint8_t _jitterPercent;
+    unsigned long _coalesceWindow;
+    unsigned long _startSpread;
+    RefreshCallback _callback;
+    void* _userData;
+    unsigned long _dailyBudget;
+    unsigned long _callsToday;
+    unsigned long _dayStart;
+
+    int addTask(OWM_Endpoint endpoint, float lat, float lon, int cnt, void* result,
+                unsigned long period);
+    void adapt(Task& t);
+    float volatility(Task& t);
+    float upcomingPop(const Task& t) const;
+    bool startDay(unsigned long now);
+    float budgetScale(unsigned long now) const;
+    unsigned long jitter(unsigned long wait) const;
+    bool isValid(int task) const;
+};
+
+#endif // OWM_SCHEDULER_H
@@ -0,0 +1,251 @@
+/**
+ * @file OWM_Schema.cpp
+ * @brief Key lookup and response field tables
+ */
+
+#include "OWM_Schema.h"
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+static const char* const kKeyNames[OWM_KEY_COUNT] = {
+    "",
+#define OWM_KEY_STRING(id, name) name,
+    OWM_JSON_KEYS(OWM_KEY_STRING)
+#undef OWM_KEY_STRING
+};
+
+static uint32_t keyHash(const char* key, size_t length) {
+    uint32_t hash = 2166136261UL;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+uint8_t owmJsonKeyId(const char* key, size_t length) {
+    uint8_t id;
+
+    // The compiler turns this into a jump table or binary search; a
+    // collision between two known keys would not compile
+    switch (keyHash(key, length)) {
+#define OWM_KEY_CASE(key_, name) case owmKeyHash(name): id = OWM_KEY_##key_; break;
+        OWM_JSON_KEYS(OWM_KEY_CASE)
+#undef OWM_KEY_CASE
+        default:
+            return OWM_KEY_UNKNOWN;
+    }
+
+    // An unknown key may still share a hash with a known one
+    const char* name = kKeyNames[id];
+    if (strncmp(name, key, length) != 0 || name[length] != '\0') {
+        return OWM_KEY_UNKNOWN;
+    }
+    return id;
+}
+
+const char* owmJsonKeyName(uint8_t id) {
+    return id < OWM_KEY_COUNT ? kKeyNames[id] : "";
+}
+
+// ============================================================================
+// Field Access
+// ============================================================================
+
+const OWM_Field* owmFindField(const OWM_FieldTable* table, uint8_t key) {
+    if (key == OWM_KEY_UNKNOWN) {
+        return NULL;
+    }
+    for (uint8_t i = 0; i < table->count; i++) {
+        if (table->fields[i].key == key) {
+            return &table->fields[i];
+        }
+    }
+    return NULL;
+}
+
+void owmStoreInt(void* dest, uint8_t size, long value) {
+    switch (size) {
+        case 1: { int8_t v = (int8_t)value; memcpy(dest, &v, 1); break; }
+        case 2: { int16_t v = (int16_t)value; memcpy(dest, &v, 2); break; }
+        case 4: { int32_t v = (int32_t)value; memcpy(dest, &v, 4); break; }
+        case 8: { int64_t v = value; memcpy(dest, &v, 8); break; }
+    }
+}
+
+// ============================================================================
+// Shared Fragments
+// ============================================================================
+
+static const OWM_Field kConditionFields[] = {
+    OWM_FIELD_ENTRY(OWM_WeatherCondition, ID, OWM_FIELD_INT, id),
+    OWM_FIELD_ENTRY(OWM_WeatherCondition, MAIN, OWM_FIELD_STRING, main),
+    OWM_FIELD_ENTRY(OWM_WeatherCondition, DESCRIPTION, OWM_FIELD_STRING, description),
+    OWM_FIELD_ENTRY(OWM_WeatherCondition, ICON, OWM_FIELD_STRING, icon),
+};
+static OWM_FIELD_TABLE(kCondition, kConditionFields);
+
+static const OWM_Field kMainDataFields[] = {
+    OWM_FIELD_ENTRY(OWM_MainData, TEMP, OWM_FIELD_FLOAT, temp),
+    OWM_FIELD_ENTRY(OWM_MainData, FEELS_LIKE, OWM_FIELD_FLOAT, feels_like),
+    OWM_FIELD_ENTRY(OWM_MainData, TEMP_MIN, OWM_FIELD_FLOAT, temp_min),
+    OWM_FIELD_ENTRY(OWM_MainData, TEMP_MAX, OWM_FIELD_FLOAT, temp_max),
+    OWM_FIELD_ENTRY(OWM_MainData, PRESSURE, OWM_FIELD_INT, pressure),
+    OWM_FIELD_ENTRY(OWM_MainData, HUMIDITY, OWM_FIELD_INT, humidity),
+    OWM_FIELD_ENTRY(OWM_MainData, SEA_LEVEL, OWM_FIELD_INT, sea_level),
+    OWM_FIELD_ENTRY(OWM_MainData, GRND_LEVEL, OWM_FIELD_INT, grnd_level),
+};
+static OWM_FIELD_TABLE(kMainData, kMainDataFields);
+
+static const OWM_Field kWindDataFields[] = {
+    OWM_FIELD_ENTRY(OWM_WindData, SPEED, OWM_FIELD_FLOAT, speed),
+    OWM_FIELD_ENTRY(OWM_WindData, DEG, OWM_FIELD_INT, deg),
+    OWM_FIELD_ENTRY(OWM_WindData, GUST, OWM_FIELD_FLOAT, gust),
+};
+static OWM_FIELD_TABLE(kWindData, kWindDataFields);
+
+static const OWM_Field kAirComponentsFields[] = {
+    OWM_FIELD_ENTRY(OWM_AirComponents, CO, OWM_FIELD_FLOAT, co),
+    OWM_FIELD_ENTRY(OWM_AirComponents, NO, OWM_FIELD_FLOAT, no),
+    OWM_FIELD_ENTRY(OWM_AirComponents, NO2, OWM_FIELD_FLOAT, no2),
+    OWM_FIELD_ENTRY(OWM_AirComponents, O3, OWM_FIELD_FLOAT, o3),
+    OWM_FIELD_ENTRY(OWM_AirComponents, SO2, OWM_FIELD_FLOAT, so2),
+    OWM_FIELD_ENTRY(OWM_AirComponents, PM2_5, OWM_FIELD_FLOAT, pm2_5),
+    OWM_FIELD_ENTRY(OWM_AirComponents, PM10, OWM_FIELD_FLOAT, pm10),
+    OWM_FIELD_ENTRY(OWM_AirComponents, NH3, OWM_FIELD_FLOAT, nh3),
+};
+static OWM_FIELD_TABLE(kAirComponents, kAirComponentsFields);
+
+// ============================================================================
+// /data/2.5/weather
+// ============================================================================
+
+static const OWM_Field kWeatherCoordFields[] = {
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, LAT, OWM_FIELD_FLOAT, lat),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, LON, OWM_FIELD_FLOAT, lon),
+};
+static OWM_FIELD_TABLE(kWeatherCoord, kWeatherCoordFields);
+
+static const OWM_Field kWeatherCloudsFields[] = {
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, ALL, OWM_FIELD_INT, clouds),
+};
+static OWM_FIELD_TABLE(kWeatherClouds, kWeatherCloudsFields);
+
+static const OWM_Field kWeatherRainFields[] = {
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, 1H, OWM_FIELD_FLOAT, rain_1h),
+};
+static OWM_FIELD_TABLE(kWeatherRain, kWeatherRainFields);
+
+static const OWM_Field kWeatherSnowFields[] = {
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, 1H, OWM_FIELD_FLOAT, snow_1h),
+};
+static OWM_FIELD_TABLE(kWeatherSnow, kWeatherSnowFields);
+
+static const OWM_Field kWeatherSysFields[] = {
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, COUNTRY, OWM_FIELD_STRING, country),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, SUNRISE, OWM_FIELD_ULONG, sunrise),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, SUNSET, OWM_FIELD_ULONG, sunset),
+};
+static OWM_FIELD_TABLE(kWeatherSys, kWeatherSysFields);
+
+static const OWM_Field kCurrentWeatherFields[] = {
+    OWM_FLAT_ENTRY(COORD, kWeatherCoord),
+    OWM_FIRST_ENTRY(OWM_CurrentWeather, WEATHER, weather, kCondition),
+    OWM_OBJECT_ENTRY(OWM_CurrentWeather, MAIN, main, kMainData),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, VISIBILITY, OWM_FIELD_INT, visibility),
+    OWM_OBJECT_ENTRY(OWM_CurrentWeather, WIND, wind, kWindData),
+    OWM_FLAT_ENTRY(CLOUDS, kWeatherClouds),
+    OWM_FLAT_ENTRY(RAIN, kWeatherRain),
+    OWM_FLAT_ENTRY(SNOW, kWeatherSnow),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, DT, OWM_FIELD_ULONG, dt),
+    OWM_FLAT_ENTRY(SYS, kWeatherSys),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, TIMEZONE, OWM_FIELD_INT, timezone),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, ID, OWM_FIELD_ULONG, id),
+    OWM_FIELD_ENTRY(OWM_CurrentWeather, NAME, OWM_FIELD_STRING, name),
+};
+OWM_FIELD_TABLE(owmCurrentWeatherSchema, kCurrentWeatherFields);
+
+// ============================================================================
+// /data/2.5/forecast
+// ============================================================================
+
+static const OWM_Field kItemCloudsFields[] = {
+    OWM_FIELD_ENTRY(OWM_ForecastItem, ALL, OWM_FIELD_INT, clouds),
+};
+static OWM_FIELD_TABLE(kItemClouds, kItemCloudsFields);
+
+static const OWM_Field kItemRainFields[] = {
+    OWM_FIELD_ENTRY(OWM_ForecastItem, 3H, OWM_FIELD_FLOAT, rain_3h),
+};
+static OWM_FIELD_TABLE(kItemRain, kItemRainFields);
+
+static const OWM_Field kItemSnowFields[] = {
+    OWM_FIELD_ENTRY(OWM_ForecastItem, 3H, OWM_FIELD_FLOAT, snow_3h),
+};
+static OWM_FIELD_TABLE(kItemSnow, kItemSnowFields);
+
+static const OWM_Field kForecastItemFields[] = {
+    OWM_FIELD_ENTRY(OWM_ForecastItem, DT, OWM_FIELD_ULONG, dt),
+    OWM_OBJECT_ENTRY(OWM_ForecastItem, MAIN, main, kMainData),
+    OWM_FIRST_ENTRY(OWM_ForecastItem, WEATHER, weather, kCondition),
+    OWM_OBJECT_ENTRY(OWM_ForecastItem, WIND, wind, kWindData),
+    OWM_FLAT_ENTRY(CLOUDS, kItemClouds),
+    OWM_FIELD_ENTRY(OWM_ForecastItem, VISIBILITY, OWM_FIELD_INT, visibility),
+    OWM_FIELD_ENTRY(OWM_ForecastItem, POP, OWM_FIELD_FLOAT, pop),
+    OWM_FLAT_ENTRY(RAIN, kItemRain),
+    OWM_FLAT_ENTRY(SNOW, kItemSnow),
+    OWM_FIELD_ENTRY(OWM_ForecastItem, DT_TXT, OWM_FIELD_STRING, dt_txt),
+};
+OWM_FIELD_TABLE(owmForecastItemSchema, kForecastItemFields);
+
+static const OWM_Field kCityCoordFields[] = {
+    OWM_FIELD_ENTRY(OWM_Forecast, LAT, OWM_FIELD_FLOAT, lat),
+    OWM_FIELD_ENTRY(OWM_Forecast, LON, OWM_FIELD_FLOAT, lon),
+};
+static OWM_FIELD_TABLE(kCityCoord, kCityCoordFields);
+
+static const OWM_Field kCityFields[] = {
+    OWM_FIELD_ENTRY(OWM_Forecast, NAME, OWM_FIELD_STRING, city_name),
+    OWM_FIELD_ENTRY(OWM_Forecast, COUNTRY, OWM_FIELD_STRING, country),
+    OWM_FLAT_ENTRY(COORD, kCityCoord),
+    OWM_FIELD_ENTRY(OWM_Forecast, TIMEZONE, OWM_FIELD_INT, timezone),
+    OWM_FIELD_ENTRY(OWM_Forecast, SUNRISE, OWM_FIELD_ULONG, sunrise),
+    OWM_FIELD_ENTRY(OWM_Forecast, SUNSET, OWM_FIELD_ULONG, sunset),
+};
+static OWM_FIELD_TABLE(kCity, kCityFields);
+
+static const OWM_Field kForecastFields[] = {
+    OWM_FIELD_ENTRY(OWM_Forecast, CNT, OWM_FIELD_INT, cnt),
+    OWM_FLAT_ENTRY(CITY, kCity),
+};
+OWM_FIELD_TABLE(owmForecastSchema, kForecastFields);
+
+// ============================================================================
+// /data/2.5/air_pollution
+// ============================================================================
+
+static const OWM_Field kAqiFields[] = {
+    OWM_FIELD_ENTRY(OWM_AirPollution, AQI, OWM_FIELD_INT, aqi),
+};
+static OWM_FIELD_TABLE(kAqi, kAqiFields);
+
+static const OWM_Field kAirPollutionFields[] = {
+    OWM_FIELD_ENTRY(OWM_AirPollution, DT, OWM_FIELD_ULONG, dt),
+    OWM_FLAT_ENTRY(MAIN, kAqi),
+    OWM_OBJECT_ENTRY(OWM_AirPollution, COMPONENTS, components, kAirComponents),
+};
+OWM_FIELD_TABLE(owmAirPollutionSchema, kAirPollutionFields);
+
+// ============================================================================
+// /geo/1.0
+// ============================================================================
+
+static const OWM_Field kGeoLocationFields[] = {
+    OWM_FIELD_ENTRY(OWM_GeoLocation, NAME, OWM_FIELD_STRING, name),
+    OWM_FIELD_ENTRY(OWM_GeoLocation, COUNTRY, OWM_FIELD_STRING, country),
+    OWM_FIELD_ENTRY(OWM_GeoLocation, STATE, OWM_FIELD_STRING, state),
+    OWM_FIELD_ENTRY(OWM_GeoLocation, LAT, OWM_FIELD_FLOAT, lat),
+    OWM_FIELD_ENTRY(OWM_GeoLocation, LON, OWM_FIELD_FLOAT, lon),
+};
+OWM_FIELD_TABLE(owmGeoLocationSchema, kGeoLocationFields);
@@ -0,0 +1,184 @@
+/**
+ * @file OWM_Schema.h
+ * @brief Key ids and field tables describing the OpenWeatherMap responses
+ *
+ * Every object key the library reads is listed once in OWM_JSON_KEYS.
+ * The list generates the OWM_JsonKey ids, the key names and the lookup
+ * switch in owmJsonKeyId(), whose case labels are FNV-1a hashes computed
+ * at compile time; two keys with the same hash would be a duplicate case
+ * label, so the hash is checked to be perfect for the key set on every
+ * build.
+ *
+ * Field tables map key ids to struct members (offset, type, size). Both
+ * the SAX handlers and the ArduinoJson helpers are driven by these
+ * tables, so reading a new field is one OWM_JSON_KEYS line (if the key is
+ * new) and one table entry.
+ */
+
+#ifndef OWM_SCHEMA_H
+#define OWM_SCHEMA_H
+
+#include "OpenWeatherMap.h"
+#include <stddef.h>
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+/**
+ * @brief All keys used by the schemas: X(id, "name")
+ */
+#define OWM_JSON_KEYS(X)            \
+    X(1H, "1h")                     \
+    X(3H, "3h")                     \
+    X(ALL, "all")                   \
+    X(AQI, "aqi")                   \
+    X(CITY, "city")                 \
+    X(CLOUDS, "clouds")             \
+    X(CNT, "cnt")                   \
+    X(CO, "co")                     \
+    X(COMPONENTS, "components")     \
+    X(COORD, "coord")               \
+    X(COUNTRY, "country")           \
+    X(DEG, "deg")                   \
+    X(DESCRIPTION, "description")   \
+    X(DT, "dt")                     \
+    X(DT_TXT, "dt_txt")             \
+    X(FEELS_LIKE, "feels_like")     \
+    X(GRND_LEVEL, "grnd_level")     \
+    X(GUST, "gust")                 \
+    X(HUMIDITY, "humidity")         \
+    X(ICON, "icon")                 \
+    X(ID, "id")                     \
+    X(LAT, "lat")                   \
+    X(LIST, "list")                 \
+    X(LON, "lon")                   \
+    X(MAIN, "main")                 \
+    X(NAME, "name")                 \
+    X(NH3, "nh3")                   \
+    X(NO, "no")                     \
+    X(NO2, "no2")                   \
+    X(O3, "o3")                     \
+    X(PM10, "pm10")                 \
+    X(PM2_5, "pm2_5")               \
+    X(POP, "pop")                   \
+    X(PRESSURE, "pressure")         \
+    X(RAIN, "rain")                 \
+    X(SEA_LEVEL, "sea_level")       \
+    X(SNOW, "snow")                 \
+    X(SO2, "so2")                   \
+    X(SPEED, "speed")               \
+    X(STATE, "state")               \
+    X(SUNRISE, "sunrise")           \
+    X(SUNSET, "sunset")             \
+    X(SYS, "sys")                   \
+    X(TEMP, "temp")                 \
+    X(TEMP_MAX, "temp_max")         \
+    X(TEMP_MIN, "temp_min")         \
+    X(TIMEZONE, "timezone")         \
+    X(VISIBILITY, "visibility")     \
+    X(WEATHER, "weather")           \
+    X(WIND, "wind")
+
+/**
+ * @brief Ids of the object keys used by the OpenWeatherMap schemas
+ */
+enum OWM_JsonKey {
+    OWM_KEY_UNKNOWN = 0,
+#define OWM_KEY_ENUM(id, name) OWM_KEY_##id,
+    OWM_JSON_KEYS(OWM_KEY_ENUM)
+#undef OWM_KEY_ENUM
+    OWM_KEY_COUNT
+};
+
+/**
+ * @brief FNV-1a hash of a NUL-terminated key, usable in constant expressions
+ */
+constexpr uint32_t owmKeyHash(const char* key, uint32_t hash = 2166136261UL) {
+    return *key ? owmKeyHash(key + 1, (uint32_t)((hash ^ (uint8_t)*key) * 16777619UL)) : hash;
+}
+
+/**
+ * @brief Map an object key to its OWM_JsonKey id
+ * @return OWM_KEY_UNKNOWN for keys no schema uses
+ */
+uint8_t owmJsonKeyId(const char* key, size_t length);
+
+/**
+ * @brief Name of a key id ("" for OWM_KEY_UNKNOWN)
+ */
+const char* owmJsonKeyName(uint8_t id);
+
+// ============================================================================
+// Field Tables
+// ============================================================================
+
+/**
+ * @brief How a value is stored in its struct member
+ */
+enum OWM_FieldType {
+    OWM_FIELD_INT,        // Signed integer of size bytes
+    OWM_FIELD_ULONG,      // unsigned long or uint32_t (timestamps)
+    OWM_FIELD_FLOAT,      // float
+    OWM_FIELD_FIXED,      // Integer of size bytes holding value * 10^decimals
+    OWM_FIELD_STRING,     // char[size], always NUL-terminated
+    OWM_FIELD_OBJECT,     // Nested object described by sub
+    OWM_FIELD_FIRST       // First object of an array, described by sub
+};
+
+struct OWM_FieldTable;
+
+/**
+ * @brief One struct member filled from a key
+ *
+ * For OWM_FIELD_OBJECT and OWM_FIELD_FIRST, offset is added to the base
+ * before the sub table is applied; sub tables with offset 0 flatten a
+ * nested JSON object into the parent struct (e.g. "coord").
+ */
+struct OWM_Field {
+    uint8_t key;
+    uint8_t type;
+    uint8_t size;
+    uint8_t decimals;
+    uint16_t offset;
+    const OWM_FieldTable* sub;
+};
+
+struct OWM_FieldTable {
+    const OWM_Field* fields;
+    uint8_t count;
+};
+
+// Table entry helpers
+#define OWM_FIELD_ENTRY(S, key, type, member) \
+    { OWM_KEY_##key, type, sizeof(((S*)0)->member), 0, offsetof(S, member), NULL }
+#define OWM_FIXED_ENTRY(S, key, member, decimals) \
+    { OWM_KEY_##key, OWM_FIELD_FIXED, sizeof(((S*)0)->member), decimals, offsetof(S, member), NULL }
+#define OWM_OBJECT_ENTRY(S, key, member, table) \
+    { OWM_KEY_##key, OWM_FIELD_OBJECT, 0, 0, offsetof(S, member), &table }
+#define OWM_FIRST_ENTRY(S, key, member, table) \
+    { OWM_KEY_##key, OWM_FIELD_FIRST, 0, 0, offsetof(S, member), &table }
+#define OWM_FLAT_ENTRY(key, table) \
+    { OWM_KEY_##key, OWM_FIELD_OBJECT, 0, 0, 0, &table }
+#define OWM_FIELD_TABLE(name, fields) \
+    const OWM_FieldTable name = { fields, sizeof(fields) / sizeof(fields[0]) }
+
+/**
+ * @brief Find the field for a key id
+ * @return NULL if the table has no such key
+ */
+const OWM_Field* owmFindField(const OWM_FieldTable* table, uint8_t key);
+
+/**
+ * @brief Store a signed integer in a member of the given size
+ */
+void owmStoreInt(void* dest, uint8_t size, long value);
+
+// Response schemas
+extern const OWM_FieldTable owmCurrentWeatherSchema;   // /data/2.5/weather, group "list" element
+extern const OWM_FieldTable owmForecastSchema;         // /data/2.5/forecast, except "list"
+extern const OWM_FieldTable owmForecastItemSchema;     // forecast "list" element
+extern const OWM_FieldTable owmAirPollutionSchema;     // air pollution "list" element
+extern const OWM_FieldTable owmGeoLocationSchema;      // geocoding result / zip response
+
+#endif // OWM_SCHEMA_H
@@ -0,0 +1,475 @@
+/**
+ * @file OWM_TimeSeries.cpp
+ * @brief Compressed in-memory time series implementation
+ */
+
+#include "OWM_TimeSeries.h"
+
+// Payload widths of the '10', '110', '1110' and '1111' buckets
+static const uint8_t kTimeWidths[4] = {7, 12, 20, 32};
+static const uint8_t kValueWidths[4] = {6, 10, 16, 32};
+
+static inline uint32_t zigzagEncode(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t zigzagDecode(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Bits writeEncoded() uses for value
+static uint8_t encodedBits(uint32_t value, const uint8_t* widths) {
+    if (value == 0) {
+        return 1;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (value < (1UL << widths[i])) {
+            return i + 2 + widths[i];
+        }
+    }
+    return 4 + widths[3];
+}
+
+/**
+ * @brief Sequential MSB-first bit reader over a block
+ */
+struct OWM_BitReader {
+    const uint8_t* data;
+    uint32_t pos;
+
+    uint32_t read(uint8_t bits) {
+        uint32_t value = 0;
+        while (bits > 0) {
+            uint8_t used = pos & 7;
+            uint8_t room = 8 - used;
+            uint8_t n = bits < room ? bits : room;
+            uint8_t chunk = (data[pos >> 3] >> (room - n)) & ((1u << n) - 1);
+            value = (value << n) | chunk;
+            pos += n;
+            bits -= n;
+        }
+        return value;
+    }
+
+    uint32_t readEncoded(const uint8_t* widths) {
+        if (!read(1)) {
+            return 0;
+        }
+        for (int i = 0; i < 3; i++) {
+            if (!read(1)) {
+                return read(widths[i]);
+            }
+        }
+        return read(widths[3]);
+    }
+};
+
+// ============================================================================
+// OWM_TimeSeries
+// ============================================================================
+
+OWM_TimeSeries::OWM_TimeSeries(uint8_t* buffer, size_t size, uint8_t channels) {
+    _buffer = buffer;
+    _size = size;
+    _channels = channels > OWM_TS_MAX_CHANNELS ? OWM_TS_MAX_CHANNELS : channels;
+    for (int i = 0; i < OWM_TS_MAX_CHANNELS; i++) {
+        _resolution[i] = 0.01f;
+    }
+    clear();
+}
+
+void OWM_TimeSeries::clear() {
+    _blockCount = 0;
+    _bitPos = 0;
+    _prevDt = 0;
+    _prevDelta = 0;
+    memset(_prevQ, 0, sizeof(_prevQ));
+}
+
+bool OWM_TimeSeries::setResolution(uint8_t channel, float step) {
+    if (channel >= _channels || step <= 0 || _blockCount > 0) {
+        return false;
+    }
+    _resolution[channel] = step;
+    return true;
+}
+
+bool OWM_TimeSeries::append(unsigned long dt, const float* values) {
+    if (_blockCount > 0) {
+        if (dt < _prevDt) {
+            return false;
+        }
+        if (dt == _prevDt) {
+            return true;  // Same observation fetched again
+        }
+    }
+
+    int32_t q[OWM_TS_MAX_CHANNELS];
+    for (uint8_t c = 0; c < _channels; c++) {
+        q[c] = (int32_t)lroundf(values[c] / _resolution[c]);
+    }
+
+    // A sample that would not fit even into the empty buffer is refused
+    // before any history is dropped for it
+    if (sampleBits(dt, q, true) > _size * 8UL) {
+        return false;
+    }
+
+    // Extend the open block while it is below both limits, dropping old
+    // blocks if the buffer is full
+    Block* block = (_blockCount > 0) ? &_blocks[_blockCount - 1] : NULL;
+    bool extend = (block != NULL && block->count < OWM_TS_BLOCK_SAMPLES &&
+                   bytesUsed() - block->byteOffset < _size / 4);
+    uint32_t needed = 0;
+    if (extend) {
+        needed = sampleBits(dt, q, false);
+        while (!hasRoom(needed) && _blockCount > 1 && dropOldestBlock()) {
+        }
+        block = &_blocks[_blockCount - 1];
+        extend = hasRoom(needed);
+    }
+
+    if (!extend) {
+        if (!startBlock(dt)) {
+            return false;
+        }
+        needed = sampleBits(dt, q, true);
+        while (!hasRoom(needed)) {
+            if (_blockCount <= 1 || !dropOldestBlock()) {
+                // Take the empty block out again so the index only
+                // describes stored samples
+                _blockCount--;
+                _bitPos = _blocks[_blockCount].byteOffset * 8UL;
+                return false;
+            }
+        }
+        block = &_blocks[_blockCount - 1];
+    }
+
+    // Timestamp
+    if (block->count == 0) {
+        block->firstDt = dt;
+        writeBits((uint32_t)dt, 32);
+        _prevDelta = 0;
+        memset(_prevQ, 0, sizeof(_prevQ));
+    } else {
+        int32_t delta = (int32_t)(dt - _prevDt);
+        writeEncoded(zigzagEncode(delta - _prevDelta), kTimeWidths);
+        _prevDelta = delta;
+    }
+    _prevDt = dt;
+
+    // Values
+    for (uint8_t c = 0; c < _channels; c++) {
+        writeEncoded(zigzagEncode(q[c] - _prevQ[c]), kValueWidths);
+        _prevQ[c] = q[c];
+    }
+
+    block->count++;
+    return true;
+}
+
+int OWM_TimeSeries::scan(unsigned long from, unsigned long to, SampleCallback callback,
+                         void* userData) const {
+    if (callback == NULL || _blockCount == 0) {
+        return 0;
+    }
+
+    // Skip whole blocks that end before the range starts
+    int first = 0;
+    while (first + 1 < _blockCount && _blocks[first + 1].firstDt <= from) {
+        first++;
+    }
+
+    int index = 0;
+    for (int b = 0; b < first; b++) {
+        index += _blocks[b].count;
+    }
+
+    int delivered = 0;
+    float values[OWM_TS_MAX_CHANNELS];
+    int32_t q[OWM_TS_MAX_CHANNELS];
+
+    for (int b = first; b < _blockCount; b++) {
+        const Block& block = _blocks[b];
+        if (block.firstDt > to) {
+            break;
+        }
+
+        OWM_BitReader reader;
+        reader.data = _buffer + block.byteOffset;
+        reader.pos = 0;
+
+        unsigned long dt = 0;
+        int32_t delta = 0;
+        memset(q, 0, sizeof(q));
+
+        for (uint16_t i = 0; i < block.count; i++, index++) {
+            if (i == 0) {
+                dt = reader.read(32);
+            } else {
+                delta += zigzagDecode(reader.readEncoded(kTimeWidths));
+                dt += delta;
+            }
+            for (uint8_t c = 0; c < _channels; c++) {
+                q[c] += zigzagDecode(reader.readEncoded(kValueWidths));
+                values[c] = q[c] * _resolution[c];
+            }
+
+            if (dt > to) {
+                return delivered;
+            }
+            if (dt >= from) {
+                delivered++;
+                if (!callback(dt, values, index, userData)) {
+                    return delivered;
+                }
+            }
+        }
+    }
+
+    return delivered;
+}
+
+int OWM_TimeSeries::count() const {
+    int total = 0;
+    for (int b = 0; b < _blockCount; b++) {
+        total += _blocks[b].count;
+    }
+    return total;
+}
+
+size_t OWM_TimeSeries::bytesUsed() const {
+    return (_bitPos + 7) / 8;
+}
+
+unsigned long OWM_TimeSeries::firstTime() const {
+    return _blockCount > 0 ? _blocks[0].firstDt : 0;
+}
+
+unsigned long OWM_TimeSeries::lastTime() const {
+    return _blockCount > 0 ? _prevDt : 0;
+}
+
+bool OWM_TimeSeries::startBlock(unsigned long dt) {
+    if (_blockCount >= OWM_TS_MAX_BLOCKS && !dropOldestBlock()) {
+        return false;
+    }
+
+    // Blocks start on a byte boundary so they can be moved with memmove()
+    _bitPos = (_bitPos + 7) & ~7UL;
+
+    Block& block = _blocks[_blockCount++];
+    block.firstDt = dt;
+    block.byteOffset = _bitPos >> 3;
+    block.count = 0;
+    return true;
+}
+
+bool OWM_TimeSeries::dropOldestBlock() {
+    if (_blockCount < 2) {
+        return false;
+    }
+
+    uint32_t shift = _blocks[1].byteOffset;
+    memmove(_buffer, _buffer + shift, bytesUsed() - shift);
+    _bitPos -= shift * 8;
+
+    for (int b = 1; b < _blockCount; b++) {
+        _blocks[b - 1] = _blocks[b];
+        _blocks[b - 1].byteOffset -= shift;
+    }
+    _blockCount--;
+    return true;
+}
+
+bool OWM_TimeSeries::hasRoom(uint32_t bits) const {
+    return _bitPos + bits <= _size * 8UL;
+}
+
+uint32_t OWM_TimeSeries::sampleBits(unsigned long dt, const int32_t* q, bool first) const {
+    // The first sample of a block has a full timestamp and deltas to 0
+    uint32_t bits = 32;
+    if (!first) {
+        int32_t delta = (int32_t)(dt - _prevDt);
+        bits = encodedBits(zigzagEncode(delta - _prevDelta), kTimeWidths);
+    }
+    for (uint8_t c = 0; c < _channels; c++) {
+        bits += encodedBits(zigzagEncode(first ? q[c] : q[c] - _prevQ[c]), kValueWidths);
+    }
+    return bits;
+}
+
+void OWM_TimeSeries::writeBits(uint32_t value, uint8_t bits) {
+    while (bits > 0) {
+        uint8_t used = _bitPos & 7;
+        uint8_t room = 8 - used;
+        uint8_t n = bits < room ? bits : room;
+        uint8_t chunk = (value >> (bits - n)) & ((1u << n) - 1);
+        uint8_t* byte = &_buffer[_bitPos >> 3];
+        if (used == 0) {
+            *byte = 0;
+        }
+        *byte |= chunk << (room - n);
+        _bitPos += n;
+        bits -= n;
+    }
+}
+
+void OWM_TimeSeries::writeEncoded(uint32_t value, const uint8_t* widths) {
+    if (value == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (value < (1UL << widths[i])) {
+            writeBits((1u << (i + 2)) - 2, i + 2);  // '10', '110', '1110'
+            writeBits(value, widths[i]);
+            return;
+        }
+    }
+    writeBits(0xF, 4);
+    writeBits(value, widths[3]);
+}
+
+// ============================================================================
+// OWM_AirPollutionSeries
+// ============================================================================
+
+// State shared between forEach() and its sample adapter
+struct AirPollutionScanContext {
+    OWM_AirPollutionCallback callback;
+    void* userData;
+};
+
+static bool decodeAirPollutionSample(unsigned long dt, const float* values, int index,
+                                     void* userData) {
+    AirPollutionScanContext* ctx = (AirPollutionScanContext*)userData;
+
+    OWM_AirPollution record;
+    record.dt = dt;
+    record.aqi = (int)lroundf(values[0]);
+    record.components.co = values[1];
+    record.components.no = values[2];
+    record.components.no2 = values[3];
+    record.components.o3 = values[4];
+    record.components.so2 = values[5];
+    record.components.pm2_5 = values[6];
+    record.components.pm10 = values[7];
+    record.components.nh3 = values[8];
+
+    return ctx->callback(&record, index, ctx->userData);
+}
+
+OWM_AirPollutionSeries::OWM_AirPollutionSeries(uint8_t* buffer, size_t size)
+    : OWM_TimeSeries(buffer, size, 9) {
+    setResolution(0, 1.0f);  // AQI is an integer
+}
+
+bool OWM_AirPollutionSeries::append(const OWM_AirPollution* sample) {
+    float values[9];
+    values[0] = sample->aqi;
+    values[1] = sample->components.co;
+    values[2] = sample->components.no;
+    values[3] = sample->components.no2;
+    values[4] = sample->components.o3;
+    values[5] = sample->components.so2;
+    values[6] = sample->components.pm2_5;
+    values[7] = sample->components.pm10;
+    values[8] = sample->components.nh3;
+    return OWM_TimeSeries::append(sample->dt, values);
+}
+
+int OWM_AirPollutionSeries::append(const OWM_AirPollution* samples, int count) {
+    int stored = 0;
+    for (int i = 0; i < count; i++) {
+        if (append(&samples[i])) {
+            stored++;
+        }
+    }
+    return stored;
+}
+
+int OWM_AirPollutionSeries::forEach(unsigned long from, unsigned long to,
+                                    OWM_AirPollutionCallback callback, void* userData) const {
+    if (callback == NULL) {
+        return 0;
+    }
+    AirPollutionScanContext ctx;
+    ctx.callback = callback;
+    ctx.userData = userData;
+    return scan(from, to, decodeAirPollutionSample, &ctx);
+}
+
+bool OWM_AirPollutionSeries::appendCallback(const OWM_AirPollution* item, int index,
+                                            void* series) {
+    ((OWM_AirPollutionSeries*)series)->append(item);
+    return true;
+}
+
+// ============================================================================
+// OWM_WeatherSeries
+// ============================================================================
+
+// State shared between forEach() and its sample adapter
+struct WeatherScanContext {
+    OWM_CurrentWeatherCallback callback;
+    void* userData;
+};
+
+static bool decodeWeatherSample(unsigned long dt, const float* values, int index,
+                                void* userData) {
+    WeatherScanContext* ctx = (WeatherScanContext*)userData;
+
+    OWM_CurrentWeather record;
+    memset(&record, 0, sizeof(record));
+    record.dt = dt;
+    record.main.temp = values[0];
+    record.main.feels_like = values[1];
+    record.main.pressure = (int)lroundf(values[2]);
+    record.main.humidity = (int)lroundf(values[3]);
+    record.wind.speed = values[4];
+    record.wind.deg = (int)lroundf(values[5]);
+    record.clouds = (int)lroundf(values[6]);
+    record.rain_1h = values[7];
+    record.snow_1h = values[8];
+    record.visibility = (int)lroundf(values[9]);
+
+    return ctx->callback(&record, index, ctx->userData);
+}
+
+OWM_WeatherSeries::OWM_WeatherSeries(uint8_t* buffer, size_t size)
+    : OWM_TimeSeries(buffer, size, 10) {
+    // Integer fields
+    setResolution(2, 1.0f);
+    setResolution(3, 1.0f);
+    setResolution(5, 1.0f);
+    setResolution(6, 1.0f);
+    setResolution(9, 1.0f);
+}
+
+bool OWM_WeatherSeries::append(const OWM_CurrentWeather* weather) {
+    float values[10];
+    values[0] = weather->main.temp;
+    values[1] = weather->main.feels_like;
+    values[2] = weather->main.pressure;
+    values[3] = weather->main.humidity;
+    values[4] = weather->wind.speed;
+    values[5] = weather->wind.deg;
+    values[6] = weather->clouds;
+    values[7] = weather->rain_1h;
+    values[8] = weather->snow_1h;
+    values[9] = weather->visibility;
+    return OWM_TimeSeries::append(weather->dt, values);
+}
+
+int OWM_WeatherSeries::forEach(unsigned long from, unsigned long to,
+                               OWM_CurrentWeatherCallback callback, void* userData) const {
+    if (callback == NULL) {
+        return 0;
+    }
+    WeatherScanContext ctx;
+    ctx.callback = callback;
+    ctx.userData = userData;
+    return scan(from, to, decodeWeatherSample, &ctx);
+}
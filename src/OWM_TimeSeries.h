@@ -0,0 +1,212 @@
+/**
+ * @file OWM_TimeSeries.h
+ * @brief Compressed in-memory time series for weather and air pollution history
+ *
+ * Samples are packed into a caller-supplied byte buffer using a
+ * Gorilla-style bit stream:
+ * - Timestamps are stored as delta-of-delta, so a regular hourly series
+ *   costs a single bit per sample.
+ * - Values are quantized to a per-channel resolution (0.01 by default,
+ *   which is exact for the precision the API reports) and stored as the
+ *   zig-zag delta to the previous sample in a variable-width bucket.
+ *
+ * The buffer is split into independently decodable blocks. A small block
+ * index lets range scans skip straight to the first relevant block, and
+ * when the buffer fills up the oldest block is dropped so appends never
+ * stop. A block ends after OWM_TS_BLOCK_SAMPLES samples or once it fills
+ * a quarter of the buffer, so a drop loses at most about a quarter of
+ * the history. Every block starts with a full timestamp and full values,
+ * so small buffers (short blocks) compress less well; the buffer should
+ * hold at least a few dozen samples.
+ */
+
+#ifndef OWM_TIMESERIES_H
+#define OWM_TIMESERIES_H
+
+#include "OpenWeatherMap.h"
+
+// Maximum samples per independently decodable block
+#define OWM_TS_BLOCK_SAMPLES 32
+
+// Maximum number of blocks kept in the index
+#define OWM_TS_MAX_BLOCKS 64
+
+// Maximum number of value channels per sample
+#define OWM_TS_MAX_CHANNELS 10
+
+/**
+ * @brief Generic multi-channel compressed time series
+ */
+class OWM_TimeSeries {
+public:
+    /**
+     * @brief Called for every sample visited by scan()
+     * @param dt Sample time (unix, UTC)
+     * @param values Decoded channel values
+     * @param index Zero-based position of the sample in the series
+     * @param userData User pointer passed to scan()
+     * @return true to continue, false to stop the scan
+     */
+    typedef bool (*SampleCallback)(unsigned long dt, const float* values, int index,
+                                   void* userData);
+
+    /**
+     * @brief Construct a time series over a caller-owned buffer
+     * @param buffer Storage for the compressed samples
+     * @param size Size of buffer in bytes
+     * @param channels Number of values per sample (up to OWM_TS_MAX_CHANNELS)
+     */
+    OWM_TimeSeries(uint8_t* buffer, size_t size, uint8_t channels);
+
+    /**
+     * @brief Remove all samples
+     */
+    void clear();
+
+    /**
+     * @brief Set the quantization step of a channel
+     *
+     * Only allowed while the series is empty. Coarser steps give better
+     * compression, e.g. 1.0 for CO which rarely needs decimals.
+     *
+     * @param channel Channel index
+     * @param step Quantization step (e.g. 0.01)
+     * @return true on success, false if the series is not empty
+     */
+    bool setResolution(uint8_t channel, float step);
+
+    /**
+     * @brief Append a sample
+     *
+     * Timestamps must not decrease. A sample with the same timestamp as
+     * the last one is treated as a repeated observation and ignored.
+     * The oldest samples are dropped to make room.
+     *
+     * @param dt Sample time (unix, UTC)
+     * @param values One value per channel
+     * @return true on success, false if dt is older than the last sample
+     *         or the sample is larger than the whole buffer
+     */
+    bool append(unsigned long dt, const float* values);
+
+    /**
+     * @brief Visit every sample in [from, to]
+     * @param from Start time (inclusive)
+     * @param to End time (inclusive)
+     * @param callback Function called for every sample in range
+     * @param userData Pointer passed through to the callback
+     * @return Number of samples delivered to the callback
+     */
+    int scan(unsigned long from, unsigned long to, SampleCallback callback,
+             void* userData) const;
+
+    /**
+     * @brief Get the number of stored samples
+     */
+    int count() const;
+
+    /**
+     * @brief Get the number of buffer bytes in use
+     */
+    size_t bytesUsed() const;
+
+    /**
+     * @brief Get the time of the oldest stored sample (0 if empty)
+     */
+    unsigned long firstTime() const;
+
+    /**
+     * @brief Get the time of the newest stored sample (0 if empty)
+     */
+    unsigned long lastTime() const;
+
+private:
+    struct Block {
+        unsigned long firstDt;
+        uint32_t byteOffset;
+        uint16_t count;
+    };
+
+    uint8_t* _buffer;
+    size_t _size;
+    uint8_t _channels;
+    float _resolution[OWM_TS_MAX_CHANNELS];
+
+    Block _blocks[OWM_TS_MAX_BLOCKS];
+    int _blockCount;
+    uint32_t _bitPos;
+
+    // Encoder state of the open (last) block
+    unsigned long _prevDt;
+    int32_t _prevDelta;
+    int32_t _prevQ[OWM_TS_MAX_CHANNELS];
+
+    bool startBlock(unsigned long dt);
+    bool dropOldestBlock();
+    bool hasRoom(uint32_t bits) const;
+    uint32_t sampleBits(unsigned long dt, const int32_t* q, bool first) const;
+    void writeBits(uint32_t value, uint8_t bits);
+    void writeEncoded(uint32_t value, const uint8_t* widths);
+};
+
+/**
+ * @brief Compressed history of OWM_AirPollution samples
+ *
+ * Channels: aqi, co, no, no2, o3, so2, pm2_5, pm10, nh3.
+ */
+class OWM_AirPollutionSeries : public OWM_TimeSeries {
+public:
+    OWM_AirPollutionSeries(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Append one record
+     * @return true on success, false if the record is older than the last one
+     */
+    bool append(const OWM_AirPollution* sample);
+
+    /**
+     * @brief Append several records (e.g. from getAirPollutionHistory())
+     * @return Number of records stored
+     */
+    int append(const OWM_AirPollution* samples, int count);
+
+    /**
+     * @brief Decode every record in [from, to]
+     * @return Number of records delivered to the callback
+     */
+    int forEach(unsigned long from, unsigned long to, OWM_AirPollutionCallback callback,
+                void* userData = NULL) const;
+
+    /**
+     * @brief Adapter for airPollutionHistoryEach(): pass the series as userData
+     */
+    static bool appendCallback(const OWM_AirPollution* item, int index, void* series);
+};
+
+/**
+ * @brief Compressed history of OWM_CurrentWeather observations
+ *
+ * Only the numeric observation fields are stored: main.temp,
+ * main.feels_like, main.pressure, main.humidity, wind.speed, wind.deg,
+ * clouds, rain_1h, snow_1h and visibility. Decoded records have all other
+ * fields cleared.
+ */
+class OWM_WeatherSeries : public OWM_TimeSeries {
+public:
+    OWM_WeatherSeries(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Append one observation (e.g. after getCurrentWeather())
+     * @return true on success, false if the observation is older than the last one
+     */
+    bool append(const OWM_CurrentWeather* weather);
+
+    /**
+     * @brief Decode every observation in [from, to]
+     * @return Number of observations delivered to the callback
+     */
+    int forEach(unsigned long from, unsigned long to, OWM_CurrentWeatherCallback callback,
+                void* userData = NULL) const;
+};
+
+#endif // OWM_TIMESERIES_H
@@ -0,0 +1,338 @@
+/**
+ * @file OWM_Wire.cpp
+ * @brief Flat binary wire format implementation
+ */
+
+#include "OWM_Wire.h"
+
+// String reference offsets inside each fixed layout
+static const uint8_t kCurrentWeatherRefs[] = {8 + 4, 8 + 6, 8 + 8, 94, 96};
+static const uint8_t kGeoLocationRefs[] = {8, 10, 12};
+static const uint8_t kForecastRefs[] = {22, 24};
+static const uint8_t kForecastItemRefs[] = {36 + 4, 36 + 6, 36 + 8, 78};
+
+/**
+ * @brief Sequential message builder
+ *
+ * Fixed fields are written at known offsets relative to the body; strings
+ * are appended to the string area after the fixed part. Any overflow
+ * clears ok and the message is discarded.
+ */
+struct OWM_WireWriter {
+    uint8_t* buf;
+    size_t size;
+    size_t fixedEnd;      // End of the fixed layout (start of strings)
+    size_t end;           // End of the string area
+    bool ok;
+
+    OWM_WireWriter(uint8_t* buffer, size_t bufferSize, size_t fixedSize) {
+        buf = buffer;
+        size = bufferSize;
+        fixedEnd = OWM_WIRE_HEADER_SIZE + fixedSize;
+        end = fixedEnd;
+        ok = (fixedEnd <= size && fixedEnd <= 0xFFFF);
+        if (ok) {
+            memset(buf, 0, fixedEnd);
+        }
+    }
+
+    void u16(size_t off, uint16_t v) {
+        uint8_t* p = buf + OWM_WIRE_HEADER_SIZE + off;
+        p[0] = v & 0xFF;
+        p[1] = v >> 8;
+    }
+
+    void u32(size_t off, uint32_t v) {
+        uint8_t* p = buf + OWM_WIRE_HEADER_SIZE + off;
+        p[0] = v & 0xFF;
+        p[1] = (v >> 8) & 0xFF;
+        p[2] = (v >> 16) & 0xFF;
+        p[3] = v >> 24;
+    }
+
+    void i32(size_t off, int32_t v) { u32(off, (uint32_t)v); }
+
+    void f32(size_t off, float v) {
+        uint32_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        u32(off, bits);
+    }
+
+    void str(size_t off, const char* s) {
+        if (!ok) {
+            return;
+        }
+        size_t len = strnlen(s, 255);
+
+        // Forecast items repeat the same few strings; reuse earlier copies
+        size_t pos = fixedEnd;
+        while (pos < end) {
+            uint8_t existing = buf[pos];
+            if (existing == len && memcmp(buf + pos + 1, s, len) == 0) {
+                u16(off, (uint16_t)pos);
+                return;
+            }
+            pos += existing + 2;
+        }
+
+        if (end + len + 2 > size || end + len + 2 > 0xFFFF) {
+            ok = false;
+            return;
+        }
+        buf[end] = (uint8_t)len;
+        memcpy(buf + end + 1, s, len);
+        buf[end + 1 + len] = '\0';
+        u16(off, (uint16_t)end);
+        end += len + 2;
+    }
+
+    void condition(size_t off, const OWM_WeatherCondition* c) {
+        i32(off, c->id);
+        str(off + 4, c->main);
+        str(off + 6, c->description);
+        str(off + 8, c->icon);
+    }
+
+    void mainData(size_t off, const OWM_MainData* m) {
+        f32(off, m->temp);
+        f32(off + 4, m->feels_like);
+        f32(off + 8, m->temp_min);
+        f32(off + 12, m->temp_max);
+        i32(off + 16, m->pressure);
+        i32(off + 20, m->humidity);
+        i32(off + 24, m->sea_level);
+        i32(off + 28, m->grnd_level);
+    }
+
+    void wind(size_t off, const OWM_WindData* w) {
+        f32(off, w->speed);
+        i32(off + 4, w->deg);
+        f32(off + 8, w->gust);
+    }
+
+    size_t finish(OWM_WireType type) {
+        if (!ok) {
+            return 0;
+        }
+        buf[0] = 'O';
+        buf[1] = 'W';
+        buf[2] = OWM_WIRE_VERSION;
+        buf[3] = (uint8_t)type;
+        uint32_t crc = owmWireCrc32(buf + OWM_WIRE_HEADER_SIZE, end - OWM_WIRE_HEADER_SIZE);
+        for (int i = 0; i < 4; i++) {
+            buf[4 + i] = (uint8_t)(end >> (8 * i));
+            buf[8 + i] = (uint8_t)(crc >> (8 * i));
+        }
+        return end;
+    }
+};
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+size_t owmWireEncode(const OWM_CurrentWeather* weather, uint8_t* buffer, size_t size) {
+    OWM_WireWriter w(buffer, size, OWM_WIRE_CURRENT_WEATHER_SIZE);
+    if (!w.ok) {
+        return 0;
+    }
+    w.f32(0, weather->lat);
+    w.f32(4, weather->lon);
+    w.condition(8, &weather->weather);
+    w.mainData(18, &weather->main);
+    w.i32(50, weather->visibility);
+    w.wind(54, &weather->wind);
+    w.i32(66, weather->clouds);
+    w.f32(70, weather->rain_1h);
+    w.f32(74, weather->snow_1h);
+    w.u32(78, weather->dt);
+    w.u32(82, weather->sunrise);
+    w.u32(86, weather->sunset);
+    w.i32(90, weather->timezone);
+    w.str(94, weather->country);
+    w.str(96, weather->name);
+    return w.finish(OWM_WIRE_CURRENT_WEATHER);
+}
+
+size_t owmWireEncode(const OWM_Forecast* forecast, uint8_t* buffer, size_t size) {
+    int cnt = forecast->cnt;
+    if (cnt < 0) cnt = 0;
+    if (cnt > OWM_MAX_FORECAST_ITEMS) cnt = OWM_MAX_FORECAST_ITEMS;
+
+    OWM_WireWriter w(buffer, size,
+                     OWM_WIRE_FORECAST_SIZE + (size_t)cnt * OWM_WIRE_FORECAST_ITEM_SIZE);
+    if (!w.ok) {
+        return 0;
+    }
+    w.u16(0, (uint16_t)cnt);
+    w.f32(2, forecast->lat);
+    w.f32(6, forecast->lon);
+    w.i32(10, forecast->timezone);
+    w.u32(14, forecast->sunrise);
+    w.u32(18, forecast->sunset);
+    w.str(22, forecast->city_name);
+    w.str(24, forecast->country);
+
+    for (int i = 0; i < cnt; i++) {
+        const OWM_ForecastItem* fi = &forecast->items[i];
+        size_t off = OWM_WIRE_FORECAST_SIZE + (size_t)i * OWM_WIRE_FORECAST_ITEM_SIZE;
+        w.u32(off, fi->dt);
+        w.mainData(off + 4, &fi->main);
+        w.condition(off + 36, &fi->weather);
+        w.wind(off + 46, &fi->wind);
+        w.i32(off + 58, fi->clouds);
+        w.i32(off + 62, fi->visibility);
+        w.f32(off + 66, fi->pop);
+        w.f32(off + 70, fi->rain_3h);
+        w.f32(off + 74, fi->snow_3h);
+        w.str(off + 78, fi->dt_txt);
+    }
+    return w.finish(OWM_WIRE_FORECAST);
+}
+
+size_t owmWireEncode(const OWM_AirPollution* pollution, uint8_t* buffer, size_t size) {
+    OWM_WireWriter w(buffer, size, OWM_WIRE_AIR_POLLUTION_SIZE);
+    if (!w.ok) {
+        return 0;
+    }
+    const OWM_AirComponents* c = &pollution->components;
+    w.u32(0, pollution->dt);
+    w.i32(4, pollution->aqi);
+    w.f32(8, c->co);
+    w.f32(12, c->no);
+    w.f32(16, c->no2);
+    w.f32(20, c->o3);
+    w.f32(24, c->so2);
+    w.f32(28, c->pm2_5);
+    w.f32(32, c->pm10);
+    w.f32(36, c->nh3);
+    return w.finish(OWM_WIRE_AIR_POLLUTION);
+}
+
+size_t owmWireEncode(const OWM_GeoLocation* location, uint8_t* buffer, size_t size) {
+    OWM_WireWriter w(buffer, size, OWM_WIRE_GEO_LOCATION_SIZE);
+    if (!w.ok) {
+        return 0;
+    }
+    w.f32(0, location->lat);
+    w.f32(4, location->lon);
+    w.str(8, location->name);
+    w.str(10, location->country);
+    w.str(12, location->state);
+    return w.finish(OWM_WIRE_GEO_LOCATION);
+}
+
+uint32_t owmWireCrc32(const uint8_t* data, size_t length) {
+    // Nibble table: 64 bytes of flash instead of 1 KB
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+// ============================================================================
+// Validation
+// ============================================================================
+
+// Check that every string reference in a layout points at a terminated
+// string inside the string area
+static bool checkRefs(const uint8_t* msg, size_t stringsStart, size_t length,
+                      const uint8_t* base, const uint8_t* refs, size_t refCount) {
+    for (size_t i = 0; i < refCount; i++) {
+        size_t pos = base[refs[i]] | (base[refs[i] + 1] << 8);
+        if (pos < stringsStart || pos + 2 > length) {
+            return false;
+        }
+        size_t len = msg[pos];
+        if (pos + len + 2 > length || msg[pos + 1 + len] != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+#define OWM_COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+OWM_WireMessage::OWM_WireMessage(const uint8_t* data, size_t length, bool verifyChecksum) {
+    _data = data;
+    _length = 0;
+    _type = OWM_WIRE_INVALID;
+
+    if (data == NULL || length < OWM_WIRE_HEADER_SIZE ||
+        data[0] != 'O' || data[1] != 'W' || data[2] != OWM_WIRE_VERSION) {
+        return;
+    }
+
+    size_t declared = (size_t)data[4] | ((size_t)data[5] << 8) |
+                      ((size_t)data[6] << 16) | ((size_t)data[7] << 24);
+    if (declared < OWM_WIRE_HEADER_SIZE || declared > length) {
+        return;
+    }
+
+    if (verifyChecksum) {
+        uint32_t crc = (uint32_t)data[8] | ((uint32_t)data[9] << 8) |
+                       ((uint32_t)data[10] << 16) | ((uint32_t)data[11] << 24);
+        if (owmWireCrc32(data + OWM_WIRE_HEADER_SIZE, declared - OWM_WIRE_HEADER_SIZE) != crc) {
+            return;
+        }
+    }
+
+    const uint8_t* body = data + OWM_WIRE_HEADER_SIZE;
+    OWM_WireType type = (OWM_WireType)data[3];
+    size_t fixed;
+    bool ok;
+
+    switch (type) {
+        case OWM_WIRE_CURRENT_WEATHER:
+            fixed = OWM_WIRE_HEADER_SIZE + OWM_WIRE_CURRENT_WEATHER_SIZE;
+            ok = fixed <= declared &&
+                 checkRefs(data, fixed, declared, body, kCurrentWeatherRefs,
+                           OWM_COUNT_OF(kCurrentWeatherRefs));
+            break;
+        case OWM_WIRE_AIR_POLLUTION:
+            fixed = OWM_WIRE_HEADER_SIZE + OWM_WIRE_AIR_POLLUTION_SIZE;
+            ok = fixed <= declared;
+            break;
+        case OWM_WIRE_GEO_LOCATION:
+            fixed = OWM_WIRE_HEADER_SIZE + OWM_WIRE_GEO_LOCATION_SIZE;
+            ok = fixed <= declared &&
+                 checkRefs(data, fixed, declared, body, kGeoLocationRefs,
+                           OWM_COUNT_OF(kGeoLocationRefs));
+            break;
+        case OWM_WIRE_FORECAST: {
+            fixed = OWM_WIRE_HEADER_SIZE + OWM_WIRE_FORECAST_SIZE;
+            if (fixed > declared) {
+                ok = false;
+                break;
+            }
+            size_t cnt = body[0] | (body[1] << 8);
+            fixed += cnt * OWM_WIRE_FORECAST_ITEM_SIZE;
+            ok = cnt <= OWM_MAX_FORECAST_ITEMS && fixed <= declared &&
+                 checkRefs(data, fixed, declared, body, kForecastRefs,
+                           OWM_COUNT_OF(kForecastRefs));
+            for (size_t i = 0; ok && i < cnt; i++) {
+                const uint8_t* item = body + OWM_WIRE_FORECAST_SIZE + i * OWM_WIRE_FORECAST_ITEM_SIZE;
+                ok = checkRefs(data, fixed, declared, item, kForecastItemRefs,
+                               OWM_COUNT_OF(kForecastItemRefs));
+            }
+            break;
+        }
+        default:
+            ok = false;
+            break;
+    }
+
+    if (ok) {
+        _length = declared;
+        _type = type;
+    }
+}
@@ -0,0 +1,248 @@
+/**
+ * @file OWM_Wire.h
+ * @brief Flat binary wire format for forwarding OWM data between nodes
+ *
+ * A message is a 12-byte header followed by a fixed-layout body and a
+ * string area. All integers and floats are little-endian (floats are
+ * IEEE 754 binary32). Strings are referenced by a 16-bit offset from the
+ * start of the message and stored as a length byte, the characters and a
+ * terminating NUL, so views return pointers straight into the buffer.
+ *
+ * Header layout:
+ * | Offset | Size | Field                                   |
+ * |--------|------|-----------------------------------------|
+ * | 0      | 2    | Magic "OW"                              |
+ * | 2      | 1    | Version (OWM_WIRE_VERSION)              |
+ * | 3      | 1    | Type (OWM_WireType)                     |
+ * | 4      | 4    | Total message length in bytes           |
+ * | 8      | 4    | CRC-32 of everything after the header   |
+ *
+ * Reading is zero-copy: validate the buffer once with OWM_WireMessage and
+ * then read fields through the matching view class.
+ */
+
+#ifndef OWM_WIRE_H
+#define OWM_WIRE_H
+
+#include "OpenWeatherMap.h"
+
+#define OWM_WIRE_VERSION 1
+#define OWM_WIRE_HEADER_SIZE 12
+
+// Fixed body sizes (excluding strings)
+#define OWM_WIRE_CURRENT_WEATHER_SIZE 98
+#define OWM_WIRE_AIR_POLLUTION_SIZE 40
+#define OWM_WIRE_GEO_LOCATION_SIZE 14
+#define OWM_WIRE_FORECAST_SIZE 26
+#define OWM_WIRE_FORECAST_ITEM_SIZE 80
+
+/**
+ * @brief Message types
+ */
+enum OWM_WireType {
+    OWM_WIRE_INVALID = 0,
+    OWM_WIRE_CURRENT_WEATHER = 1,
+    OWM_WIRE_FORECAST = 2,
+    OWM_WIRE_AIR_POLLUTION = 3,
+    OWM_WIRE_GEO_LOCATION = 4
+};
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+/**
+ * @brief Encode a message into buffer
+ * @return Message length in bytes, or 0 if buffer is too small
+ */
+size_t owmWireEncode(const OWM_CurrentWeather* weather, uint8_t* buffer, size_t size);
+size_t owmWireEncode(const OWM_Forecast* forecast, uint8_t* buffer, size_t size);
+size_t owmWireEncode(const OWM_AirPollution* pollution, uint8_t* buffer, size_t size);
+size_t owmWireEncode(const OWM_GeoLocation* location, uint8_t* buffer, size_t size);
+
+/**
+ * @brief CRC-32 (IEEE 802.3) used for the message checksum
+ */
+uint32_t owmWireCrc32(const uint8_t* data, size_t length);
+
+// ============================================================================
+// Zero-copy Views
+// ============================================================================
+
+/**
+ * @brief Base for field accessors over a received buffer
+ */
+class OWM_WireView {
+public:
+    OWM_WireView(const uint8_t* message, const uint8_t* base) : _msg(message), _p(base) {}
+
+protected:
+    const uint8_t* _msg;
+    const uint8_t* _p;
+
+    uint32_t u32(size_t off) const {
+        const uint8_t* b = _p + off;
+        return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) |
+               ((uint32_t)b[3] << 24);
+    }
+    uint16_t u16(size_t off) const {
+        return (uint16_t)(_p[off] | (_p[off + 1] << 8));
+    }
+    int32_t i32(size_t off) const { return (int32_t)u32(off); }
+    float f32(size_t off) const {
+        uint32_t bits = u32(off);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    const char* str(size_t off) const {
+        // Skip the length byte; strings are NUL-terminated in the buffer
+        return (const char*)(_msg + u16(off) + 1);
+    }
+};
+
+class OWM_WireCondition : public OWM_WireView {
+public:
+    OWM_WireCondition(const uint8_t* m, const uint8_t* b) : OWM_WireView(m, b) {}
+    int id() const { return i32(0); }
+    const char* main() const { return str(4); }
+    const char* description() const { return str(6); }
+    const char* icon() const { return str(8); }
+};
+
+class OWM_WireMainData : public OWM_WireView {
+public:
+    OWM_WireMainData(const uint8_t* m, const uint8_t* b) : OWM_WireView(m, b) {}
+    float temp() const { return f32(0); }
+    float feels_like() const { return f32(4); }
+    float temp_min() const { return f32(8); }
+    float temp_max() const { return f32(12); }
+    int pressure() const { return i32(16); }
+    int humidity() const { return i32(20); }
+    int sea_level() const { return i32(24); }
+    int grnd_level() const { return i32(28); }
+};
+
+class OWM_WireWindData : public OWM_WireView {
+public:
+    OWM_WireWindData(const uint8_t* m, const uint8_t* b) : OWM_WireView(m, b) {}
+    float speed() const { return f32(0); }
+    int deg() const { return i32(4); }
+    float gust() const { return f32(8); }
+};
+
+class OWM_WireAirComponents : public OWM_WireView {
+public:
+    OWM_WireAirComponents(const uint8_t* m, const uint8_t* b) : OWM_WireView(m, b) {}
+    float co() const { return f32(0); }
+    float no() const { return f32(4); }
+    float no2() const { return f32(8); }
+    float o3() const { return f32(12); }
+    float so2() const { return f32(16); }
+    float pm2_5() const { return f32(20); }
+    float pm10() const { return f32(24); }
+    float nh3() const { return f32(28); }
+};
+
+class OWM_WireCurrentWeather : public OWM_WireView {
+public:
+    OWM_WireCurrentWeather(const uint8_t* m) : OWM_WireView(m, m + OWM_WIRE_HEADER_SIZE) {}
+    float lat() const { return f32(0); }
+    float lon() const { return f32(4); }
+    OWM_WireCondition weather() const { return OWM_WireCondition(_msg, _p + 8); }
+    OWM_WireMainData main() const { return OWM_WireMainData(_msg, _p + 18); }
+    int visibility() const { return i32(50); }
+    OWM_WireWindData wind() const { return OWM_WireWindData(_msg, _p + 54); }
+    int clouds() const { return i32(66); }
+    float rain_1h() const { return f32(70); }
+    float snow_1h() const { return f32(74); }
+    unsigned long dt() const { return u32(78); }
+    unsigned long sunrise() const { return u32(82); }
+    unsigned long sunset() const { return u32(86); }
+    int timezone() const { return i32(90); }
+    const char* country() const { return str(94); }
+    const char* name() const { return str(96); }
+};
+
+class OWM_WireAirPollution : public OWM_WireView {
+public:
+    OWM_WireAirPollution(const uint8_t* m) : OWM_WireView(m, m + OWM_WIRE_HEADER_SIZE) {}
+    unsigned long dt() const { return u32(0); }
+    int aqi() const { return i32(4); }
+    OWM_WireAirComponents components() const { return OWM_WireAirComponents(_msg, _p + 8); }
+};
+
+class OWM_WireGeoLocation : public OWM_WireView {
+public:
+    OWM_WireGeoLocation(const uint8_t* m) : OWM_WireView(m, m + OWM_WIRE_HEADER_SIZE) {}
+    float lat() const { return f32(0); }
+    float lon() const { return f32(4); }
+    const char* name() const { return str(8); }
+    const char* country() const { return str(10); }
+    const char* state() const { return str(12); }
+};
+
+class OWM_WireForecastItem : public OWM_WireView {
+public:
+    OWM_WireForecastItem(const uint8_t* m, const uint8_t* b) : OWM_WireView(m, b) {}
+    unsigned long dt() const { return u32(0); }
+    OWM_WireMainData main() const { return OWM_WireMainData(_msg, _p + 4); }
+    OWM_WireCondition weather() const { return OWM_WireCondition(_msg, _p + 36); }
+    OWM_WireWindData wind() const { return OWM_WireWindData(_msg, _p + 46); }
+    int clouds() const { return i32(58); }
+    int visibility() const { return i32(62); }
+    float pop() const { return f32(66); }
+    float rain_3h() const { return f32(70); }
+    float snow_3h() const { return f32(74); }
+    const char* dt_txt() const { return str(78); }
+};
+
+class OWM_WireForecast : public OWM_WireView {
+public:
+    OWM_WireForecast(const uint8_t* m) : OWM_WireView(m, m + OWM_WIRE_HEADER_SIZE) {}
+    int cnt() const { return u16(0); }
+    float lat() const { return f32(2); }
+    float lon() const { return f32(6); }
+    int timezone() const { return i32(10); }
+    unsigned long sunrise() const { return u32(14); }
+    unsigned long sunset() const { return u32(18); }
+    const char* city_name() const { return str(22); }
+    const char* country() const { return str(24); }
+    OWM_WireForecastItem item(int index) const {
+        return OWM_WireForecastItem(_msg, _p + OWM_WIRE_FORECAST_SIZE +
+                                          (size_t)index * OWM_WIRE_FORECAST_ITEM_SIZE);
+    }
+};
+
+/**
+ * @brief Validated handle on a received message
+ *
+ * Construct over the received bytes and check valid() before using any
+ * view; after that every field and string offset is known to be in range.
+ */
+class OWM_WireMessage {
+public:
+    /**
+     * @param data Received bytes
+     * @param length Number of bytes received
+     * @param verifyChecksum Set to false to skip the CRC when the transport
+     *                       already guarantees integrity
+     */
+    OWM_WireMessage(const uint8_t* data, size_t length, bool verifyChecksum = true);
+
+    bool valid() const { return _type != OWM_WIRE_INVALID; }
+    OWM_WireType type() const { return _type; }
+    size_t length() const { return _length; }
+
+    OWM_WireCurrentWeather currentWeather() const { return OWM_WireCurrentWeather(_data); }
+    OWM_WireForecast forecast() const { return OWM_WireForecast(_data); }
+    OWM_WireAirPollution airPollution() const { return OWM_WireAirPollution(_data); }
+    OWM_WireGeoLocation geoLocation() const { return OWM_WireGeoLocation(_data); }
+
+private:
+    const uint8_t* _data;
+    size_t _length;
+    OWM_WireType _type;
+};
+
+#endif // OWM_WIRE_H
@@ -4,6 +4,153 @@
  */
 
 #include "OpenWeatherMap.h"
+#include "OWM_JsonParser.h"
+#include "OWM_Metrics.h"
+#include "OWM_Recorder.h"
+#include <new>
+
+#if defined(ESP32)
+    #include <esp_heap_caps.h>
+#else
+    #include <malloc.h>
+    #include <unistd.h>
+#endif
+
+// TLS connect to a cached address, with the host name for SNI
+// (WiFiClientSecure of the ESP32 core 2.x and later)
+#if defined(ESP32) && defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 2
+    #define OWM_TLS_CONNECT_BY_IP 1
+#else
+    #define OWM_TLS_CONNECT_BY_IP 0
+#endif
+
+// TCP connect and TLS handshake as separate steps, so each can be timed
+// (setPlainStart() / startTLS() of the ESP32 core 3.x)
+#if defined(ESP32) && defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    #define OWM_TLS_SPLIT_CONNECT 1
+#else
+    #define OWM_TLS_SPLIT_CONNECT 0
+#endif
+
+// State shared between forecastEach() and its streaming handlers
+struct ForecastStreamContext {
+    OWM_ForecastCallback callback;
+    void* userData;
+    int delivered;
+};
+
+// State shared between the air pollution *Each() methods and their handlers
+struct AirPollutionStreamContext {
+    OWM_AirPollutionCallback callback;
+    void* userData;
+    int total;
+};
+
+// One connection; the configured scheme picks which client is used
+struct OWM_HttpConnection {
+#if defined(ESP32)
+    WiFiClient plainClient;
+    WiFiClientSecure secureClient;
+#elif defined(ARDUINO_UNOWIFIR4)
+    WiFiClient plainClient;
+    WiFiSSLClient secureClient;
+#endif
+    OWM_RecorderClient* recorderClient; // Wraps the client while recording or replaying
+    
+    // The wrapper holds a 400-byte request line, so it is only allocated
+    // for connections made while a recorder is attached
+    OWM_HttpConnection() : recorderClient(NULL) {}
+    ~OWM_HttpConnection() {
+        delete recorderClient;
+    }
+    
+    OWM_RecorderClient* recorder() {
+        if (recorderClient == NULL) {
+            recorderClient = new (std::nothrow) OWM_RecorderClient();
+        }
+        return recorderClient;
+    }
+};
+
+// Table-driven copy of a JSON object into a struct (see JSON Field Helpers)
+static void applyJsonFields(JsonObjectConst obj, const OWM_FieldTable* table, void* base);
+
+// Endpoint group a request path belongs to (for metrics)
+static OWM_Endpoint endpointOf(const char* path) {
+    if (strncmp(path, "/geo/", 5) == 0) {
+        return OWM_ENDPOINT_GEOCODING;
+    }
+    if (strncmp(path, "/data/2.5/air_pollution", 23) == 0) {
+        return OWM_ENDPOINT_AIR_POLLUTION;
+    }
+    if (strncmp(path, "/data/2.5/forecast", 18) == 0) {
+        return OWM_ENDPOINT_FORECAST;
+    }
+    return OWM_ENDPOINT_CURRENT_WEATHER;
+}
+
+// Adds the time until it goes out of scope to one or two durations
+struct OWM_Stopwatch {
+    unsigned long* first;
+    unsigned long* second;
+    unsigned long start;
+    
+    OWM_Stopwatch(unsigned long* a, unsigned long* b = NULL) 
+        : first(a), second(b), start(micros()) {}
+    ~OWM_Stopwatch() {
+        unsigned long elapsed = micros() - start;
+        *first += elapsed;
+        if (second != NULL) {
+            *second += elapsed;
+        }
+    }
+};
+
+// Tracing hooks (see setTraceObserver()); without OWM_ENABLE_TRACING
+// every one of them compiles to nothing
+#if OWM_ENABLE_TRACING
+    #define OWM_TRACE(...) trace(__VA_ARGS__)
+    #define OWM_TRACE_PARSE() ParseTrace parseTrace(this)
+    #define OWM_TRACE_LOOKUP(endpoint, hit) traceCacheLookup(endpoint, hit)
+    #define OWM_TRACE_START(endpoint) traceRequestStart(endpoint)
+    #define OWM_TRACE_FANOUT(count) (_traceBase = reserveTraceIds(count))
+    #define OWM_TRACE_INDEX(index) (_traceId = _traceBase + (index), _traceOpen = true)
+    #define OWM_TRACE_SLOT(slot) (_traceId = (slot).traceId, _traceEndpoint = (slot).endpoint)
+#else
+    #define OWM_TRACE(...) ((void)0)
+    #define OWM_TRACE_PARSE() ((void)0)
+    #define OWM_TRACE_LOOKUP(endpoint, hit) ((void)0)
+    #define OWM_TRACE_START(endpoint) ((void)0)
+    #define OWM_TRACE_FANOUT(count) ((void)0)
+    #define OWM_TRACE_INDEX(index) ((void)0)
+    #define OWM_TRACE_SLOT(slot) ((void)0)
+#endif
+
+// Free heap (bytes)
+static size_t freeHeap() {
+#if defined(ESP32)
+    return heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+#else
+    // Free blocks inside the heap plus the gap between its end and the stack
+    struct mallinfo info = mallinfo();
+    char top;
+    return info.fordblks + (size_t)(&top - (char*)sbrk(0));
+#endif
+}
+
+// Usable size of a heap block
+static size_t blockSize(void* ptr) {
+#if defined(ESP32)
+    return heap_caps_get_allocated_size(ptr);
+#else
+    return malloc_usable_size(ptr);
+#endif
+}
+
+#if OWM_HAS_PARALLEL_PARSE
+static int parseAirPollutionSplit(const char* json, size_t length, 
+                                  OWM_AirPollution* list, int maxItems);
+#endif
 
 // ============================================================================
 // Constructor & Initialization
@@ -15,18 +162,64 @@ OpenWeatherMap::OpenWeatherMap() {
     strcpy(_lang, "en");
     _debug = false;
     _useHttps = false;
+    _host[0] = '\0';
+    _port = 0;
     _lastHttpCode = 0;
     _lastError[0] = '\0';
     _timeout = OWM_DEFAULT_TIMEOUT_MS;
+    _bodyRemaining = -1;
+    _bodyChunked = false;
+    _keepAlive = false;
+    _maxConcurrency = OWM_DEFAULT_CONCURRENCY;
+    _parallelParse = false;
+    memset(&_timings, 0, sizeof(_timings));
+    _requestTimings = &_timings;
+    _metrics = NULL;
+    _recorder = NULL;
+    _parseFailed = false;
+    _memoryStatsEnabled = false;
+    memset(&_memoryStats, 0, sizeof(_memoryStats));
+    _startFreeHeap = 0;
+    _stackBase = 0;
+    _memoryDepth = 0;
+    _documentBytes = 0;
+    _documentAllocator.owner = this;
+    _traceObserver = NULL;
+    _traceId = 0;
+    _traceLastId = 0;
+    _traceBase = 0;
+    _traceOpen = false;
+    _traceEndpoint = OWM_ENDPOINT_CURRENT_WEATHER;
+    setParser(OWM_PARSER_ARDUINOJSON);
     
     // Cache initialization
     _cacheDuration = OWM_CACHE_DURATION_MS;
-    _lastWeatherTime = 0;
     _lastForecastTime = 0;
     _lastAirPollutionTime = 0;
-    _cachedLat = 0;
-    _cachedLon = 0;
-    _hasCachedWeather = false;
+    _weatherCacheFirst.used = false;
+    _weatherCache = &_weatherCacheFirst;
+    _weatherCacheSize = 1;
+    _weatherCacheTick = 0;
+    _cachedAirLat = 0;
+    _cachedAirLon = 0;
+    _hasCachedAirPollution = false;
+    for (int i = 0; i < OWM_DNS_CACHE_SIZE; i++) {
+        _dns[i].host[0] = '\0';
+        _dns[i].resolvedAt = 0;
+    }
+    _dnsTtl = OWM_DNS_CACHE_TTL_MS;
+    _dnsFailedAt = 0;
+    _dnsFailed = false;
+    _forecastOwner = NULL;
+    _forecastLat = 0;
+    _forecastLon = 0;
+    _forecastCnt = 0;
+}
+
+OpenWeatherMap::~OpenWeatherMap() {
+    if (_weatherCache != &_weatherCacheFirst) {
+        free(_weatherCache);
+    }
 }
 
 void OpenWeatherMap::begin(const char* apiKey, bool useHttps) {
@@ -35,6 +228,16 @@ void OpenWeatherMap::begin(const char* apiKey, bool useHttps) {
     _useHttps = useHttps;
 }
 
+void OpenWeatherMap::setServer(const char* host, uint16_t port) {
+    if (host != NULL) {
+        strncpy(_host, host, sizeof(_host) - 1);
+        _host[sizeof(_host) - 1] = '\0';
+    } else {
+        _host[0] = '\0';
+    }
+    _port = port;
+}
+
 void OpenWeatherMap::setUnits(OWM_Units units) {
     _units = units;
 }
@@ -52,10 +255,87 @@ void OpenWeatherMap::setCacheDuration(unsigned long durationMs) {
     _cacheDuration = durationMs;
 }
 
+void OpenWeatherMap::setDnsCacheTtl(unsigned long ttlMs) {
+    _dnsTtl = ttlMs;
+}
+
+bool OpenWeatherMap::refreshDns() {
+    // Nothing to keep fresh when the TLS client resolves the name itself
+    if (_dnsTtl == 0 || (_useHttps && !OWM_TLS_CONNECT_BY_IP)) {
+        return false;
+    }
+    
+    // Renew shortly before expiry, or halfway through short TTLs
+    unsigned long margin = min(_dnsTtl / 2, (unsigned long)OWM_DNS_REFRESH_MS);
+    bool retry = !_dnsFailed || millis() - _dnsFailedAt >= OWM_DNS_RETRY_MS;
+    IPAddress address;
+    for (int i = 0; i < OWM_DNS_CACHE_SIZE && retry; i++) {
+        DnsEntry& entry = _dns[i];
+        if (entry.host[0] != '\0' && millis() - entry.resolvedAt >= _dnsTtl - margin) {
+            retry = lookupHost(entry.host, address);
+        }
+    }
+    
+    const char* host = apiHost();
+    DnsEntry* entry = findDnsEntry(host);
+    if (entry != NULL && millis() - entry->resolvedAt < _dnsTtl) {
+        return true;
+    }
+    return retry && lookupHost(host, address);
+}
+
+bool OpenWeatherMap::setWeatherCacheSize(uint16_t entries) {
+    WeatherCacheEntry* cache = &_weatherCacheFirst;
+    if (entries > 1) {
+        cache = (WeatherCacheEntry*)malloc(sizeof(WeatherCacheEntry) * entries);
+        if (cache == NULL) {
+            setError("Out of memory");
+            return false;
+        }
+    } else {
+        entries = 1;
+    }
+    
+    if (_weatherCache != &_weatherCacheFirst) {
+        free(_weatherCache);
+    }
+    _weatherCache = cache;
+    _weatherCacheSize = entries;
+    for (uint16_t i = 0; i < entries; i++) {
+        _weatherCache[i].used = false;
+    }
+    return true;
+}
+
 void OpenWeatherMap::setTimeout(unsigned long timeoutMs) {
     _timeout = timeoutMs;
 }
 
+void OpenWeatherMap::setParser(OWM_Endpoint endpoint, OWM_Parser parser) {
+    if (endpoint < OWM_ENDPOINT_COUNT) {
+        _parsers[endpoint] = parser;
+    }
+}
+
+void OpenWeatherMap::setParser(OWM_Parser parser) {
+    for (int i = 0; i < OWM_ENDPOINT_COUNT; i++) {
+        _parsers[i] = parser;
+    }
+}
+
+void OpenWeatherMap::setParallelParse(bool enable) {
+    _parallelParse = enable;
+}
+
+void OpenWeatherMap::setMaxConcurrency(uint8_t count) {
+    if (count < 1) {
+        count = 1;
+    } else if (count > OWM_MAX_CONCURRENCY) {
+        count = OWM_MAX_CONCURRENCY;
+    }
+    _maxConcurrency = count;
+}
+
 // ============================================================================
 // Geocoding API Implementation
 // ============================================================================
@@ -63,6 +343,7 @@ void OpenWeatherMap::setTimeout(unsigned long timeoutMs) {
 int OpenWeatherMap::getCoordinatesByName(const char* cityName, const char* countryCode, 
                                           const char* stateCode, OWM_GeoLocation* results, 
                                           int maxResults) {
+    MemoryScope memory(this);
     if (maxResults > OWM_MAX_GEO_RESULTS) {
         maxResults = OWM_MAX_GEO_RESULTS;
     }
@@ -97,31 +378,34 @@ int OpenWeatherMap::getCoordinatesByName(const char* cityName, const char* count
              "/geo/1.0/direct?q=%s&limit=%d&appid=%s",
              encodedQuery.c_str(), maxResults, _apiKey);
     
-    String response;
-    if (!httpGet(OWM_GEO_HOST, path, response)) {
-        return -1;
-    }
-    
-    return parseGeoLocations(response, results, maxResults);
+    return fetchGeoLocations(path, results, maxResults);
 }
 
 bool OpenWeatherMap::getCoordinatesByZip(const char* zipCode, const char* countryCode, 
                                           OWM_GeoLocation* location) {
+    MemoryScope memory(this);
     char path[256];
     snprintf(path, sizeof(path), 
              "/geo/1.0/zip?zip=%s,%s&appid=%s",
              zipCode, countryCode, _apiKey);
     
+    if (_parsers[OWM_ENDPOINT_GEOCODING] == OWM_PARSER_SAX) {
+        memset(location, 0, sizeof(OWM_GeoLocation));
+        OWM_GeoZipHandler handler(location);
+        return httpGetParsed(geoHost(), path, &handler);
+    }
+    
     String response;
-    if (!httpGet(OWM_GEO_HOST, path, response)) {
+    if (!httpGet(geoHost(), path, response)) {
         return false;
     }
     
-    return parseGeoZip(response, location);
+    return recordParsed(OWM_ENDPOINT_GEOCODING, parseGeoZip(response, location));
 }
 
 int OpenWeatherMap::getLocationByCoordinates(float lat, float lon, 
                                               OWM_GeoLocation* results, int maxResults) {
+    MemoryScope memory(this);
     if (maxResults > OWM_MAX_GEO_RESULTS) {
         maxResults = OWM_MAX_GEO_RESULTS;
     }
@@ -131,12 +415,33 @@ int OpenWeatherMap::getLocationByCoordinates(float lat, float lon,
              "/geo/1.0/reverse?lat=%.4f&lon=%.4f&limit=%d&appid=%s",
              lat, lon, maxResults, _apiKey);
     
+    return fetchGeoLocations(path, results, maxResults);
+}
+
+int OpenWeatherMap::fetchGeoLocations(const char* path, OWM_GeoLocation* results, 
+                                      int maxResults) {
+    if (_parsers[OWM_ENDPOINT_GEOCODING] == OWM_PARSER_SAX) {
+        if (maxResults > 0) {
+            memset(results, 0, sizeof(OWM_GeoLocation) * maxResults);
+        }
+        OWM_GeoListHandler handler(results, maxResults);
+        if (!httpGetParsed(geoHost(), path, &handler)) {
+            return -1;
+        }
+        if (handler.count() < 0) {
+            setError("Invalid response format");
+        }
+        return handler.count();
+    }
+    
     String response;
-    if (!httpGet(OWM_GEO_HOST, path, response)) {
+    if (!httpGet(geoHost(), path, response)) {
         return -1;
     }
     
-    return parseGeoLocations(response, results, maxResults);
+    int count = parseGeoLocations(response, results, maxResults);
+    recordParsed(OWM_ENDPOINT_GEOCODING, count >= 0);
+    return count;
 }
 
 // ============================================================================
@@ -144,41 +449,30 @@ int OpenWeatherMap::getLocationByCoordinates(float lat, float lon,
 // ============================================================================
 
 bool OpenWeatherMap::getCurrentWeather(float lat, float lon, OWM_CurrentWeather* weather) {
+    MemoryScope memory(this);
     // Check cache first
-    if (_cacheDuration > 0 && _hasCachedWeather) {
-        unsigned long now = millis();
-        // Check if cache is still valid and coordinates match
-        if ((now - _lastWeatherTime) < _cacheDuration &&
-            abs(_cachedLat - lat) < 0.01 && abs(_cachedLon - lon) < 0.01) {
-            debugPrintln("Using cached weather data");
-            memcpy(weather, &_cachedWeather, sizeof(OWM_CurrentWeather));
-            return true;
-        }
+    if (readWeatherCache(lat, lon, weather)) {
+        return true;
     }
     
-    char unitsParam[16], langParam[16];
-    buildUnitsParam(unitsParam, sizeof(unitsParam));
-    buildLangParam(langParam, sizeof(langParam));
-    
     char path[256];
-    snprintf(path, sizeof(path), 
-             "/data/2.5/weather?lat=%.4f&lon=%.4f%s%s&appid=%s",
-             lat, lon, unitsParam, langParam, _apiKey);
+    buildCurrentWeatherPath(lat, lon, path, sizeof(path));
     
-    String response;
-    if (!httpGet(OWM_API_HOST, path, response)) {
-        return false;
+    bool success;
+    if (_parsers[OWM_ENDPOINT_CURRENT_WEATHER] == OWM_PARSER_SAX) {
+        memset(weather, 0, sizeof(OWM_CurrentWeather));
+        OWM_CurrentWeatherHandler handler(weather);
+        success = httpGetParsed(apiHost(), path, &handler);
+    } else {
+        String response;
+        success = httpGet(apiHost(), path, response) &&
+                  recordParsed(OWM_ENDPOINT_CURRENT_WEATHER, 
+                               parseCurrentWeather(response, weather));
     }
     
-    bool success = parseCurrentWeather(response, weather);
-    
     // Update cache on success
-    if (success && _cacheDuration > 0) {
-        memcpy(&_cachedWeather, weather, sizeof(OWM_CurrentWeather));
-        _cachedLat = lat;
-        _cachedLon = lon;
-        _lastWeatherTime = millis();
-        _hasCachedWeather = true;
+    if (success) {
+        writeWeatherCache(lat, lon, weather);
     }
     
     return success;
@@ -186,6 +480,7 @@ bool OpenWeatherMap::getCurrentWeather(float lat, float lon, OWM_CurrentWeather*
 
 bool OpenWeatherMap::getCurrentWeatherByCity(const char* cityName, const char* countryCode, 
                                               OWM_CurrentWeather* weather) {
+    MemoryScope memory(this);
     // First, get coordinates using geocoding
     OWM_GeoLocation location;
     int count = getCoordinatesByName(cityName, countryCode, NULL, &location, 1);
@@ -199,53 +494,243 @@ bool OpenWeatherMap::getCurrentWeatherByCity(const char* cityName, const char* c
     return getCurrentWeather(location.lat, location.lon, weather);
 }
 
+// Index of the city with the given id, -1 if none
+static int findCity(const OWM_GeoLocation* cities, int count, unsigned long id) {
+    for (int i = 0; i < count; i++) {
+        if (cities[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int OpenWeatherMap::getCurrentWeatherGroup(const OWM_GeoLocation* cities, int count, 
+                                           OWM_CurrentWeather* results) {
+    MemoryScope memory(this);
+    int found = 0;
+    char path[384];
+    
+    for (int start = 0; start < count; start += OWM_MAX_GROUP_CITIES) {
+        int n = count - start;
+        if (n > OWM_MAX_GROUP_CITIES) {
+            n = OWM_MAX_GROUP_CITIES;
+        }
+        const OWM_GeoLocation* group = &cities[start];
+        OWM_CurrentWeather* out = &results[start];
+        
+        buildGroupPath(group, n, path, sizeof(path));
+        if (fetchCurrentWeatherGroup(path, out, n) < 0) {
+            return -1;
+        }
+        
+        // Records come back in the API's order: move each to its city's
+        // slot (every swap settles one slot for good)
+        for (int i = 0; i < n; i++) {
+            while (out[i].id != group[i].id) {
+                int target = findCity(group, n, out[i].id);
+                if (target < 0 || out[target].id == group[target].id) {
+                    break;      // Empty, unknown or duplicate record
+                }
+                OWM_CurrentWeather tmp;
+                memcpy(&tmp, &out[target], sizeof(OWM_CurrentWeather));
+                memcpy(&out[target], &out[i], sizeof(OWM_CurrentWeather));
+                memcpy(&out[i], &tmp, sizeof(OWM_CurrentWeather));
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            if (out[i].id == group[i].id && group[i].id != 0) {
+                found++;
+            } else {
+                memset(&out[i], 0, sizeof(OWM_CurrentWeather));
+            }
+        }
+    }
+    
+    return found;
+}
+
+int OpenWeatherMap::fetchCurrentWeatherGroup(const char* path, OWM_CurrentWeather* list, 
+                                             int maxItems) {
+    if (_parsers[OWM_ENDPOINT_CURRENT_WEATHER] == OWM_PARSER_SAX) {
+        memset(list, 0, sizeof(OWM_CurrentWeather) * maxItems);
+        OWM_CurrentWeatherListHandler handler(list, maxItems);
+        return httpGetParsed(apiHost(), path, &handler) ? handler.count() : -1;
+    }
+    
+    String response;
+    if (!httpGet(apiHost(), path, response)) {
+        return -1;
+    }
+    
+    int count = parseCurrentWeatherGroup(response, list, maxItems);
+    recordParsed(OWM_ENDPOINT_CURRENT_WEATHER, count >= 0);
+    return count;
+}
+
+// State shared between getCurrentWeatherBatch() and its fan-out handlers
+struct WeatherBatchContext {
+    const OWM_Coord* coords;
+    OWM_CurrentWeather* results;
+    OWM_Status* status;
+    OWM_CurrentWeatherCallback callback;
+    void* userData;
+    int succeeded;
+    OWM_SchemaHandler handlers[OWM_MAX_CONCURRENCY];
+};
+
+int OpenWeatherMap::getCurrentWeatherBatch(const OWM_Coord* coords, size_t count, 
+                                           OWM_CurrentWeather* results, OWM_Status* status,
+                                           OWM_CurrentWeatherCallback callback, void* userData) {
+    MemoryScope memory(this);
+    WeatherBatchContext ctx;
+    ctx.coords = coords;
+    ctx.results = results;
+    ctx.status = status;
+    ctx.callback = callback;
+    ctx.userData = userData;
+    ctx.succeeded = 0;
+    
+    // Serve what the cache has; the rest is fetched by the fan-out engine
+    OWM_TRACE_FANOUT(count);
+    bool stopped = false;
+    for (size_t i = 0; i < count; i++) {
+        status[i] = OWM_STATUS_CANCELLED;
+        OWM_TRACE_INDEX(i);
+        if (!stopped && readWeatherCache(coords[i].lat, coords[i].lon, &results[i])) {
+            status[i] = OWM_STATUS_CACHED;
+            ctx.succeeded++;
+            if (callback != NULL && !callback(&results[i], i, userData)) {
+                stopped = true;
+            }
+        }
+    }
+    
+    if (!stopped) {
+        runFanOut(apiHost(), count, &OpenWeatherMap::beginBatchWeather, 
+                  &OpenWeatherMap::endBatchWeather, &ctx);
+    }
+    return ctx.succeeded;
+}
+
+OWM_JsonHandler* OpenWeatherMap::beginBatchWeather(int index, int slot, char* path, 
+                                                   size_t size, void* context) {
+    WeatherBatchContext* ctx = (WeatherBatchContext*)context;
+    if (ctx->status[index] == OWM_STATUS_CACHED) {
+        return NULL;
+    }
+    
+    buildCurrentWeatherPath(ctx->coords[index].lat, ctx->coords[index].lon, path, size);
+    memset(&ctx->results[index], 0, sizeof(OWM_CurrentWeather));
+    ctx->handlers[slot].setTarget(&owmCurrentWeatherSchema, &ctx->results[index]);
+    return &ctx->handlers[slot];
+}
+
+bool OpenWeatherMap::endBatchWeather(int index, OWM_Status status, void* context) {
+    WeatherBatchContext* ctx = (WeatherBatchContext*)context;
+    ctx->status[index] = status;
+    if (status != OWM_STATUS_OK) {
+        return true;
+    }
+    
+    const OWM_Coord* coord = &ctx->coords[index];
+    writeWeatherCache(coord->lat, coord->lon, &ctx->results[index]);
+    ctx->succeeded++;
+    return ctx->callback == NULL || ctx->callback(&ctx->results[index], index, ctx->userData);
+}
+
 // ============================================================================
 // Air Pollution API Implementation
 // ============================================================================
 
 bool OpenWeatherMap::getAirPollution(float lat, float lon, OWM_AirPollution* pollution) {
+    MemoryScope memory(this);
+    if (readAirPollutionCache(lat, lon, pollution)) {
+        return true;
+    }
+    
     char path[256];
-    snprintf(path, sizeof(path), 
-             "/data/2.5/air_pollution?lat=%.4f&lon=%.4f&appid=%s",
-             lat, lon, _apiKey);
+    buildAirPollutionPath(lat, lon, path, sizeof(path));
     
-    String response;
-    if (!httpGet(OWM_API_HOST, path, response)) {
-        return false;
+    bool success;
+    if (_parsers[OWM_ENDPOINT_AIR_POLLUTION] == OWM_PARSER_SAX) {
+        memset(pollution, 0, sizeof(OWM_AirPollution));
+        OWM_AirPollutionListHandler handler(pollution, 1);
+        success = httpGetParsed(apiHost(), path, &handler);
+    } else {
+        String response;
+        success = httpGet(apiHost(), path, response) &&
+                  recordParsed(OWM_ENDPOINT_AIR_POLLUTION, 
+                               parseAirPollution(response, pollution));
+    }
+    
+    if (success) {
+        writeAirPollutionCache(lat, lon, pollution);
     }
     
-    return parseAirPollution(response, pollution);
+    return success;
 }
 
 int OpenWeatherMap::getAirPollutionForecast(float lat, float lon, 
                                              OWM_AirPollution* forecast, int maxItems) {
+    MemoryScope memory(this);
     char path[256];
-    snprintf(path, sizeof(path), 
-             "/data/2.5/air_pollution/forecast?lat=%.4f&lon=%.4f&appid=%s",
-             lat, lon, _apiKey);
-    
-    String response;
-    if (!httpGet(OWM_API_HOST, path, response)) {
-        return -1;
-    }
+    buildAirPollutionForecastPath(lat, lon, path, sizeof(path));
     
-    return parseAirPollutionList(response, forecast, maxItems);
+    return fetchAirPollutionList(path, forecast, maxItems);
 }
 
 int OpenWeatherMap::getAirPollutionHistory(float lat, float lon, unsigned long startTime, 
                                             unsigned long endTime, OWM_AirPollution* history, 
                                             int maxItems) {
+    MemoryScope memory(this);
     char path[320];
-    snprintf(path, sizeof(path), 
-             "/data/2.5/air_pollution/history?lat=%.4f&lon=%.4f&start=%lu&end=%lu&appid=%s",
-             lat, lon, startTime, endTime, _apiKey);
+    buildAirPollutionHistoryPath(lat, lon, startTime, endTime, path, sizeof(path));
+    
+    return fetchAirPollutionList(path, history, maxItems);
+}
+
+int OpenWeatherMap::fetchAirPollutionList(const char* path, OWM_AirPollution* list, 
+                                          int maxItems) {
+    // Split parsing needs the whole body in memory, so it is not streamed
+    bool buffered = false;
+#if OWM_HAS_PARALLEL_PARSE
+    buffered = _parallelParse;
+#endif
+    if (_parsers[OWM_ENDPOINT_AIR_POLLUTION] == OWM_PARSER_SAX && !buffered) {
+        if (maxItems > 0) {
+            memset(list, 0, sizeof(OWM_AirPollution) * maxItems);
+        }
+        OWM_AirPollutionListHandler handler(list, maxItems);
+        return httpGetParsed(apiHost(), path, &handler) ? handler.count() : -1;
+    }
     
     String response;
-    if (!httpGet(OWM_API_HOST, path, response)) {
+    if (!httpGet(apiHost(), path, response)) {
         return -1;
     }
     
-    return parseAirPollutionList(response, history, maxItems);
+    int count = parseAirPollutionList(response, list, maxItems);
+    recordParsed(OWM_ENDPOINT_AIR_POLLUTION, count >= 0);
+    return count;
+}
+
+int OpenWeatherMap::airPollutionForecastEach(float lat, float lon, 
+                                             OWM_AirPollutionCallback callback, void* userData) {
+    MemoryScope memory(this);
+    char path[256];
+    buildAirPollutionForecastPath(lat, lon, path, sizeof(path));
+    
+    return streamAirPollution(path, callback, userData);
+}
+
+int OpenWeatherMap::airPollutionHistoryEach(float lat, float lon, unsigned long startTime, 
+                                            unsigned long endTime, 
+                                            OWM_AirPollutionCallback callback, void* userData) {
+    MemoryScope memory(this);
+    char path[320];
+    buildAirPollutionHistoryPath(lat, lon, startTime, endTime, path, sizeof(path));
+    
+    return streamAirPollution(path, callback, userData);
 }
 
 // ============================================================================
@@ -253,31 +738,27 @@ int OpenWeatherMap::getAirPollutionHistory(float lat, float lon, unsigned long s
 // ============================================================================
 
 bool OpenWeatherMap::getForecast(float lat, float lon, OWM_Forecast* forecast, int cnt) {
-    char unitsParam[16], langParam[16], cntParam[16];
-    buildUnitsParam(unitsParam, sizeof(unitsParam));
-    buildLangParam(langParam, sizeof(langParam));
+    MemoryScope memory(this);
+    char path[256];
+    buildForecastPath(lat, lon, cnt, path, sizeof(path));
     
-    if (cnt > 0) {
-        snprintf(cntParam, sizeof(cntParam), "&cnt=%d", cnt);
-    } else {
-        cntParam[0] = '\0';
+    if (_parsers[OWM_ENDPOINT_FORECAST] == OWM_PARSER_SAX) {
+        memset(forecast, 0, sizeof(OWM_Forecast));
+        OWM_ForecastHandler handler(forecast);
+        return httpGetParsed(apiHost(), path, &handler);
     }
     
-    char path[256];
-    snprintf(path, sizeof(path), 
-             "/data/2.5/forecast?lat=%.4f&lon=%.4f%s%s%s&appid=%s",
-             lat, lon, unitsParam, langParam, cntParam, _apiKey);
-    
     String response;
-    if (!httpGet(OWM_API_HOST, path, response)) {
+    if (!httpGet(apiHost(), path, response)) {
         return false;
     }
     
-    return parseForecast(response, forecast);
+    return recordParsed(OWM_ENDPOINT_FORECAST, parseForecast(response, forecast));
 }
 
 bool OpenWeatherMap::getForecastByCity(const char* cityName, const char* countryCode, 
                                         OWM_Forecast* forecast, int cnt) {
+    MemoryScope memory(this);
     // First, get coordinates using geocoding
     OWM_GeoLocation location;
     int count = getCoordinatesByName(cityName, countryCode, NULL, &location, 1);
@@ -291,275 +772,1378 @@ bool OpenWeatherMap::getForecastByCity(const char* cityName, const char* country
     return getForecast(location.lat, location.lon, forecast, cnt);
 }
 
-// ============================================================================
-// Utility Functions
-// ============================================================================
-
-const char* OpenWeatherMap::getAQIDescription(int aqi) {
-    switch (aqi) {
-        case OWM_AQI_GOOD:      return "Good";
-        case OWM_AQI_FAIR:      return "Fair";
-        case OWM_AQI_MODERATE:  return "Moderate";
-        case OWM_AQI_POOR:      return "Poor";
-        case OWM_AQI_VERY_POOR: return "Very Poor";
-        default:                return "Unknown";
+int OpenWeatherMap::forecastEach(float lat, float lon, OWM_ForecastCallback callback, 
+                                 void* userData, int cnt) {
+    MemoryScope memory(this);
+    if (callback == NULL) {
+        setError("No callback");
+        return -1;
+    }
+    
+    char path[256];
+    buildForecastPath(lat, lon, cnt, path, sizeof(path));
+    
+    ForecastStreamContext ctx;
+    ctx.callback = callback;
+    ctx.userData = userData;
+    ctx.delivered = -1;
+    
+    if (!httpGetStream(apiHost(), path, &OpenWeatherMap::readForecastStream, &ctx)) {
+        return -1;
     }
+    
+    return ctx.delivered;
 }
 
-char* OpenWeatherMap::getIconURL(const char* iconCode, char* buffer, size_t bufferSize) {
-    snprintf(buffer, bufferSize, "%s://openweathermap.org/img/wn/%s@2x.png", 
-             _useHttps ? "https" : "http", iconCode);
-    return buffer;
-}
+// ============================================================================
+// Combined Requests
+// ============================================================================
 
-int OpenWeatherMap::getLastHttpCode() const {
-    return _lastHttpCode;
-}
+// Snapshot parts, in request order
+enum {
+    SNAPSHOT_WEATHER,
+    SNAPSHOT_AIR_POLLUTION,
+    SNAPSHOT_FORECAST,
+    SNAPSHOT_PART_COUNT
+};
 
-const char* OpenWeatherMap::getLastError() const {
-    return _lastError;
-}
+// State shared between getSnapshot() and its fan-out handlers
+struct SnapshotContext {
+    OWM_Snapshot* snapshot;
+    int forecastCnt;
+    OWM_SchemaHandler weatherHandler;
+    OWM_AirPollutionListHandler airPollutionHandler;
+    OWM_ForecastHandler forecastHandler;
+    
+    SnapshotContext(OWM_Snapshot* s) 
+        : snapshot(s), airPollutionHandler(&s->airPollution, 1), forecastHandler(&s->forecast) {}
+};
 
-// ============================================================================
-// Private Methods - HTTP
-// ============================================================================
+// Data present, fetched or from the cache
+static bool isAvailable(OWM_Status status) {
+    return status == OWM_STATUS_OK || status == OWM_STATUS_CACHED;
+}
 
-bool OpenWeatherMap::httpGet(const char* host, const char* path, String& response) {
-#if defined(ESP32)
-    // ESP32: Use HTTPClient for better performance
-    HTTPClient http;
-    
-    // Build URL
-    String url;
-    if (_useHttps) {
-        url = "https://";
-    } else {
-        url = "http://";
+bool OpenWeatherMap::getSnapshot(float lat, float lon, OWM_Snapshot* snapshot, int forecastCnt) {
+    MemoryScope memory(this);
+    SnapshotContext ctx(snapshot);
+    ctx.forecastCnt = forecastCnt;
+    
+    snapshot->weatherStatus = OWM_STATUS_CANCELLED;
+    snapshot->airPollutionStatus = OWM_STATUS_CANCELLED;
+    snapshot->forecastStatus = OWM_STATUS_CANCELLED;
+    
+    // A forecast is only kept in the snapshot that received it
+    OWM_TRACE_FANOUT(SNAPSHOT_PART_COUNT);
+    OWM_TRACE_INDEX(SNAPSHOT_FORECAST);
+    bool sameLocation = (snapshot->lat == lat && snapshot->lon == lon);
+    if (_cacheDuration > 0 && _forecastOwner == snapshot && sameLocation &&
+        _forecastCnt == forecastCnt && (millis() - _lastForecastTime) < _cacheDuration) {
+        debugPrintln("Using cached forecast data");
+        recordCacheHit(OWM_ENDPOINT_FORECAST);
+        snapshot->forecastStatus = OWM_STATUS_CACHED;
+    } else if (_cacheDuration > 0) {
+        OWM_TRACE_LOOKUP(OWM_ENDPOINT_FORECAST, false);
     }
-    url += host;
-    url += path;
+    snapshot->lat = lat;
+    snapshot->lon = lon;
     
-    debugPrint("GET ");
-    debugPrintln(url.c_str());
-    
-    // Configure timeout
-    http.setTimeout(_timeout);
-    
-    if (!http.begin(url)) {
-        setError("HTTP begin failed");
-        return false;
+    OWM_TRACE_INDEX(SNAPSHOT_WEATHER);
+    if (readWeatherCache(lat, lon, &snapshot->weather)) {
+        snapshot->weatherStatus = OWM_STATUS_CACHED;
     }
-    
-    // Set headers
-    http.addHeader("Connection", "close");
-    
-    // Send request
-    _lastHttpCode = http.GET();
-    
-    debugPrint("HTTP Code: ");
-    if (_debug) Serial.println(_lastHttpCode);
-    
-    if (_lastHttpCode != 200) {
-        snprintf(_lastError, sizeof(_lastError), "HTTP Error: %d", _lastHttpCode);
-        http.end();
-        return false;
+    OWM_TRACE_INDEX(SNAPSHOT_AIR_POLLUTION);
+    if (readAirPollutionCache(lat, lon, &snapshot->airPollution)) {
+        snapshot->airPollutionStatus = OWM_STATUS_CACHED;
     }
     
-    // Get response
-    response = http.getString();
-    http.end();
-    
-    return true;
+    runFanOut(apiHost(), SNAPSHOT_PART_COUNT, &OpenWeatherMap::beginSnapshotPart, 
+              &OpenWeatherMap::endSnapshotPart, &ctx);
+    
+    return isAvailable(snapshot->weatherStatus) &&
+           isAvailable(snapshot->airPollutionStatus) &&
+           isAvailable(snapshot->forecastStatus);
+}
+
+OWM_JsonHandler* OpenWeatherMap::beginSnapshotPart(int index, int slot, char* path, 
+                                                   size_t size, void* context) {
+    SnapshotContext* ctx = (SnapshotContext*)context;
+    OWM_Snapshot* s = ctx->snapshot;
+    
+    switch (index) {
+        case SNAPSHOT_WEATHER:
+            if (s->weatherStatus == OWM_STATUS_CACHED) {
+                return NULL;
+            }
+            buildCurrentWeatherPath(s->lat, s->lon, path, size);
+            memset(&s->weather, 0, sizeof(OWM_CurrentWeather));
+            ctx->weatherHandler.setTarget(&owmCurrentWeatherSchema, &s->weather);
+            return &ctx->weatherHandler;
+        case SNAPSHOT_AIR_POLLUTION:
+            if (s->airPollutionStatus == OWM_STATUS_CACHED) {
+                return NULL;
+            }
+            buildAirPollutionPath(s->lat, s->lon, path, size);
+            memset(&s->airPollution, 0, sizeof(OWM_AirPollution));
+            return &ctx->airPollutionHandler;
+        default:
+            if (s->forecastStatus == OWM_STATUS_CACHED) {
+                return NULL;
+            }
+            buildForecastPath(s->lat, s->lon, ctx->forecastCnt, path, size);
+            memset(&s->forecast, 0, sizeof(OWM_Forecast));
+            return &ctx->forecastHandler;
+    }
+}
+
+bool OpenWeatherMap::endSnapshotPart(int index, OWM_Status status, void* context) {
+    SnapshotContext* ctx = (SnapshotContext*)context;
+    OWM_Snapshot* s = ctx->snapshot;
+    
+    switch (index) {
+        case SNAPSHOT_WEATHER:
+            s->weatherStatus = status;
+            if (status == OWM_STATUS_OK) {
+                writeWeatherCache(s->lat, s->lon, &s->weather);
+            }
+            break;
+        case SNAPSHOT_AIR_POLLUTION:
+            // An empty "list" parses fine but carries no record
+            if (status == OWM_STATUS_OK && ctx->airPollutionHandler.count() == 0) {
+                status = OWM_STATUS_PARSE_ERROR;
+            }
+            s->airPollutionStatus = status;
+            if (status == OWM_STATUS_OK) {
+                writeAirPollutionCache(s->lat, s->lon, &s->airPollution);
+            }
+            break;
+        default:
+            s->forecastStatus = status;
+            if (status == OWM_STATUS_OK) {
+                _forecastOwner = s;
+                _forecastCnt = ctx->forecastCnt;
+                _lastForecastTime = millis();
+            } else if (_forecastOwner == s) {
+                _forecastOwner = NULL;
+            }
+            break;
+    }
+    return true;
+}
+
+// State shared between fetchRequests() and its fan-out handlers
+struct RequestContext {
+    OWM_Request* requests;
+    int succeeded;
+    int slotIndex[OWM_MAX_CONCURRENCY];   // Request running in each slot
+    OWM_SchemaHandler weatherHandlers[OWM_MAX_CONCURRENCY];
+    OWM_AirPollutionListHandler airPollutionHandlers[OWM_MAX_CONCURRENCY];
+    OWM_ForecastHandler forecastHandlers[OWM_MAX_CONCURRENCY];
+};
+
+int OpenWeatherMap::fetchRequests(OWM_Request* requests, size_t count) {
+    MemoryScope memory(this);
+    RequestContext ctx;
+    ctx.requests = requests;
+    ctx.succeeded = 0;
+    for (int slot = 0; slot < OWM_MAX_CONCURRENCY; slot++) {
+        ctx.slotIndex[slot] = -1;
+    }
+    
+    OWM_TRACE_FANOUT(count);
+    for (size_t i = 0; i < count; i++) {
+        OWM_Request* r = &requests[i];
+        r->status = OWM_STATUS_CANCELLED;
+        OWM_TRACE_INDEX(i);
+        if ((r->endpoint == OWM_ENDPOINT_CURRENT_WEATHER &&
+             readWeatherCache(r->lat, r->lon, (OWM_CurrentWeather*)r->result)) ||
+            (r->endpoint == OWM_ENDPOINT_AIR_POLLUTION &&
+             readAirPollutionCache(r->lat, r->lon, (OWM_AirPollution*)r->result))) {
+            r->status = OWM_STATUS_CACHED;
+            ctx.succeeded++;
+        }
+    }
+    
+    runFanOut(apiHost(), count, &OpenWeatherMap::beginRequest, 
+              &OpenWeatherMap::endRequest, &ctx);
+    return ctx.succeeded;
+}
+
+OWM_JsonHandler* OpenWeatherMap::beginRequest(int index, int slot, char* path, 
+                                              size_t size, void* context) {
+    RequestContext* ctx = (RequestContext*)context;
+    OWM_Request* r = &ctx->requests[index];
+    if (r->status == OWM_STATUS_CACHED) {
+        return NULL;
+    }
+    
+    ctx->slotIndex[slot] = index;
+    switch (r->endpoint) {
+        case OWM_ENDPOINT_CURRENT_WEATHER:
+            buildCurrentWeatherPath(r->lat, r->lon, path, size);
+            memset(r->result, 0, sizeof(OWM_CurrentWeather));
+            ctx->weatherHandlers[slot].setTarget(&owmCurrentWeatherSchema, r->result);
+            return &ctx->weatherHandlers[slot];
+        case OWM_ENDPOINT_AIR_POLLUTION:
+            buildAirPollutionPath(r->lat, r->lon, path, size);
+            memset(r->result, 0, sizeof(OWM_AirPollution));
+            ctx->airPollutionHandlers[slot].setTarget((OWM_AirPollution*)r->result, 1);
+            return &ctx->airPollutionHandlers[slot];
+        case OWM_ENDPOINT_FORECAST:
+            buildForecastPath(r->lat, r->lon, r->cnt, path, size);
+            memset(r->result, 0, sizeof(OWM_Forecast));
+            ctx->forecastHandlers[slot].setTarget((OWM_Forecast*)r->result);
+            return &ctx->forecastHandlers[slot];
+        default:
+            return NULL;
+    }
+}
+
+bool OpenWeatherMap::endRequest(int index, OWM_Status status, void* context) {
+    RequestContext* ctx = (RequestContext*)context;
+    OWM_Request* r = &ctx->requests[index];
+    
+    if (status == OWM_STATUS_OK && r->endpoint == OWM_ENDPOINT_AIR_POLLUTION) {
+        // An empty "list" parses fine but carries no record
+        for (int slot = 0; slot < OWM_MAX_CONCURRENCY; slot++) {
+            if (ctx->slotIndex[slot] == index) {
+                if (ctx->airPollutionHandlers[slot].count() == 0) {
+                    status = OWM_STATUS_PARSE_ERROR;
+                }
+                break;
+            }
+        }
+    }
+    
+    r->status = status;
+    if (status != OWM_STATUS_OK) {
+        return true;
+    }
+    
+    if (r->endpoint == OWM_ENDPOINT_CURRENT_WEATHER) {
+        writeWeatherCache(r->lat, r->lon, (OWM_CurrentWeather*)r->result);
+    } else if (r->endpoint == OWM_ENDPOINT_AIR_POLLUTION) {
+        writeAirPollutionCache(r->lat, r->lon, (OWM_AirPollution*)r->result);
+    }
+    ctx->succeeded++;
+    return true;
+}
+
+// ============================================================================
+// Utility Functions
+// ============================================================================
+
+const char* OpenWeatherMap::getAQIDescription(int aqi) {
+    switch (aqi) {
+        case OWM_AQI_GOOD:      return "Good";
+        case OWM_AQI_FAIR:      return "Fair";
+        case OWM_AQI_MODERATE:  return "Moderate";
+        case OWM_AQI_POOR:      return "Poor";
+        case OWM_AQI_VERY_POOR: return "Very Poor";
+        default:                return "Unknown";
+    }
+}
+
+char* OpenWeatherMap::getIconURL(const char* iconCode, char* buffer, size_t bufferSize) {
+    snprintf(buffer, bufferSize, "%s://openweathermap.org/img/wn/%s@2x.png", 
+             _useHttps ? "https" : "http", iconCode);
+    return buffer;
+}
+
+int OpenWeatherMap::getLastHttpCode() const {
+    return _lastHttpCode;
+}
+
+const char* OpenWeatherMap::getLastError() const {
+    return _lastError;
+}
+
+OWM_Timings OpenWeatherMap::getLastTimings() const {
+    return _timings;
+}
+
+void OpenWeatherMap::setMemoryStats(bool enable) {
+    _memoryStatsEnabled = enable;
+}
+
+OWM_MemoryStats OpenWeatherMap::getLastMemoryStats() const {
+    return _memoryStats;
+}
+
+void OpenWeatherMap::setMetrics(OWM_Metrics* metrics) {
+    _metrics = metrics;
+}
+
+void OpenWeatherMap::setRecorder(OWM_Recorder* recorder) {
+    _recorder = recorder;
+}
+
+void OpenWeatherMap::setTraceObserver(OWM_TraceObserver* observer) {
+    _traceObserver = observer;
+}
+
+// ============================================================================
+// Private Methods - HTTP
+// ============================================================================
+
+bool OpenWeatherMap::httpGet(const char* host, const char* path, String& response) {
+    return httpGetStream(host, path, &OpenWeatherMap::readStringBody, &response);
+}
+
+bool OpenWeatherMap::httpGetParsed(const char* host, const char* path, 
+                                   OWM_JsonHandler* handler) {
+    // Parse each chunk as soon as it arrives instead of buffering the body
+    OWM_JsonParser parser(handler);
+    return httpGetStream(host, path, &OpenWeatherMap::readJsonBody, &parser);
+}
+
+bool OpenWeatherMap::httpGetStream(const char* host, const char* path, 
+                                   BodyReader reader, void* context) {
+    memset(&_timings, 0, sizeof(_timings));
+    _requestTimings = &_timings;
+    _parseFailed = false;
+    MemoryScope memory(this);
+    
+    OWM_Endpoint endpoint = endpointOf(path);
+    OWM_TRACE_START(endpoint);
+    
+    unsigned long start = micros();
+    OWM_Status status;
+    bool success = performRequest(host, path, reader, context, &status);
+    _timings.total = micros() - start;
+    
+    // A body read into a String is recorded by the caller once it has
+    // been parsed (see recordParsed())
+    if (!success || reader != &OpenWeatherMap::readStringBody) {
+        recordRequest(endpoint, status, &_timings);
+    }
+    return success;
+}
+
+bool OpenWeatherMap::performRequest(const char* host, const char* path, BodyReader reader, 
+                                    void* context, OWM_Status* status) {
+    // Raw client on both platforms so the body can be consumed as it arrives
+    OWM_HttpConnection connection;
+    Client* connected = openConnection(connection, host, &_timings);
+    *status = OWM_STATUS_CONNECTION_FAILED;
+    if (connected == NULL) {
+        return false;
+    }
+    Client& client = *connected;
+    
+    debugPrint("GET ");
+    debugPrintln(path);
+    
+    sendRequest(client, host, path, false);
+    
+    unsigned long sent = micros();
+    *status = OWM_STATUS_TIMEOUT;
+    if (!readResponseHeaders(client, status)) {
+        client.stop();
+        return false;
+    }
+    
+    debugPrint("HTTP Code: ");
+    if (_debug) Serial.println(_lastHttpCode);
+    
+    unsigned long bodyStart = micros();
+    _timings.ttfb = bodyStart - sent;
+    
+    if (_lastHttpCode != 200) {
+        snprintf(_lastError, sizeof(_lastError), "HTTP Error: %d", _lastHttpCode);
+        OWM_TRACE(OWM_TRACE_ERROR, _lastError);
+        *status = OWM_STATUS_HTTP_ERROR;
+        client.stop();
+        return false;
+    }
+    
+    bool success = (this->*reader)(client, context);
+    _timings.download = micros() - bodyStart - _timings.parse;
+    client.stop();
+    
+    if (success) {
+        *status = OWM_STATUS_OK;
+    } else {
+        *status = _parseFailed ? OWM_STATUS_PARSE_ERROR : OWM_STATUS_TIMEOUT;
+    }
+    return success;
+}
+
+Client* OpenWeatherMap::openConnection(OWM_HttpConnection& connection, const char* host, 
+                                       OWM_Timings* timings) {
+    // Replayed responses need no network at all
+    if (_recorder != NULL && _recorder->replaying()) {
+        OWM_RecorderClient* replayed = connection.recorder();
+        if (replayed == NULL) {
+            setError("Out of memory");
+            return NULL;
+        }
+        replayed->beginReplay(_recorder);
+        replayed->setTimeout(_timeout);
+        OWM_TRACE(OWM_TRACE_CONNECTED);
+        return replayed;
+    }
+    
+#if defined(ESP32)
+    if (_useHttps) {
+        connection.secureClient.setInsecure();
+    }
+#endif
+    Client& client = _useHttps ? (Client&)connection.secureClient 
+                               : (Client&)connection.plainClient;
+    int port = _useHttps ? OWM_API_PORT_HTTPS : OWM_API_PORT_HTTP;
+    if (_port != 0) {
+        port = _port;
+    }
     
-#elif defined(ARDUINO_UNOWIFIR4)
-    // Arduino UNO R4 WiFi: Use manual socket (no HTTPClient available)
     debugPrint("Connecting to ");
     debugPrintln(host);
     
-    int port;
-    bool connected = false;
+    // Resolve first so the lookup is timed on its own (or skipped while
+    // the address is cached); the Host header carries the name. A TLS
+    // client that only connects by name resolves it itself.
+    bool byName = _useHttps && !OWM_TLS_CONNECT_BY_IP;
+    IPAddress address;
+    if (!byName && !resolveHost(host, address, timings)) {
+        setError("DNS lookup failed");
+        return NULL;
+    }
     
-    if (_useHttps) {
-        WiFiSSLClient sslClient;
-        port = OWM_API_PORT_HTTPS;
-        connected = sslClient.connect(host, port);
-        if (!connected) {
-            setError("Connection failed");
+    unsigned long start = micros();
+    bool connected;
+    if (!_useHttps) {
+        connected = client.connect(address, port);
+        timings->connect = micros() - start;
+    } else {
+#if OWM_TLS_SPLIT_CONNECT
+        connection.secureClient.setPlainStart();
+        connected = connection.secureClient.connect(address, port, host, NULL, NULL, NULL);
+        timings->connect = micros() - start;
+        start = micros();
+        connected = connected && connection.secureClient.startTLS();
+#elif OWM_TLS_CONNECT_BY_IP
+        connected = connection.secureClient.connect(address, port, host, NULL, NULL, NULL);
+#else
+        // The TLS client needs the name (SNI)
+        connected = client.connect(host, port);
+#endif
+        timings->tls = micros() - start;
+    }
+    if (!connected) {
+        if (!byName) {
+            forgetHost(host);   // The server may have moved
+        }
+        setError("Connection failed");
+        return NULL;
+    }
+    
+    client.setTimeout(_timeout);
+    sampleMemory();     // TLS buffers are allocated by now
+    OWM_TRACE(OWM_TRACE_CONNECTED);
+    
+    // Without memory for the wrapper the request goes unrecorded
+    OWM_RecorderClient* recorded = (_recorder != NULL && _recorder->recording()) 
+                                   ? connection.recorder() : NULL;
+    if (recorded != NULL) {
+        recorded->beginRecord(_recorder, &client, 
+                              timings->dns + timings->connect + timings->tls);
+        recorded->setTimeout(_timeout);
+        return recorded;
+    }
+    return &client;
+}
+
+void OpenWeatherMap::sendRequest(Client& client, const char* host, const char* path, 
+                                 bool keepAlive) {
+    // Single requests use HTTP/1.0 so the server never switches to chunked
+    // transfer encoding; keep-alive connections need HTTP/1.1
+    size_t sent = client.print("GET ");
+    sent += client.print(path);
+    sent += client.println(keepAlive ? " HTTP/1.1" : " HTTP/1.0");
+    sent += client.print("Host: ");
+    sent += client.println(host);
+    sent += client.println(keepAlive ? "Connection: keep-alive" : "Connection: close");
+    sent += client.println();
+    _requestTimings->bytesSent += sent;
+}
+
+bool OpenWeatherMap::readResponseHeaders(Client& client, OWM_Status* status) {
+    char line[128];
+    
+    _bodyRemaining = -1;
+    _bodyChunked = false;
+    
+    // Status line, e.g. "HTTP/1.1 200 OK"
+    size_t len = client.readBytesUntil('\n', line, sizeof(line) - 1);
+    if (len == 0) {
+        setError("Response timeout");
+        return false;
+    }
+    _requestTimings->headerBytes += len + 1;
+    line[len] = '\0';
+    if (parseHeaderLine(line, len, true, false) < 0) {
+        *status = OWM_STATUS_INVALID_RESPONSE;
+        return false;
+    }
+    
+    // Header lines up to the blank line that separates the body
+    bool truncated = false;
+    while (true) {
+        len = client.readBytesUntil('\n', line, sizeof(line) - 1);
+        if (len == 0) {
+            setError("Read timeout");
             return false;
         }
+        _requestTimings->headerBytes += len + 1;
+        line[len] = '\0';
+        int result = parseHeaderLine(line, len, false, truncated);
+        if (result > 0) {
+            return true;
+        }
+        if (result < 0) {
+            *status = OWM_STATUS_INVALID_RESPONSE;
+            return false;
+        }
+        // Header lines longer than the buffer arrive in several pieces
+        truncated = (len == sizeof(line) - 1);
+    }
+}
+
+int OpenWeatherMap::parseHeaderLine(char* line, size_t len, bool statusLine, bool continued) {
+    // Returns -1 for a bad status line or an encoded body, 1 after the
+    // blank line that ends the headers and 0 for any other line. continued marks the rest of
+    // a line longer than the caller's buffer.
+    if (statusLine) {
+        // Anything else is not HTTP, or a kept-alive connection that got
+        // out of step with the responses
+        if (strncmp(line, "HTTP/", 5) != 0) {
+            setError("Invalid response");
+            return -1;
+        }
         
-        debugPrint("GET ");
-        debugPrintln(path);
-        
-        sslClient.print("GET ");
-        sslClient.print(path);
-        sslClient.println(" HTTP/1.1");
-        sslClient.print("Host: ");
-        sslClient.println(host);
-        sslClient.println("Connection: close");
-        sslClient.println();
+        // HTTP/1.1 connections stay open unless the server says otherwise
+        _keepAlive = (strncmp(line, "HTTP/1.1", 8) == 0);
         
-        unsigned long timeout = millis();
-        while (sslClient.available() == 0) {
-            if (millis() - timeout > _timeout) {
-                setError("Response timeout");
-                sslClient.stop();
-                return false;
+        char* space = strchr(line, ' ');
+        _lastHttpCode = (space != NULL) ? atoi(space + 1) : 0;
+        return 0;
+    }
+    
+    if (continued) {
+        return 0;
+    }
+    if (len == 1 && line[0] == '\r') {
+        if (_bodyChunked) {
+            _bodyRemaining = 0;     // First chunk header not read yet
+        }
+        OWM_TRACE(OWM_TRACE_HEADERS);
+        return 1;
+    }
+    if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        _bodyRemaining = atol(line + 15);
+    } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+        _bodyChunked = (strstr(line + 18, "chunked") != NULL);
+    } else if (strncasecmp(line, "Connection:", 11) == 0) {
+        _keepAlive = (strstr(line + 11, "close") == NULL);
+    } else if (strncasecmp(line, "Content-Encoding:", 17) == 0) {
+        // No Accept-Encoding is sent, so only an identity body can be parsed
+        const char* value = line + 17;
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        if (strncasecmp(value, "identity", 8) != 0) {
+            setError("Unsupported Content-Encoding");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+bool OpenWeatherMap::readChunkHeader(Client& client) {
+    char line[32];
+    size_t len;
+    
+    // Every chunk but the first follows the CRLF that ends the previous one
+    do {
+        len = client.readBytesUntil('\n', line, sizeof(line) - 1);
+        if (len == 0) {
+            setError("Read timeout");
+            return false;
+        }
+    } while (len == 1 && line[0] == '\r');
+    line[len] = '\0';
+    
+    _bodyRemaining = strtol(line, NULL, 16);
+    if (_bodyRemaining <= 0) {
+        // Last chunk; consume the blank line after it
+        _bodyRemaining = 0;
+        _bodyChunked = false;
+        client.readBytesUntil('\n', line, sizeof(line) - 1);
+    }
+    return true;
+}
+
+int OpenWeatherMap::readBodyChunk(Client& client, char* buffer, size_t size) {
+    if (_bodyChunked && _bodyRemaining == 0 && !readChunkHeader(client)) {
+        return -1;
+    }
+    if (_bodyRemaining == 0) {
+        return 0;
+    }
+    
+    // Wait for the next segment; the end of the body is either the
+    // announced Content-Length or the server closing the connection
+    unsigned long start = millis();
+    while (client.available() <= 0) {
+        if (!client.connected()) {
+            return 0;
+        }
+        if (millis() - start > _timeout) {
+            setError("Read timeout");
+            return -1;
+        }
+        delay(1);
+    }
+    
+    size_t count = client.available();
+    if (count > size) {
+        count = size;
+    }
+    if (_bodyRemaining > 0 && (long)count > _bodyRemaining) {
+        count = _bodyRemaining;
+    }
+    
+    int n = client.read((uint8_t*)buffer, count);
+    if (n <= 0) {
+        return 0;
+    }
+    if (_requestTimings->bodyBytes == 0) {
+        OWM_TRACE(OWM_TRACE_FIRST_BYTE);
+    }
+    _requestTimings->bodyBytes += n;
+    if (_bodyRemaining > 0) {
+        _bodyRemaining -= n;
+    }
+    sampleMemory();
+    return n;
+}
+
+bool OpenWeatherMap::readStringBody(Client& body, void* context) {
+    String* response = (String*)context;
+    char buffer[256];
+    int n;
+    
+    *response = "";
+    response->reserve(_bodyRemaining > 0 ? _bodyRemaining : 2048);
+    
+    while ((n = readBodyChunk(body, buffer, sizeof(buffer) - 1)) > 0) {
+        buffer[n] = '\0';
+        *response += buffer;
+    }
+    if (n < 0) {
+        return false;
+    }
+    if (_bodyRemaining > 0 || _bodyChunked) {
+        setError("Incomplete response");
+        return false;
+    }
+    _memoryStats.bodyBuffer = response->length();
+    return true;
+}
+
+bool OpenWeatherMap::readJsonBody(Client& body, void* context) {
+    OWM_JsonParser* parser = (OWM_JsonParser*)context;
+    char buffer[256];
+    OWM_TRACE_PARSE();
+    
+    // Stop as soon as the root closes; no need to wait for the server
+    // to drop the connection
+    while (!parser->done()) {
+        int n = readBodyChunk(body, buffer, sizeof(buffer));
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        unsigned long start = micros();
+        bool fed = parser->feed(buffer, n);
+        _requestTimings->parse += micros() - start;
+        if (!fed) {
+            break;
+        }
+    }
+    
+    // A handler that stopped the parser has all it wanted
+    if (!parser->finish() && !parser->stopped()) {
+        setParseError();
+        return false;
+    }
+    return true;
+}
+
+const char* OpenWeatherMap::apiHost() const {
+    return _host[0] != '\0' ? _host : OWM_API_HOST;
+}
+
+const char* OpenWeatherMap::geoHost() const {
+    return _host[0] != '\0' ? _host : OWM_GEO_HOST;
+}
+
+void OpenWeatherMap::buildUnitsParam(char* buffer, size_t size) {
+    switch (_units) {
+        case OWM_UNITS_METRIC:
+            strncpy(buffer, "&units=metric", size);
+            break;
+        case OWM_UNITS_IMPERIAL:
+            strncpy(buffer, "&units=imperial", size);
+            break;
+        default:
+            buffer[0] = '\0';  // Standard units (default)
+            break;
+    }
+}
+
+void OpenWeatherMap::buildLangParam(char* buffer, size_t size) {
+    snprintf(buffer, size, "&lang=%s", _lang);
+}
+
+void OpenWeatherMap::buildAirPollutionPath(float lat, float lon, char* path, size_t size) {
+    snprintf(path, size, 
+             "/data/2.5/air_pollution?lat=%.4f&lon=%.4f&appid=%s",
+             lat, lon, _apiKey);
+}
+
+void OpenWeatherMap::buildAirPollutionForecastPath(float lat, float lon, char* path, size_t size) {
+    snprintf(path, size, 
+             "/data/2.5/air_pollution/forecast?lat=%.4f&lon=%.4f&appid=%s",
+             lat, lon, _apiKey);
+}
+
+void OpenWeatherMap::buildAirPollutionHistoryPath(float lat, float lon, unsigned long startTime, 
+                                                  unsigned long endTime, char* path, size_t size) {
+    snprintf(path, size, 
+             "/data/2.5/air_pollution/history?lat=%.4f&lon=%.4f&start=%lu&end=%lu&appid=%s",
+             lat, lon, startTime, endTime, _apiKey);
+}
+
+void OpenWeatherMap::buildCurrentWeatherPath(float lat, float lon, char* path, size_t size) {
+    char unitsParam[16], langParam[16];
+    buildUnitsParam(unitsParam, sizeof(unitsParam));
+    buildLangParam(langParam, sizeof(langParam));
+    
+    snprintf(path, size, 
+             "/data/2.5/weather?lat=%.4f&lon=%.4f%s%s&appid=%s",
+             lat, lon, unitsParam, langParam, _apiKey);
+}
+
+void OpenWeatherMap::buildGroupPath(const OWM_GeoLocation* cities, int count, 
+                                    char* path, size_t size) {
+    char unitsParam[16], langParam[16];
+    buildUnitsParam(unitsParam, sizeof(unitsParam));
+    buildLangParam(langParam, sizeof(langParam));
+    
+    size_t len = snprintf(path, size, "/data/2.5/group?id=");
+    for (int i = 0; i < count && len < size; i++) {
+        len += snprintf(path + len, size - len, i == 0 ? "%lu" : ",%lu", cities[i].id);
+    }
+    if (len < size) {
+        snprintf(path + len, size - len, "%s%s&appid=%s", unitsParam, langParam, _apiKey);
+    }
+}
+
+void OpenWeatherMap::buildForecastPath(float lat, float lon, int cnt, char* path, size_t size) {
+    char unitsParam[16], langParam[16], cntParam[16];
+    buildUnitsParam(unitsParam, sizeof(unitsParam));
+    buildLangParam(langParam, sizeof(langParam));
+    
+    if (cnt > 0) {
+        snprintf(cntParam, sizeof(cntParam), "&cnt=%d", cnt);
+    } else {
+        cntParam[0] = '\0';
+    }
+    
+    snprintf(path, size, 
+             "/data/2.5/forecast?lat=%.4f&lon=%.4f%s%s%s&appid=%s",
+             lat, lon, unitsParam, langParam, cntParam, _apiKey);
+}
+
+// ============================================================================
+// Private Methods - Fan-out
+// ============================================================================
+
+// Fan-out slot states
+enum {
+    SLOT_IDLE,          // No request; the connection may still be open
+    SLOT_HEADERS,       // Request sent, waiting for the response headers
+    SLOT_BODY           // Feeding the body to the parser
+};
+
+// One request in flight on its own connection
+struct OWM_FanOutSlot {
+    OWM_HttpConnection connection;
+    Client* client;           // NULL when no connection is open
+    int index;                // Request being served
+    uint8_t state;
+    bool reused;              // Sent on a connection kept open from an earlier request
+    bool keepAlive;
+    unsigned long started;
+    int httpCode;
+    long bodyRemaining;       // Body framing of this slot (see readBodyChunk())
+    bool bodyChunked;
+    char line[64];            // Header or chunk line received so far (see pollSlot())
+    uint8_t lineLength;
+    bool lineContinued;       // line is the rest of a longer header line
+    bool statusRead;
+    bool chunkTrailer;        // Past the last chunk, reading up to the blank line
+    OWM_JsonParser parser;
+    OWM_Endpoint endpoint;
+    OWM_Timings timings;
+    unsigned long startedUs;  // micros() when the request was started
+    unsigned long sentUs;     // ... sent
+    unsigned long bodyUs;     // ... when its body started
+#if OWM_ENABLE_TRACING
+    uint32_t traceId;
+#endif
+    
+    OWM_FanOutSlot() : client(NULL), index(-1), state(SLOT_IDLE), parser(NULL) {}
+};
+
+int OpenWeatherMap::runFanOut(const char* host, int count, FanOutBegin begin, 
+                              FanOutEnd end, void* context) {
+    MemoryScope memory(this);
+#if OWM_ENABLE_TRACING
+    _traceOpen = false;       // Requests take their ids from _traceBase
+#endif
+    // Fewer slots are better than none when the heap is short
+    int slotCount = _maxConcurrency;
+    OWM_FanOutSlot* slots = NULL;
+    while (slotCount > 0 && slots == NULL) {
+        slots = new (std::nothrow) OWM_FanOutSlot[slotCount];
+        if (slots == NULL) {
+            slotCount /= 2;
+        }
+    }
+    if (slots == NULL) {
+        setError("Out of memory");
+        char path[384];
+        for (int index = 0; index < count; index++) {
+            if ((this->*begin)(index, 0, path, sizeof(path), context) != NULL &&
+                !(this->*end)(index, OWM_STATUS_CONNECTION_FAILED, context)) {
+                break;
+            }
+        }
+        return 0;
+    }
+    
+    int next = 0;
+    int active = 0;
+    int succeeded = 0;
+    bool stopped = false;
+    
+    while (!stopped && (next < count || active > 0)) {
+        // Give every idle slot the next request
+        for (int i = 0; i < slotCount && !stopped; i++) {
+            while (slots[i].state == SLOT_IDLE && next < count && !stopped) {
+                int index = next++;
+                if (!startSlot(slots[i], i, index, host, begin, context)) {
+                    recordRequest(slots[i].endpoint, OWM_STATUS_CONNECTION_FAILED, 
+                                  &slots[i].timings);
+                    stopped = !(this->*end)(index, OWM_STATUS_CONNECTION_FAILED, context);
+                } else if (slots[i].state != SLOT_IDLE) {
+                    active++;
+                }
             }
-            delay(10);
         }
         
-        response = "";
-        response.reserve(2048);
-        bool headersDone = false;
-        String line;
-        line.reserve(256);
-        char buffer[256];
-        
-        timeout = millis();
-        while (sslClient.connected() || sslClient.available()) {
-            if (millis() - timeout > _timeout) {
-                setError("Read timeout");
-                sslClient.stop();
-                return false;
+        // Collect whatever has arrived, in completion order
+        bool progressed = false;
+        for (int i = 0; i < slotCount && !stopped; i++) {
+            OWM_FanOutSlot& slot = slots[i];
+            OWM_Status status;
+            if (slot.state == SLOT_IDLE || !pollSlot(slot, &status, &progressed)) {
+                continue;
             }
             
-            if (sslClient.available()) {
-                timeout = millis();
-                
-                if (!headersDone) {
-                    char c = sslClient.read();
-                    line += c;
-                    if (line.endsWith("\r\n")) {
-                        if (line.startsWith("HTTP/")) {
-                            int spaceIdx = line.indexOf(' ');
-                            if (spaceIdx > 0) {
-                                _lastHttpCode = line.substring(spaceIdx + 1, spaceIdx + 4).toInt();
-                            }
-                        }
-                        if (line == "\r\n") {
-                            headersDone = true;
-                        }
-                        line = "";
-                    }
-                } else {
-                    int bytesRead = sslClient.readBytes(buffer, sizeof(buffer) - 1);
-                    if (bytesRead > 0) {
-                        buffer[bytesRead] = '\0';
-                        response += buffer;
-                    }
+            if (status == OWM_STATUS_CONNECTION_FAILED && slot.reused) {
+                // The server closed a kept-alive connection: resend on a new one
+                debugPrintln("Connection closed, reconnecting");
+                slot.client->stop();
+                slot.client = NULL;
+                slot.state = SLOT_IDLE;
+                if (startSlot(slot, i, slot.index, host, begin, context)) {
+                    continue;
                 }
-            } else {
-                delay(1);
+            }
+            
+            finishSlot(slot, status);
+            active--;
+            progressed = true;
+            if (status == OWM_STATUS_OK) {
+                succeeded++;
+            }
+            if (!(this->*end)(slot.index, status, context)) {
+                stopped = true;
             }
         }
-        sslClient.stop();
-    } else {
-        // Use plain HTTP (faster, no SSL handshake)
-        WiFiClient httpClient;
-        port = OWM_API_PORT_HTTP;
-        connected = httpClient.connect(host, port);
-        if (!connected) {
-            setError("Connection failed");
+        
+        if (!progressed) {
+            delay(1);
+        }
+    }
+    
+    _requestTimings = &_timings;
+    for (int i = 0; i < slotCount; i++) {
+        if (slots[i].state != SLOT_IDLE) {
+            OWM_TRACE_SLOT(slots[i]);
+            recordRequest(slots[i].endpoint, OWM_STATUS_CANCELLED, NULL);
+            (this->*end)(slots[i].index, OWM_STATUS_CANCELLED, context);
+        }
+        if (slots[i].client != NULL) {
+            slots[i].client->stop();
+        }
+    }
+    delete[] slots;
+    
+    return succeeded;
+}
+
+bool OpenWeatherMap::startSlot(OWM_FanOutSlot& slot, int slotNumber, int index, 
+                               const char* host, FanOutBegin begin, void* context) {
+    char path[384];
+    OWM_JsonHandler* handler = (this->*begin)(index, slotNumber, path, sizeof(path), context);
+    if (handler == NULL) {
+        return true;        // Nothing to fetch for this index
+    }
+    
+    memset(&slot.timings, 0, sizeof(slot.timings));
+    slot.startedUs = micros();
+    slot.endpoint = endpointOf(path);
+    _requestTimings = &slot.timings;
+#if OWM_ENABLE_TRACING
+    slot.traceId = _traceBase + index;
+#endif
+    OWM_TRACE_SLOT(slot);
+    OWM_TRACE(OWM_TRACE_REQUEST_START);
+    
+    slot.reused = (slot.client != NULL && slot.client->connected());
+    slot.timings.reused = slot.reused;
+    if (!slot.reused) {
+        if (slot.client != NULL) {
+            slot.client->stop();
+        }
+        slot.client = openConnection(slot.connection, host, &slot.timings);
+        if (slot.client == NULL) {
+            slot.timings.total = micros() - slot.startedUs;
             return false;
         }
-        
-        debugPrint("GET ");
-        debugPrintln(path);
-        
-        httpClient.print("GET ");
-        httpClient.print(path);
-        httpClient.println(" HTTP/1.1");
-        httpClient.print("Host: ");
-        httpClient.println(host);
-        httpClient.println("Connection: close");
-        httpClient.println();
-        
-        unsigned long timeout = millis();
-        while (httpClient.available() == 0) {
-            if (millis() - timeout > _timeout) {
-                setError("Response timeout");
-                httpClient.stop();
+    }
+    
+    debugPrint("GET ");
+    debugPrintln(path);
+    sendRequest(*slot.client, host, path, true);
+    slot.sentUs = micros();
+    
+    slot.parser = OWM_JsonParser(handler);
+    slot.index = index;
+    slot.state = SLOT_HEADERS;
+    slot.keepAlive = false;
+    slot.httpCode = 0;
+    slot.bodyRemaining = -1;
+    slot.bodyChunked = false;
+    slot.lineLength = 0;
+    slot.lineContinued = false;
+    slot.statusRead = false;
+    slot.chunkTrailer = false;
+    slot.started = millis();
+    return true;
+}
+
+bool OpenWeatherMap::pollSlot(OWM_FanOutSlot& slot, OWM_Status* status, bool* progressed) {
+    Client& client = *slot.client;
+    _requestTimings = &slot.timings;
+    OWM_TRACE_SLOT(slot);
+    
+    // A body parsed in time that only misses its end keeps its result;
+    // the connection is not reused (see finishSlot())
+    bool expired = (millis() - slot.started > _timeout);
+    if (expired && !(slot.state == SLOT_BODY && slot.parser.done())) {
+        setError("Read timeout");
+        *status = OWM_STATUS_TIMEOUT;
+        return true;
+    }
+    
+    if (slot.state == SLOT_HEADERS) {
+        if (client.available() <= 0) {
+            if (client.connected()) {
                 return false;
             }
-            delay(10);
+            setError("Connection closed");
+            *status = slot.reused ? OWM_STATUS_CONNECTION_FAILED : OWM_STATUS_TIMEOUT;
+            return true;
         }
         
-        response = "";
-        response.reserve(2048);
-        bool headersDone = false;
-        String line;
-        line.reserve(256);
-        char buffer[256];
-        
-        timeout = millis();
-        while (httpClient.connected() || httpClient.available()) {
-            if (millis() - timeout > _timeout) {
-                setError("Read timeout");
-                httpClient.stop();
-                return false;
+        // Take the header lines that have arrived without waiting for the
+        // rest, so one slow server does not hold up the other slots
+        *progressed = true;
+        _bodyRemaining = slot.bodyRemaining;
+        _bodyChunked = slot.bodyChunked;
+        _keepAlive = slot.keepAlive;
+        _lastHttpCode = slot.httpCode;
+        int result = 0;
+        while (result == 0 && client.available() > 0) {
+            int c = client.read();
+            if (c < 0) {
+                break;
+            }
+            slot.timings.headerBytes++;
+            if (c != '\n' && slot.lineLength < sizeof(slot.line) - 1) {
+                slot.line[slot.lineLength++] = (char)c;
+                continue;
             }
             
-            if (httpClient.available()) {
-                timeout = millis();
-                
-                if (!headersDone) {
-                    char c = httpClient.read();
-                    line += c;
-                    if (line.endsWith("\r\n")) {
-                        if (line.startsWith("HTTP/")) {
-                            int spaceIdx = line.indexOf(' ');
-                            if (spaceIdx > 0) {
-                                _lastHttpCode = line.substring(spaceIdx + 1, spaceIdx + 4).toInt();
-                            }
-                        }
-                        if (line == "\r\n") {
-                            headersDone = true;
-                        }
-                        line = "";
-                    }
-                } else {
-                    int bytesRead = httpClient.readBytes(buffer, sizeof(buffer) - 1);
-                    if (bytesRead > 0) {
-                        buffer[bytesRead] = '\0';
-                        response += buffer;
-                    }
-                }
-            } else {
-                delay(1);
+            // End of a line, or a full buffer: hand over what we have
+            slot.line[slot.lineLength] = '\0';
+            result = parseHeaderLine(slot.line, slot.lineLength, !slot.statusRead, 
+                                     slot.lineContinued);
+            slot.statusRead = true;
+            slot.lineContinued = (c != '\n');
+            slot.lineLength = 0;
+            if (c != '\n') {
+                slot.line[slot.lineLength++] = (char)c;
             }
         }
-        httpClient.stop();
+        slot.bodyRemaining = _bodyRemaining;
+        slot.bodyChunked = _bodyChunked;
+        slot.keepAlive = _keepAlive;
+        slot.httpCode = _lastHttpCode;
+        
+        if (result < 0) {
+            *status = OWM_STATUS_INVALID_RESPONSE;
+            return true;
+        }
+        if (result == 0) {
+            return false;
+        }
+        slot.bodyUs = micros();
+        slot.timings.ttfb = slot.bodyUs - slot.sentUs;
+        
+        if (_lastHttpCode != 200) {
+            snprintf(_lastError, sizeof(_lastError), "HTTP Error: %d", _lastHttpCode);
+            OWM_TRACE(OWM_TRACE_ERROR, _lastError);
+            *status = OWM_STATUS_HTTP_ERROR;
+            return true;
+        }
+        slot.state = SLOT_BODY;
+        OWM_TRACE(OWM_TRACE_PARSE_START);
     }
     
-    debugPrint("HTTP Code: ");
-    if (_debug) Serial.println(_lastHttpCode);
+    // Feed what has arrived, with this slot's body framing. On a
+    // kept-alive connection with a known length the rest of the body
+    // (chunk trailer included) is read too, so the next request starts
+    // on a clean connection.
+    char buffer[256];
+    bool ended = expired;
+    _bodyRemaining = slot.bodyRemaining;
+    _bodyChunked = slot.bodyChunked;
+    bool drain = slot.keepAlive && (_bodyChunked || _bodyRemaining >= 0);
+    
+    while (!ended && (!slot.parser.done() || drain)) {
+        int n = readSlotBody(slot, buffer, sizeof(buffer));
+        if (n == 0) {
+            break;      // Wait for the next segment
+        }
+        if (n < 0) {
+            ended = true;
+            break;
+        }
+        *progressed = true;
+        if (slot.parser.done()) {
+            continue;   // Past the end of the document
+        }
+        unsigned long start = micros();
+        bool fed = slot.parser.feed(buffer, n);
+        slot.timings.parse += micros() - start;
+        if (!fed) {
+            ended = true;
+        }
+    }
     
-    if (_lastHttpCode != 200) {
-        snprintf(_lastError, sizeof(_lastError), "HTTP Error: %d", _lastHttpCode);
+    slot.bodyRemaining = _bodyRemaining;
+    slot.bodyChunked = _bodyChunked;
+    
+    if (!ended && (!slot.parser.done() || drain)) {
         return false;
     }
     
+    bool parsed = slot.parser.finish();
+    OWM_TRACE(OWM_TRACE_PARSE_END);
+    if (parsed) {
+        *status = OWM_STATUS_OK;
+    } else {
+        setParseError();
+        *status = OWM_STATUS_PARSE_ERROR;
+    }
     return true;
-#endif
 }
 
-void OpenWeatherMap::buildUnitsParam(char* buffer, size_t size) {
-    switch (_units) {
-        case OWM_UNITS_METRIC:
-            strncpy(buffer, "&units=metric", size);
-            break;
-        case OWM_UNITS_IMPERIAL:
-            strncpy(buffer, "&units=imperial", size);
-            break;
-        default:
-            buffer[0] = '\0';  // Standard units (default)
+void OpenWeatherMap::finishSlot(OWM_FanOutSlot& slot, OWM_Status status) {
+    // Keep the connection for the slot's next request only if the rest of
+    // this response can be skipped cleanly
+    bool reusable = slot.keepAlive && status != OWM_STATUS_TIMEOUT && 
+                    status != OWM_STATUS_CONNECTION_FAILED && 
+                    status != OWM_STATUS_INVALID_RESPONSE;
+    _requestTimings = &slot.timings;
+    OWM_TRACE_SLOT(slot);
+    if (reusable) {
+        // Only what has already arrived; waiting for the rest (e.g. the
+        // body of an error response) would hold up the other slots
+        char buffer[64];
+        _bodyRemaining = slot.bodyRemaining;
+        _bodyChunked = slot.bodyChunked;
+        while (readSlotBody(slot, buffer, sizeof(buffer)) > 0) {
+        }
+        reusable = (_bodyRemaining == 0 && !_bodyChunked && slot.client->connected());
+    }
+    if (!reusable && slot.client != NULL) {
+        slot.client->stop();
+        slot.client = NULL;
+    }
+    
+    // The last request to finish is the one getLastTimings() reports
+    unsigned long now = micros();
+    if (slot.state == SLOT_BODY) {
+        slot.timings.download = now - slot.bodyUs - slot.timings.parse;
+    }
+    slot.timings.total = now - slot.startedUs;
+    _timings = slot.timings;
+    _requestTimings = &_timings;
+    recordRequest(slot.endpoint, status, &slot.timings);
+    slot.state = SLOT_IDLE;
+}
+
+int OpenWeatherMap::readSlotBody(OWM_FanOutSlot& slot, char* buffer, size_t size) {
+    // Returns the number of body bytes read, 0 if nothing has arrived yet
+    // and -1 once the body is complete or the connection closed. Unlike
+    // readBodyChunk() it never waits: chunk size lines and the trailer
+    // are collected in slot.line across calls.
+    Client& client = *slot.client;
+    
+    while (_bodyChunked && _bodyRemaining == 0) {
+        if (!readSlotLine(slot)) {
+            return client.connected() ? 0 : -1;
+        }
+        bool blank = (slot.line[0] == '\0' || strcmp(slot.line, "\r") == 0);
+        if (slot.chunkTrailer) {
+            if (blank) {
+                slot.chunkTrailer = false;
+                _bodyChunked = false;       // Body complete
+            }
+            continue;
+        }
+        if (blank) {
+            continue;   // CRLF after the previous chunk's data
+        }
+        _bodyRemaining = strtol(slot.line, NULL, 16);
+        if (_bodyRemaining <= 0) {
+            _bodyRemaining = 0;
+            slot.chunkTrailer = true;       // Last chunk
+        }
+    }
+    
+    if (_bodyRemaining == 0) {
+        return -1;
+    }
+    if (client.available() <= 0) {
+        return client.connected() ? 0 : -1;
+    }
+    return readBodyChunk(client, buffer, size);
+}
+
+bool OpenWeatherMap::readSlotLine(OWM_FanOutSlot& slot) {
+    // Takes the bytes that have arrived up to the end of a line; true
+    // with the line (without '\n', truncated to the buffer) in slot.line
+    Client& client = *slot.client;
+    while (client.available() > 0) {
+        int c = client.read();
+        if (c < 0) {
             break;
+        }
+        if (c == '\n') {
+            slot.line[slot.lineLength] = '\0';
+            slot.lineLength = 0;
+            return true;
+        }
+        if (slot.lineLength < sizeof(slot.line) - 1) {
+            slot.line[slot.lineLength++] = (char)c;
+        }
+    }
+    return false;
+}
+
+// ============================================================================
+// Private Methods - Cache
+// ============================================================================
+
+bool OpenWeatherMap::readWeatherCache(float lat, float lon, OWM_CurrentWeather* weather) {
+    if (_cacheDuration == 0) {
+        return false;
+    }
+    
+    // Check if cache is still valid and coordinates match
+    unsigned long now = millis();
+    WeatherCacheEntry* entry = findWeatherCache(lat, lon);
+    if (entry != NULL && (now - entry->time) < _cacheDuration) {
+        debugPrintln("Using cached weather data");
+        recordCacheHit(OWM_ENDPOINT_CURRENT_WEATHER);
+        entry->lastUsed = ++_weatherCacheTick;
+        memcpy(weather, &entry->weather, sizeof(OWM_CurrentWeather));
+        return true;
+    }
+    OWM_TRACE_LOOKUP(OWM_ENDPOINT_CURRENT_WEATHER, false);
+    return false;
+}
+
+void OpenWeatherMap::writeWeatherCache(float lat, float lon, const OWM_CurrentWeather* weather) {
+    if (_cacheDuration == 0) {
+        return;
+    }
+    
+    // Same location, else an unused entry, else the least recently used
+    WeatherCacheEntry* entry = findWeatherCache(lat, lon);
+    for (uint16_t i = 0; i < _weatherCacheSize && entry == NULL; i++) {
+        if (!_weatherCache[i].used) {
+            entry = &_weatherCache[i];
+        }
+    }
+    if (entry == NULL) {
+        entry = &_weatherCache[0];
+        for (uint16_t i = 1; i < _weatherCacheSize; i++) {
+            if (_weatherCacheTick - _weatherCache[i].lastUsed > 
+                _weatherCacheTick - entry->lastUsed) {
+                entry = &_weatherCache[i];
+            }
+        }
+    }
+    
+    memcpy(&entry->weather, weather, sizeof(OWM_CurrentWeather));
+    entry->lat = lat;
+    entry->lon = lon;
+    entry->time = millis();
+    entry->lastUsed = ++_weatherCacheTick;
+    entry->used = true;
+}
+
+OpenWeatherMap::WeatherCacheEntry* OpenWeatherMap::findWeatherCache(float lat, float lon) {
+    for (uint16_t i = 0; i < _weatherCacheSize; i++) {
+        WeatherCacheEntry& entry = _weatherCache[i];
+        if (entry.used && abs(entry.lat - lat) < 0.01 && abs(entry.lon - lon) < 0.01) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+bool OpenWeatherMap::readAirPollutionCache(float lat, float lon, OWM_AirPollution* pollution) {
+    if (_cacheDuration == 0) {
+        return false;
+    }
+    
+    unsigned long now = millis();
+    if (_hasCachedAirPollution && (now - _lastAirPollutionTime) < _cacheDuration &&
+        abs(_cachedAirLat - lat) < 0.01 && abs(_cachedAirLon - lon) < 0.01) {
+        debugPrintln("Using cached air pollution data");
+        recordCacheHit(OWM_ENDPOINT_AIR_POLLUTION);
+        memcpy(pollution, &_cachedAirPollution, sizeof(OWM_AirPollution));
+        return true;
+    }
+    OWM_TRACE_LOOKUP(OWM_ENDPOINT_AIR_POLLUTION, false);
+    return false;
+}
+
+void OpenWeatherMap::writeAirPollutionCache(float lat, float lon, const OWM_AirPollution* pollution) {
+    if (_cacheDuration == 0) {
+        return;
+    }
+    memcpy(&_cachedAirPollution, pollution, sizeof(OWM_AirPollution));
+    _cachedAirLat = lat;
+    _cachedAirLon = lon;
+    _lastAirPollutionTime = millis();
+    _hasCachedAirPollution = true;
+}
+
+// ============================================================================
+// Private Methods - DNS Cache
+// ============================================================================
+
+bool OpenWeatherMap::resolveHost(const char* host, IPAddress& address, OWM_Timings* timings) {
+    DnsEntry* entry = findDnsEntry(host);
+    if (entry != NULL && millis() - entry->resolvedAt < _dnsTtl) {
+        address = entry->address;
+        return true;
+    }
+    
+    unsigned long start = micros();
+    bool resolved = lookupHost(host, address);
+    timings->dns = micros() - start;
+    if (resolved) {
+        return true;
+    }
+    
+    // An expired address is better than none
+    entry = findDnsEntry(host);
+    if (entry != NULL) {
+        debugPrintln("DNS lookup failed, using expired address");
+        address = entry->address;
+        return true;
+    }
+    return false;
+}
+
+bool OpenWeatherMap::lookupHost(const char* host, IPAddress& address) {
+    if (!WiFi.hostByName(host, address)) {
+        _dnsFailed = true;
+        _dnsFailedAt = millis();
+        return false;
+    }
+    _dnsFailed = false;
+    if (_dnsTtl == 0) {
+        return true;
+    }
+    
+    // Same host, else an unused entry, else the oldest one
+    unsigned long now = millis();
+    DnsEntry* entry = findDnsEntry(host);
+    if (entry == NULL) {
+        entry = &_dns[0];
+        for (int i = 1; i < OWM_DNS_CACHE_SIZE && entry->host[0] != '\0'; i++) {
+            if (_dns[i].host[0] == '\0' || 
+                now - _dns[i].resolvedAt > now - entry->resolvedAt) {
+                entry = &_dns[i];
+            }
+        }
+        strncpy(entry->host, host, sizeof(entry->host) - 1);
+        entry->host[sizeof(entry->host) - 1] = '\0';
     }
+    entry->address = address;
+    entry->resolvedAt = now;
+    return true;
 }
 
-void OpenWeatherMap::buildLangParam(char* buffer, size_t size) {
-    snprintf(buffer, size, "&lang=%s", _lang);
+OpenWeatherMap::DnsEntry* OpenWeatherMap::findDnsEntry(const char* host) {
+    for (int i = 0; i < OWM_DNS_CACHE_SIZE; i++) {
+        if (_dns[i].host[0] != '\0' && strcmp(_dns[i].host, host) == 0) {
+            return &_dns[i];
+        }
+    }
+    return NULL;
+}
+
+void OpenWeatherMap::forgetHost(const char* host) {
+    DnsEntry* entry = findDnsEntry(host);
+    if (entry != NULL) {
+        entry->host[0] = '\0';
+    }
 }
 
 // ============================================================================
@@ -567,75 +2151,93 @@ void OpenWeatherMap::buildLangParam(char* buffer, size_t size) {
 // ============================================================================
 
 bool OpenWeatherMap::parseCurrentWeather(const String& json, OWM_CurrentWeather* weather) {
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
     // Clear the structure
     memset(weather, 0, sizeof(OWM_CurrentWeather));
     
+    if (_parsers[OWM_ENDPOINT_CURRENT_WEATHER] == OWM_PARSER_SAX) {
+        OWM_CurrentWeatherHandler handler(weather);
+        return runParser(json, &handler);
+    }
+    
     // Use ArduinoJson to parse
-    JsonDocument doc;
+    JsonDocument doc(&_documentAllocator);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
-        setError("JSON parse error");
+        setParseError();
         debugPrint("JSON Error: ");
         debugPrintln(error.c_str());
         return false;
     }
     
-    // Parse coordinates
-    weather->lat = doc["coord"]["lat"] | 0.0f;
-    weather->lon = doc["coord"]["lon"] | 0.0f;
+    applyJsonFields(doc.as<JsonObjectConst>(), &owmCurrentWeatherSchema, weather);
     
-    // Parse weather array (take first item)
-    if (doc["weather"].is<JsonArray>() && doc["weather"].size() > 0) {
-        JsonObject weatherObj = doc["weather"][0];
-        parseWeatherCondition(weatherObj, &weather->weather);
+    return true;
+}
+
+int OpenWeatherMap::parseCurrentWeatherGroup(const String& json, OWM_CurrentWeather* list, 
+                                             int maxItems) {
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
+    if (maxItems > 0) {
+        memset(list, 0, sizeof(OWM_CurrentWeather) * maxItems);
     }
     
-    // Parse main data
-    JsonObject mainObj = doc["main"];
-    parseMainData(mainObj, &weather->main);
-    
-    // Parse visibility
-    weather->visibility = doc["visibility"] | 0;
-    
-    // Parse wind
-    JsonObject windObj = doc["wind"];
-    parseWindData(windObj, &weather->wind);
+    if (_parsers[OWM_ENDPOINT_CURRENT_WEATHER] == OWM_PARSER_SAX) {
+        OWM_CurrentWeatherListHandler handler(list, maxItems);
+        return runParser(json, &handler) ? handler.count() : -1;
+    }
     
-    // Parse clouds
-    weather->clouds = doc["clouds"]["all"] | 0;
+    JsonDocument doc(&_documentAllocator);
+    DeserializationError error = deserializeJson(doc, json);
     
-    // Parse rain
-    weather->rain_1h = doc["rain"]["1h"] | 0.0f;
+    if (error) {
+        setParseError();
+        return -1;
+    }
     
-    // Parse snow
-    weather->snow_1h = doc["snow"]["1h"] | 0.0f;
+    JsonArray jsonList = doc["list"];
+    int count = 0;
     
-    // Parse system data
-    weather->dt = doc["dt"] | 0UL;
-    strncpy(weather->country, doc["sys"]["country"] | "", sizeof(weather->country) - 1);
-    weather->sunrise = doc["sys"]["sunrise"] | 0UL;
-    weather->sunset = doc["sys"]["sunset"] | 0UL;
-    weather->timezone = doc["timezone"] | 0;
-    strncpy(weather->name, doc["name"] | "", sizeof(weather->name) - 1);
+    for (JsonObject item : jsonList) {
+        if (count >= maxItems) break;
+        
+        applyJsonFields(item, &owmCurrentWeatherSchema, &list[count]);
+        count++;
+    }
     
-    return true;
+    return count;
 }
 
 bool OpenWeatherMap::parseForecast(const String& json, OWM_Forecast* forecast) {
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
     // Clear the structure
     memset(forecast, 0, sizeof(OWM_Forecast));
     
-    JsonDocument doc;
+    if (_parsers[OWM_ENDPOINT_FORECAST] == OWM_PARSER_SAX) {
+        OWM_ForecastHandler handler(forecast);
+        return runParser(json, &handler);
+    }
+    
+    JsonDocument doc(&_documentAllocator);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
-        setError("JSON parse error");
+        setParseError();
         return false;
     }
     
-    // Parse count
-    forecast->cnt = doc["cnt"] | 0;
+    // Count and city info; the list is walked below
+    applyJsonFields(doc.as<JsonObjectConst>(), &owmForecastSchema, forecast);
     if (forecast->cnt > OWM_MAX_FORECAST_ITEMS) {
         forecast->cnt = OWM_MAX_FORECAST_ITEMS;
     }
@@ -646,63 +2248,37 @@ bool OpenWeatherMap::parseForecast(const String& json, OWM_Forecast* forecast) {
     for (JsonObject item : list) {
         if (index >= forecast->cnt) break;
         
-        OWM_ForecastItem* fi = &forecast->items[index];
-        
-        fi->dt = item["dt"] | 0UL;
-        
-        JsonObject mainObj = item["main"];
-        parseMainData(mainObj, &fi->main);
-        
-        if (item["weather"].is<JsonArray>() && item["weather"].size() > 0) {
-            JsonObject weatherObj = item["weather"][0];
-            parseWeatherCondition(weatherObj, &fi->weather);
-        }
-        
-        JsonObject windObj = item["wind"];
-        parseWindData(windObj, &fi->wind);
-        
-        fi->clouds = item["clouds"]["all"] | 0;
-        fi->visibility = item["visibility"] | 0;
-        fi->pop = item["pop"] | 0.0f;
-        fi->rain_3h = item["rain"]["3h"] | 0.0f;
-        fi->snow_3h = item["snow"]["3h"] | 0.0f;
-        strncpy(fi->dt_txt, item["dt_txt"] | "", sizeof(fi->dt_txt) - 1);
-        
+        parseForecastItem(item, &forecast->items[index]);
         index++;
     }
     
-    // Parse city info
-    JsonObject city = doc["city"];
-    strncpy(forecast->city_name, city["name"] | "", sizeof(forecast->city_name) - 1);
-    strncpy(forecast->country, city["country"] | "", sizeof(forecast->country) - 1);
-    forecast->lat = city["coord"]["lat"] | 0.0f;
-    forecast->lon = city["coord"]["lon"] | 0.0f;
-    forecast->timezone = city["timezone"] | 0;
-    forecast->sunrise = city["sunrise"] | 0UL;
-    forecast->sunset = city["sunset"] | 0UL;
-    
     return true;
 }
 
 bool OpenWeatherMap::parseAirPollution(const String& json, OWM_AirPollution* pollution) {
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
     memset(pollution, 0, sizeof(OWM_AirPollution));
     
-    JsonDocument doc;
+    if (_parsers[OWM_ENDPOINT_AIR_POLLUTION] == OWM_PARSER_SAX) {
+        OWM_AirPollutionListHandler handler(pollution, 1);
+        return runParser(json, &handler);
+    }
+    
+    JsonDocument doc(&_documentAllocator);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
-        setError("JSON parse error");
+        setParseError();
         return false;
     }
     
     // Get first item from list
     if (doc["list"].is<JsonArray>() && doc["list"].size() > 0) {
         JsonObject item = doc["list"][0];
-        pollution->dt = item["dt"] | 0UL;
-        pollution->aqi = item["main"]["aqi"] | 0;
-        
-        JsonObject comp = item["components"];
-        parseAirComponents(comp, &pollution->components);
+        parseAirPollutionItem(item, pollution);
     }
     
     return true;
@@ -710,11 +2286,45 @@ bool OpenWeatherMap::parseAirPollution(const String& json, OWM_AirPollution* pol
 
 int OpenWeatherMap::parseAirPollutionList(const String& json, OWM_AirPollution* list, 
                                            int maxItems) {
-    JsonDocument doc;
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
+#if OWM_HAS_PARALLEL_PARSE
+    // Both halves use the SAX handlers, whichever parser is selected
+    if (_parallelParse && json.length() >= OWM_PARALLEL_MIN_BYTES) {
+        if (maxItems > 0) {
+            memset(list, 0, sizeof(OWM_AirPollution) * maxItems);
+        }
+        int count = parseAirPollutionSplit(json.c_str(), json.length(), list, maxItems);
+        if (count >= 0) {
+            return count;
+        }
+        if (count == -1) {
+            setParseError();
+            return -1;
+        }
+        // No usable split point; fall back to a single pass. The second
+        // half may already have written records past the real count.
+        if (maxItems > 0) {
+            memset(list, 0, sizeof(OWM_AirPollution) * maxItems);
+        }
+    }
+#endif
+    
+    if (_parsers[OWM_ENDPOINT_AIR_POLLUTION] == OWM_PARSER_SAX) {
+        if (maxItems > 0) {
+            memset(list, 0, sizeof(OWM_AirPollution) * maxItems);
+        }
+        OWM_AirPollutionListHandler handler(list, maxItems);
+        return runParser(json, &handler) ? handler.count() : -1;
+    }
+    
+    JsonDocument doc(&_documentAllocator);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
-        setError("JSON parse error");
+        setParseError();
         return -1;
     }
     
@@ -724,12 +2334,7 @@ int OpenWeatherMap::parseAirPollutionList(const String& json, OWM_AirPollution*
     for (JsonObject item : jsonList) {
         if (count >= maxItems) break;
         
-        list[count].dt = item["dt"] | 0UL;
-        list[count].aqi = item["main"]["aqi"] | 0;
-        
-        JsonObject comp = item["components"];
-        parseAirComponents(comp, &list[count].components);
-        
+        parseAirPollutionItem(item, &list[count]);
         count++;
     }
     
@@ -738,11 +2343,29 @@ int OpenWeatherMap::parseAirPollutionList(const String& json, OWM_AirPollution*
 
 int OpenWeatherMap::parseGeoLocations(const String& json, OWM_GeoLocation* locations, 
                                        int maxResults) {
-    JsonDocument doc;
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
+    if (_parsers[OWM_ENDPOINT_GEOCODING] == OWM_PARSER_SAX) {
+        if (maxResults > 0) {
+            memset(locations, 0, sizeof(OWM_GeoLocation) * maxResults);
+        }
+        OWM_GeoListHandler handler(locations, maxResults);
+        if (!runParser(json, &handler)) {
+            return -1;
+        }
+        if (handler.count() < 0) {
+            setError("Invalid response format");
+        }
+        return handler.count();
+    }
+    
+    JsonDocument doc(&_documentAllocator);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
-        setError("JSON parse error");
+        setParseError();
         return -1;
     }
     
@@ -758,12 +2381,8 @@ int OpenWeatherMap::parseGeoLocations(const String& json, OWM_GeoLocation* locat
     for (JsonObject item : arr) {
         if (count >= maxResults) break;
         
-        strncpy(locations[count].name, item["name"] | "", sizeof(locations[count].name) - 1);
-        strncpy(locations[count].country, item["country"] | "", sizeof(locations[count].country) - 1);
-        strncpy(locations[count].state, item["state"] | "", sizeof(locations[count].state) - 1);
-        locations[count].lat = item["lat"] | 0.0f;
-        locations[count].lon = item["lon"] | 0.0f;
-        
+        memset(&locations[count], 0, sizeof(OWM_GeoLocation));
+        applyJsonFields(item, &owmGeoLocationSchema, &locations[count]);
         count++;
     }
     
@@ -771,57 +2390,587 @@ int OpenWeatherMap::parseGeoLocations(const String& json, OWM_GeoLocation* locat
 }
 
 bool OpenWeatherMap::parseGeoZip(const String& json, OWM_GeoLocation* location) {
+    MemoryScope memory(this);
+    OWM_Stopwatch parsing(&_timings.parse, &_timings.total);
+    OWM_TRACE_PARSE();
+    
     memset(location, 0, sizeof(OWM_GeoLocation));
     
-    JsonDocument doc;
+    if (_parsers[OWM_ENDPOINT_GEOCODING] == OWM_PARSER_SAX) {
+        OWM_GeoZipHandler handler(location);
+        return runParser(json, &handler);
+    }
+    
+    JsonDocument doc(&_documentAllocator);
     DeserializationError error = deserializeJson(doc, json);
     
     if (error) {
-        setError("JSON parse error");
+        setParseError();
         return false;
     }
     
-    strncpy(location->name, doc["name"] | "", sizeof(location->name) - 1);
-    strncpy(location->country, doc["country"] | "", sizeof(location->country) - 1);
-    location->lat = doc["lat"] | 0.0f;
-    location->lon = doc["lon"] | 0.0f;
+    applyJsonFields(doc.as<JsonObjectConst>(), &owmGeoLocationSchema, location);
+    
+    return true;
+}
+
+bool OpenWeatherMap::runParser(const String& json, OWM_JsonHandler* handler) {
+    OWM_JsonParser parser(handler);
+    parser.feed(json.c_str(), json.length());
+    sampleMemory();
     
+    if (!parser.finish()) {
+        setParseError();
+        return false;
+    }
     return true;
 }
 
-void OpenWeatherMap::parseWeatherCondition(JsonObject& obj, OWM_WeatherCondition* condition) {
-    condition->id = obj["id"] | 0;
-    strncpy(condition->main, obj["main"] | "", sizeof(condition->main) - 1);
-    strncpy(condition->description, obj["description"] | "", sizeof(condition->description) - 1);
-    strncpy(condition->icon, obj["icon"] | "", sizeof(condition->icon) - 1);
+#if OWM_HAS_PARALLEL_PARSE
+
+// Returned by parseAirPollutionSplit() when the input cannot be split
+#define OWM_SPLIT_NONE -2
+
+// Second half of a split air pollution list, parsed on the other core
+struct ParseSegment {
+    const char* data;           // From the first record of the half to the end
+    size_t length;
+    OWM_AirPollution* list;     // Output slice for this half
+    int maxItems;
+    int count;
+    SemaphoreHandle_t done;     // Given by the helper task when it has finished
+    StaticSemaphore_t doneBuffer;
+};
+
+static const char kListPrefix[] = "{\"list\":[";
+static const char kListSuffix[] = "]}";
+
+static void parseSegmentTask(void* arg) {
+    ParseSegment* seg = (ParseSegment*)arg;
+    
+    // Re-open the list so the half is a complete document on its own
+    OWM_AirPollutionListHandler handler(seg->list, seg->maxItems);
+    OWM_JsonParser parser(&handler);
+    parser.feed(kListPrefix, sizeof(kListPrefix) - 1);
+    parser.feed(seg->data, seg->length);
+    seg->count = parser.finish() ? handler.count() : -1;
+    
+    // seg lives on the caller's stack: not touched after this
+    xSemaphoreGive(seg->done);
+    vTaskDelete(NULL);
+}
+
+// Record boundaries ("},{") in [from, to)
+static int countRecordBoundaries(const char* from, const char* to) {
+    int count = 0;
+    for (const char* p = from; p + 2 < to; p++) {
+        p = (const char*)memchr(p, '}', to - 2 - p);
+        if (p == NULL) {
+            break;
+        }
+        if (p[1] == ',' && p[2] == '{') {
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Air pollution records contain no strings and no arrays of objects, so
+ * "},{" only occurs between two records of "list". The list is split at
+ * the first such boundary after its midpoint; counting the boundaries in
+ * the first half gives the index of the first record of the second half,
+ * so both halves write straight into disjoint slices of the result.
+ */
+static int parseAirPollutionSplit(const char* json, size_t length, 
+                                  OWM_AirPollution* list, int maxItems) {
+    const char* end = json + length;
+    const char* listStart = strstr(json, "\"list\":[");
+    if (listStart == NULL) {
+        return OWM_SPLIT_NONE;
+    }
+    
+    const char* split = NULL;
+    for (const char* p = listStart + (end - listStart) / 2; p + 2 < end; p++) {
+        if (p[0] == '}' && p[1] == ',' && p[2] == '{') {
+            split = p + 2;
+            break;
+        }
+    }
+    if (split == NULL) {
+        return OWM_SPLIT_NONE;
+    }
+    
+    int offset = countRecordBoundaries(listStart, split + 1);
+    if (offset > maxItems) {
+        offset = maxItems;
+    }
+    
+    ParseSegment seg;
+    seg.data = split;
+    seg.length = end - split;
+    seg.list = list + offset;
+    seg.maxItems = maxItems - offset;
+    seg.count = -1;
+    
+    // A semaphore of our own rather than the task notification, which the
+    // calling task may already have pending from elsewhere
+    seg.done = xSemaphoreCreateBinaryStatic(&seg.doneBuffer);
+    
+    TaskHandle_t task;
+    BaseType_t otherCore = (xPortGetCoreID() == 0) ? 1 : 0;
+    if (xTaskCreatePinnedToCore(parseSegmentTask, "owm_parse", OWM_PARALLEL_STACK_SIZE, 
+                                &seg, uxTaskPriorityGet(NULL), &task, otherCore) != pdPASS) {
+        vSemaphoreDelete(seg.done);
+        return OWM_SPLIT_NONE;
+    }
+    
+    // First half on this core, closing the list right after the split
+    OWM_AirPollutionListHandler handler(list, offset);
+    OWM_JsonParser parser(&handler);
+    parser.feed(json, (split - 1) - json);
+    parser.feed(kListSuffix, sizeof(kListSuffix) - 1);
+    bool ok = parser.finish();
+    
+    xSemaphoreTake(seg.done, portMAX_DELAY);
+    vSemaphoreDelete(seg.done);
+    
+    if (!ok || seg.count < 0) {
+        return -1;
+    }
+    if (handler.count() != offset) {
+        return OWM_SPLIT_NONE;      // Boundaries did not match the records
+    }
+    return offset + seg.count;
+}
+
+#endif // OWM_HAS_PARALLEL_PARSE
+
+// ============================================================================
+// Private Methods - Streaming JSON
+// ============================================================================
+
+/*
+ * Read up to the opening bracket of the "list" array of the root object.
+ * Keys are read as JSON strings, so whitespace, member order and
+ * formatting do not matter; other members are skipped by depth.
+ */
+static bool findListArray(Stream& body) {
+    char key[5];
+    size_t keyLength = 0;
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    bool listKey = false;       // The last token was the key "list" of the root
+    char c;
+    
+    while (body.readBytes(&c, 1) == 1) {
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+                listKey = (depth == 1 && keyLength == 4 && memcmp(key, "list", 4) == 0);
+            } else if (keyLength < sizeof(key)) {
+                key[keyLength++] = c;
+            }
+            continue;
+        }
+        
+        if (c == '[' && listKey) {
+            return true;
+        }
+        if (c == '"') {
+            inString = true;
+            keyLength = 0;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        }
+        if (c != ':' && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            listKey = false;
+        }
+    }
+    return false;
+}
+
+// Hand a streamed list element to the user's callback
+static bool deliverForecastItem(void* item, int index, void* context) {
+    ForecastStreamContext* ctx = (ForecastStreamContext*)context;
+    return ctx->callback((const OWM_ForecastItem*)item, index, ctx->userData);
+}
+
+static bool deliverAirPollution(void* item, int index, void* context) {
+    AirPollutionStreamContext* ctx = (AirPollutionStreamContext*)context;
+    return ctx->callback((const OWM_AirPollution*)item, index, ctx->userData);
+}
+
+int OpenWeatherMap::streamJsonList(Client& body, OWM_ListItemHandler& items, 
+                                   OWM_Endpoint endpoint) {
+    if (_parsers[endpoint] != OWM_PARSER_SAX) {
+        OWM_TRACE_PARSE();
+        return readJsonItems(body, items);
+    }
+    
+    // Ends with the body, or as soon as the handler stops the parser
+    OWM_JsonParser parser(&items);
+    if (!readJsonBody(body, &parser)) {
+        return -1;
+    }
+    if (!items.foundList()) {
+        setError("Invalid response format");
+        return -1;
+    }
+    return items.count();
+}
+
+int OpenWeatherMap::readJsonItems(Stream& body, OWM_ListItemHandler& items) {
+    if (!findListArray(body)) {
+        setError("Invalid response format");
+        return -1;
+    }
+    
+    // Deserialize one array element at a time; ArduinoJson stops reading
+    // right after the closing brace, leaving the separator in the stream
+    JsonDocument doc(&_documentAllocator);
+    int c = nextJsonChar(body);
+    if (c == ']') {
+        return 0;   // Empty list
+    }
+    
+    for (int index = 0; ; index++) {
+        DeserializationError error = deserializeJson(doc, body);
+        if (error) {
+            setParseError();
+            debugPrint("JSON Error: ");
+            debugPrintln(error.c_str());
+            return -1;
+        }
+        
+        if (items.delivering()) {
+            applyJsonFields(doc.as<JsonObjectConst>(), items.table(), items.item());
+        }
+        if (!items.deliver(index)) {
+            break;
+        }
+        
+        // ',' before the next element, ']' after the last one
+        c = nextJsonChar(body);
+        body.read();
+        if (c == ']') {
+            break;
+        }
+        if (c != ',') {
+            setParseError();
+            return -1;
+        }
+    }
+    
+    return items.count();
+}
+
+int OpenWeatherMap::nextJsonChar(Stream& body) {
+    // Peek past whitespace, waiting up to the timeout for more data
+    unsigned long start = millis();
+    while (true) {
+        int c = body.peek();
+        if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            body.read();
+            continue;
+        }
+        if (c >= 0 || millis() - start > _timeout) {
+            return c;
+        }
+        delay(1);
+    }
+}
+
+bool OpenWeatherMap::readForecastStream(Client& body, void* context) {
+    ForecastStreamContext* ctx = (ForecastStreamContext*)context;
+    OWM_ForecastItem item;
+    OWM_ListItemHandler items(&owmForecastItemSchema, &item, sizeof(item), 
+                              &deliverForecastItem, ctx);
+    ctx->delivered = streamJsonList(body, items, OWM_ENDPOINT_FORECAST);
+    return ctx->delivered >= 0;
+}
+
+int OpenWeatherMap::streamAirPollution(const char* path, OWM_AirPollutionCallback callback, 
+                                       void* userData) {
+    if (callback == NULL) {
+        setError("No callback");
+        return -1;
+    }
+    
+    AirPollutionStreamContext ctx;
+    ctx.callback = callback;
+    ctx.userData = userData;
+    ctx.total = -1;
+    
+    if (!httpGetStream(apiHost(), path, &OpenWeatherMap::readAirPollutionStream, &ctx)) {
+        return -1;
+    }
+    
+    return ctx.total;
+}
+
+bool OpenWeatherMap::readAirPollutionStream(Client& body, void* context) {
+    AirPollutionStreamContext* ctx = (AirPollutionStreamContext*)context;
+    OWM_AirPollution item;
+    // Records after the callback stops are counted, not parsed into item
+    OWM_ListItemHandler items(&owmAirPollutionSchema, &item, sizeof(item), 
+                              &deliverAirPollution, ctx, true);
+    ctx->total = streamJsonList(body, items, OWM_ENDPOINT_AIR_POLLUTION);
+    return ctx->total >= 0;
+}
+
+// ============================================================================
+// Private Methods - JSON Field Helpers
+// ============================================================================
+
+/*
+ * Copy the members of a JSON object into a struct as described by a
+ * field table. Each key is looked up once by id instead of searching the
+ * object for every field; missing keys leave the (zeroed) member as is.
+ */
+static void applyJsonFields(JsonObjectConst obj, const OWM_FieldTable* table, void* base) {
+    for (JsonPairConst member : obj) {
+        JsonString name = member.key();
+        const OWM_Field* field = owmFindField(table, owmJsonKeyId(name.c_str(), name.size()));
+        if (field == NULL) {
+            continue;
+        }
+        
+        JsonVariantConst value = member.value();
+        uint8_t* dest = (uint8_t*)base + field->offset;
+        
+        switch (field->type) {
+            case OWM_FIELD_INT:
+                owmStoreInt(dest, field->size, value | 0L);
+                break;
+            case OWM_FIELD_ULONG: {
+                unsigned long number = value | 0UL;
+                if (field->size == sizeof(uint32_t)) {
+                    uint32_t number32 = number;
+                    memcpy(dest, &number32, sizeof(number32));
+                } else {
+                    memcpy(dest, &number, sizeof(number));
+                }
+                break;
+            }
+            case OWM_FIELD_FLOAT: {
+                float number = value | 0.0f;
+                memcpy(dest, &number, sizeof(number));
+                break;
+            }
+            case OWM_FIELD_FIXED: {
+                double number = value | 0.0;
+                for (uint8_t i = 0; i < field->decimals; i++) {
+                    number *= 10;
+                }
+                owmStoreInt(dest, field->size, lround(number));
+                break;
+            }
+            case OWM_FIELD_STRING:
+                strncpy((char*)dest, value | "", field->size - 1);
+                dest[field->size - 1] = '\0';
+                break;
+            case OWM_FIELD_OBJECT:
+                applyJsonFields(value.as<JsonObjectConst>(), field->sub, dest);
+                break;
+            case OWM_FIELD_FIRST:
+                applyJsonFields(value[0].as<JsonObjectConst>(), field->sub, dest);
+                break;
+        }
+    }
+}
+
+void OpenWeatherMap::parseAirPollutionItem(JsonObject& item, OWM_AirPollution* pollution) {
+    memset(pollution, 0, sizeof(OWM_AirPollution));
+    applyJsonFields(item, &owmAirPollutionSchema, pollution);
 }
 
-void OpenWeatherMap::parseMainData(JsonObject& obj, OWM_MainData* main) {
-    main->temp = obj["temp"] | 0.0f;
-    main->feels_like = obj["feels_like"] | 0.0f;
-    main->temp_min = obj["temp_min"] | 0.0f;
-    main->temp_max = obj["temp_max"] | 0.0f;
-    main->pressure = obj["pressure"] | 0;
-    main->humidity = obj["humidity"] | 0;
-    main->sea_level = obj["sea_level"] | 0;
-    main->grnd_level = obj["grnd_level"] | 0;
+void OpenWeatherMap::parseForecastItem(JsonObject& item, OWM_ForecastItem* fi) {
+    memset(fi, 0, sizeof(OWM_ForecastItem));
+    applyJsonFields(item, &owmForecastItemSchema, fi);
 }
 
-void OpenWeatherMap::parseWindData(JsonObject& obj, OWM_WindData* wind) {
-    wind->speed = obj["speed"] | 0.0f;
-    wind->deg = obj["deg"] | 0;
-    wind->gust = obj["gust"] | 0.0f;
+// ============================================================================
+// Private Methods - Metrics
+// ============================================================================
+
+void OpenWeatherMap::recordRequest(OWM_Endpoint endpoint, OWM_Status status, 
+                                   const OWM_Timings* timings) {
+    OWM_TRACE(OWM_TRACE_REQUEST_END, NULL, status);
+    if (_metrics != NULL) {
+        int httpCode = (status == OWM_STATUS_OK || status == OWM_STATUS_HTTP_ERROR) 
+                       ? _lastHttpCode : 0;
+        _metrics->record(endpoint, status, timings, httpCode);
+    }
+}
+
+bool OpenWeatherMap::recordParsed(OWM_Endpoint endpoint, bool parsed) {
+    // Counted after parsing, so the latency includes it and a body that
+    // does not parse is a parse error rather than a success
+    recordRequest(endpoint, parsed ? OWM_STATUS_OK : OWM_STATUS_PARSE_ERROR, &_timings);
+    return parsed;
+}
+
+void OpenWeatherMap::recordCacheHit(OWM_Endpoint endpoint) {
+    OWM_TRACE_LOOKUP(endpoint, true);
+    if (_metrics != NULL) {
+        _metrics->record(endpoint, OWM_STATUS_CACHED, NULL, 0);
+    }
+}
+
+#if OWM_ENABLE_TRACING
+
+// ============================================================================
+// Private Methods - Tracing
+// ============================================================================
+
+void OpenWeatherMap::trace(OWM_TraceEventType type, const char* message, OWM_Status status) {
+    if (_traceObserver == NULL) {
+        return;
+    }
+    OWM_TraceEvent event;
+    event.type = type;
+    event.requestId = _traceId;
+    event.endpoint = _traceEndpoint;
+    event.timestamp = micros();
+    event.httpCode = (type == OWM_TRACE_HEADERS) ? _lastHttpCode : 0;
+    event.status = status;
+    event.message = message;
+    _traceObserver->onTraceEvent(event);
+}
+
+void OpenWeatherMap::traceCacheLookup(OWM_Endpoint endpoint, bool hit) {
+    // Concurrent calls set the id of each lookup beforehand (OWM_TRACE_INDEX)
+    if (!_traceOpen) {
+        _traceId = ++_traceLastId;
+    }
+    _traceEndpoint = endpoint;
+    _traceOpen = !hit;        // A miss keeps its id for the request that follows
+    trace(hit ? OWM_TRACE_CACHE_HIT : OWM_TRACE_CACHE_MISS);
+}
+
+void OpenWeatherMap::traceRequestStart(OWM_Endpoint endpoint) {
+    if (!_traceOpen) {
+        _traceId = ++_traceLastId;
+    }
+    _traceEndpoint = endpoint;
+    _traceOpen = false;
+    trace(OWM_TRACE_REQUEST_START);
+}
+
+uint32_t OpenWeatherMap::reserveTraceIds(int count) {
+    uint32_t base = _traceLastId + 1;
+    _traceLastId += count;
+    _traceOpen = false;
+    return base;
+}
+
+OpenWeatherMap::ParseTrace::ParseTrace(OpenWeatherMap* owner) : _owner(owner) {
+    _owner->trace(OWM_TRACE_PARSE_START);
+}
+
+OpenWeatherMap::ParseTrace::~ParseTrace() {
+    _owner->trace(OWM_TRACE_PARSE_END);
+}
+
+#endif // OWM_ENABLE_TRACING
+
+// ============================================================================
+// Private Methods - Memory Statistics
+// ============================================================================
+
+OpenWeatherMap::MemoryScope::MemoryScope(OpenWeatherMap* owner) : _owner(owner) {
+    // Only the outermost call starts the statistics; this object sits in
+    // its frame, so the stack its locals use is counted too
+    if (owner->_memoryDepth++ == 0) {
+        owner->beginMemoryStats((uintptr_t)this);
+    }
+}
+
+OpenWeatherMap::MemoryScope::~MemoryScope() {
+    if (--_owner->_memoryDepth == 0) {
+        _owner->sampleMemory();
+        _owner->_stackBase = 0;
+    }
+}
+
+void OpenWeatherMap::beginMemoryStats(uintptr_t stackBase) {
+    memset(&_memoryStats, 0, sizeof(_memoryStats));
+    if (!_memoryStatsEnabled) {
+        return;
+    }
+    _stackBase = stackBase;
+    _startFreeHeap = freeHeap();
+    _memoryStats.minFreeHeap = _startFreeHeap;
+    sampleMemory();
+}
+
+void OpenWeatherMap::sampleMemory() {
+    if (!_memoryStatsEnabled || _stackBase == 0) {
+        return;
+    }
+    
+    size_t free = freeHeap();
+    if (free < _memoryStats.minFreeHeap) {
+        _memoryStats.minFreeHeap = free;
+        if (_startFreeHeap > free) {
+            _memoryStats.heapPeak = _startFreeHeap - free;
+        }
+    }
+    
+    // The stack grows down on both platforms
+    char marker;
+    uintptr_t depth = _stackBase > (uintptr_t)&marker ? _stackBase - (uintptr_t)&marker : 0;
+    if (depth > _memoryStats.stackPeak) {
+        _memoryStats.stackPeak = depth;
+    }
+    
+#if defined(ESP32)
+    _memoryStats.stackFree = uxTaskGetStackHighWaterMark(NULL);
+#endif
+}
+
+void* OpenWeatherMap::DocumentAllocator::allocate(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr != NULL && owner->_memoryStatsEnabled) {
+        owner->_documentBytes += blockSize(ptr);
+        if (owner->_documentBytes > owner->_memoryStats.documentPeak) {
+            owner->_memoryStats.documentPeak = owner->_documentBytes;
+        }
+        owner->sampleMemory();
+    }
+    return ptr;
 }
 
-void OpenWeatherMap::parseAirComponents(JsonObject& obj, OWM_AirComponents* components) {
-    components->co = obj["co"] | 0.0f;
-    components->no = obj["no"] | 0.0f;
-    components->no2 = obj["no2"] | 0.0f;
-    components->o3 = obj["o3"] | 0.0f;
-    components->so2 = obj["so2"] | 0.0f;
-    components->pm2_5 = obj["pm2_5"] | 0.0f;
-    components->pm10 = obj["pm10"] | 0.0f;
-    components->nh3 = obj["nh3"] | 0.0f;
+void OpenWeatherMap::DocumentAllocator::deallocate(void* ptr) {
+    if (ptr != NULL && owner->_memoryStatsEnabled) {
+        size_t size = blockSize(ptr);
+        owner->_documentBytes -= min(size, owner->_documentBytes);
+    }
+    free(ptr);
+}
+
+void* OpenWeatherMap::DocumentAllocator::reallocate(void* ptr, size_t newSize) {
+    if (!owner->_memoryStatsEnabled) {
+        return realloc(ptr, newSize);
+    }
+    size_t oldSize = ptr != NULL ? blockSize(ptr) : 0;
+    void* block = realloc(ptr, newSize);
+    if (block != NULL) {
+        owner->_documentBytes += blockSize(block) - min(oldSize, owner->_documentBytes);
+        if (owner->_documentBytes > owner->_memoryStats.documentPeak) {
+            owner->_memoryStats.documentPeak = owner->_documentBytes;
+        }
+        owner->sampleMemory();
+    }
+    return block;
 }
 
 // ============================================================================
@@ -843,6 +2992,12 @@ void OpenWeatherMap::debugPrintln(const char* message) {
 void OpenWeatherMap::setError(const char* error) {
     strncpy(_lastError, error, sizeof(_lastError) - 1);
     _lastError[sizeof(_lastError) - 1] = '\0';
+    OWM_TRACE(OWM_TRACE_ERROR, _lastError);
     debugPrint("Error: ");
     debugPrintln(error);
 }
+
+void OpenWeatherMap::setParseError() {
+    setError("JSON parse error");
+    _parseFailed = true;
+}
@@ -27,7 +27,7 @@
     #include <WiFiS3.h>
 #elif defined(ESP32)
     #include <WiFi.h>
-    #include <HTTPClient.h>
+    #include <WiFiClientSecure.h>
 #else
     #error "Unsupported board! This library supports Arduino UNO R4 WiFi and ESP32 series."
 #endif
@@ -41,9 +41,36 @@
 // Cache settings
 #define OWM_CACHE_DURATION_MS 60000  // Default cache duration: 60 seconds
 
+// DNS cache settings (see setDnsCacheTtl() and refreshDns())
+#define OWM_DNS_CACHE_TTL_MS 300000     // Default: resolved addresses are reused for 5 minutes
+#define OWM_DNS_REFRESH_MS 30000        // refreshDns() renews addresses this long before expiry
+#define OWM_DNS_RETRY_MS 10000          // refreshDns() waits this long after a failed lookup
+#define OWM_DNS_CACHE_SIZE 2            // Host names kept
+
 // Timeout settings
 #define OWM_DEFAULT_TIMEOUT_MS 5000  // Default timeout: 5 seconds
 
+// Batch settings
+#define OWM_DEFAULT_CONCURRENCY 4       // Requests in flight per batch (see setMaxConcurrency())
+#define OWM_MAX_CONCURRENCY 8
+
+// Parallel parsing (ESP32 dual-core only, see setParallelParse())
+#if defined(ESP32) && !CONFIG_FREERTOS_UNICORE
+    #define OWM_HAS_PARALLEL_PARSE 1
+#else
+    #define OWM_HAS_PARALLEL_PARSE 0
+#endif
+#define OWM_PARALLEL_MIN_BYTES 8192     // Smaller responses are parsed on one core
+#define OWM_PARALLEL_STACK_SIZE 4096    // Stack of the helper parse task
+
+// Request tracing (see setTraceObserver()). Off by default, so the hooks
+// compile to nothing; enable with the build flag -DOWM_ENABLE_TRACING=1.
+// Only the library sources read it: the class layout and API are the
+// same either way, so a sketch that defines it differently still links.
+#ifndef OWM_ENABLE_TRACING
+    #define OWM_ENABLE_TRACING 0
+#endif
+
 // Buffer sizes
 #define OWM_CITY_NAME_SIZE 64
 #define OWM_COUNTRY_SIZE 8
@@ -51,6 +78,7 @@
 #define OWM_ICON_SIZE 8
 #define OWM_MAX_FORECAST_ITEMS 40
 #define OWM_MAX_GEO_RESULTS 5
+#define OWM_MAX_GROUP_CITIES 20     // City ids per /data/2.5/group request
 
 // Units of measurement
 enum OWM_Units {
@@ -59,6 +87,33 @@ enum OWM_Units {
     OWM_UNITS_IMPERIAL    // Fahrenheit, miles/hour
 };
 
+// API endpoint groups (for per-endpoint settings)
+enum OWM_Endpoint {
+    OWM_ENDPOINT_CURRENT_WEATHER,
+    OWM_ENDPOINT_FORECAST,
+    OWM_ENDPOINT_AIR_POLLUTION,
+    OWM_ENDPOINT_GEOCODING,
+    OWM_ENDPOINT_COUNT
+};
+
+// JSON parser implementations
+enum OWM_Parser {
+    OWM_PARSER_ARDUINOJSON,   // ArduinoJson document (default)
+    OWM_PARSER_SAX            // Schema-specialized single-pass parser, no DOM
+};
+
+// Per-request result of batch operations
+enum OWM_Status {
+    OWM_STATUS_OK,                  // Fetched and parsed
+    OWM_STATUS_CACHED,              // Served from the cache, no request made
+    OWM_STATUS_CONNECTION_FAILED,   // Could not connect (or not attempted after that)
+    OWM_STATUS_TIMEOUT,             // No or incomplete response in time
+    OWM_STATUS_HTTP_ERROR,          // Non-200 response, see getLastHttpCode()
+    OWM_STATUS_PARSE_ERROR,         // Response body could not be parsed
+    OWM_STATUS_CANCELLED,           // Not fetched because the callback stopped the batch
+    OWM_STATUS_INVALID_RESPONSE     // Not an HTTP response, or an encoded (e.g. gzip) body
+};
+
 // Air Quality Index levels
 enum OWM_AQI {
     OWM_AQI_GOOD = 1,
@@ -72,6 +127,14 @@ enum OWM_AQI {
 // Data Structures
 // ============================================================================
 
+/**
+ * @brief Geographic coordinates
+ */
+struct OWM_Coord {
+    float lat;
+    float lon;
+};
+
 /**
  * @brief Geographic location data
  */
@@ -81,6 +144,7 @@ struct OWM_GeoLocation {
     char state[32];
     float lat;
     float lon;
+    unsigned long id;     // OpenWeatherMap city id (0 if unknown; geocoding does not report it)
 };
 
 /**
@@ -134,6 +198,7 @@ struct OWM_CurrentWeather {
     unsigned long sunrise;
     unsigned long sunset;
     int timezone;         // Shift from UTC (seconds)
+    unsigned long id;     // City id
     char name[OWM_CITY_NAME_SIZE];
 };
 
@@ -191,6 +256,163 @@ struct OWM_Forecast {
     unsigned long sunset;
 };
 
+/**
+ * @brief Current weather, air quality and forecast for one location
+ * 
+ * Filled by getSnapshot(). Large (the forecast alone holds 40 items),
+ * so keep it global or static rather than on the stack.
+ */
+struct OWM_Snapshot {
+    float lat;
+    float lon;
+    OWM_CurrentWeather weather;
+    OWM_AirPollution airPollution;
+    OWM_Forecast forecast;
+    OWM_Status weatherStatus;
+    OWM_Status airPollutionStatus;
+    OWM_Status forecastStatus;
+};
+
+/**
+ * @brief One request of a mixed batch (see fetchRequests())
+ * 
+ * result points to an OWM_CurrentWeather, OWM_AirPollution or
+ * OWM_Forecast, depending on endpoint.
+ */
+struct OWM_Request {
+    OWM_Endpoint endpoint;    // CURRENT_WEATHER, AIR_POLLUTION or FORECAST
+    float lat;
+    float lon;
+    int cnt;                  // Forecast timestamps (0 for all)
+    void* result;
+    OWM_Status status;        // Outcome, set by fetchRequests()
+};
+
+/**
+ * @brief Where the time of one request went (see getLastTimings())
+ * 
+ * Durations are in microseconds. For HTTPS, connect and tls are
+ * measured separately on ESP32 with core 3.x. On older ESP32 cores the
+ * TCP connect is counted in tls (connect is 0); on the UNO R4 WiFi,
+ * whose TLS client connects by name, tls also includes the DNS lookup.
+ * download does not include time spent in the parser, except for
+ * forecastEach() and the air pollution *Each() methods with the
+ * ArduinoJson parser, which parse while they read.
+ */
+struct OWM_Timings {
+    unsigned long dns;          // Host name lookup (0 when the address was cached)
+    unsigned long connect;      // TCP connect
+    unsigned long tls;          // TLS handshake (HTTPS, see above)
+    unsigned long ttfb;         // Request sent until the response headers are read
+    unsigned long download;     // Body transfer
+    unsigned long parse;        // JSON parsing
+    unsigned long total;        // Whole request, parsing included
+    unsigned long bytesSent;    // Request line and headers
+    unsigned long headerBytes;  // Response status line and headers
+    unsigned long bodyBytes;    // Response body (without chunk framing)
+    bool reused;                // Kept-alive connection: no dns, connect or tls
+};
+
+/**
+ * @brief Memory use during the last request (see setMemoryStats())
+ * 
+ * Sampled at the points where memory changes: connecting, each body
+ * chunk, every JsonDocument allocation and the end of parsing. Peaks
+ * between two samples can be missed, so treat the values as lower
+ * bounds. All values are in bytes.
+ */
+struct OWM_MemoryStats {
+    size_t minFreeHeap;         // Least free heap seen
+    size_t heapPeak;            // Most heap in use above the level at the start
+    size_t bodyBuffer;          // Response body held in a String (0 when streamed)
+    size_t documentPeak;        // Most memory held by JsonDocuments at once
+    size_t stackPeak;           // Deepest stack use from the public method called
+    size_t stackFree;           // Least free stack of the calling task so far (ESP32, else 0)
+};
+
+// Steps of a request reported to an OWM_TraceObserver
+enum OWM_TraceEventType {
+    OWM_TRACE_CACHE_HIT,        // Served from the cache; no other event follows
+    OWM_TRACE_CACHE_MISS,       // Not cached; the request follows under the same id
+    OWM_TRACE_REQUEST_START,    // Request started (again after a kept-alive connection closed)
+    OWM_TRACE_CONNECTED,        // New connection open (not sent for a reused one)
+    OWM_TRACE_HEADERS,          // Response headers read, see httpCode
+    OWM_TRACE_FIRST_BYTE,       // First body byte read
+    OWM_TRACE_PARSE_START,
+    OWM_TRACE_PARSE_END,
+    OWM_TRACE_ERROR,            // See message
+    OWM_TRACE_REQUEST_END       // Transfer finished, see status
+};
+
+/**
+ * @brief One step of a request (see setTraceObserver())
+ * 
+ * The SAX parser and the *Each() methods parse while they read, so
+ * PARSE_START comes before FIRST_BYTE. A body read into a String is
+ * parsed after the transfer: with the ArduinoJson parser PARSE_START and
+ * PARSE_END come after REQUEST_END.
+ * The request path is not included: it contains the API key.
+ */
+struct OWM_TraceEvent {
+    OWM_TraceEventType type;
+    uint32_t requestId;         // Same for every event of one request, starting at 1
+    OWM_Endpoint endpoint;
+    unsigned long timestamp;    // micros() when it happened
+    int httpCode;               // HEADERS only, else 0
+    OWM_Status status;          // REQUEST_END only, else OWM_STATUS_OK
+    const char* message;        // ERROR only: same text as getLastError(), else NULL
+};
+
+/**
+ * @brief Receiver of request trace events
+ * 
+ * Called synchronously from inside the request; keep it short (e.g.
+ * copy the event into a queue) or the request timings suffer.
+ */
+class OWM_TraceObserver {
+public:
+    virtual ~OWM_TraceObserver() {}
+    virtual void onTraceEvent(const OWM_TraceEvent& event) = 0;
+};
+
+class OWM_JsonHandler;
+class OWM_ListItemHandler;
+class OWM_Metrics;
+class OWM_Recorder;
+struct OWM_HttpConnection;
+struct OWM_FanOutSlot;
+
+// ============================================================================
+// Callbacks
+// ============================================================================
+
+/**
+ * @brief Called for every current weather record delivered by the library
+ * @param item Weather record (only valid during the call)
+ * @param index Zero-based position of the record
+ * @param userData User pointer passed to the calling method
+ * @return true to continue, false to stop
+ */
+typedef bool (*OWM_CurrentWeatherCallback)(const OWM_CurrentWeather* item, int index, void* userData);
+
+/**
+ * @brief Called for every forecast item parsed by forecastEach()
+ * @param item Parsed item (only valid during the call)
+ * @param index Zero-based position of the item in the response
+ * @param userData User pointer passed to forecastEach()
+ * @return true to continue, false to stop reading the response
+ */
+typedef bool (*OWM_ForecastCallback)(const OWM_ForecastItem* item, int index, void* userData);
+
+/**
+ * @brief Called for every air pollution record parsed by the *Each() methods
+ * @param item Parsed record (only valid during the call)
+ * @param index Zero-based position of the record in the response
+ * @param userData User pointer passed to the streaming method
+ * @return true to continue, false to stop (the rest is only counted)
+ */
+typedef bool (*OWM_AirPollutionCallback)(const OWM_AirPollution* item, int index, void* userData);
+
 // ============================================================================
 // OpenWeatherMap Class
 // ============================================================================
@@ -201,6 +423,7 @@ public:
      * @brief Construct a new OpenWeatherMap object
      */
     OpenWeatherMap();
+    ~OpenWeatherMap();
     
     /**
      * @brief Initialize the library with API key
@@ -209,6 +432,17 @@ public:
      */
     void begin(const char* apiKey, bool useHttps = false);
     
+    /**
+     * @brief Send all requests to another server, e.g. a local mock
+     * 
+     * Useful for testing against extras/mock_server without an API key
+     * or network access.
+     * 
+     * @param host Host name or IP address (NULL for api.openweathermap.org)
+     * @param port Port (0 for the default of the scheme)
+     */
+    void setServer(const char* host, uint16_t port = 0);
+    
     /**
      * @brief Set the unit system for measurements
      * @param units OWM_UNITS_STANDARD, OWM_UNITS_METRIC, or OWM_UNITS_IMPERIAL
@@ -233,12 +467,115 @@ public:
      */
     void setCacheDuration(unsigned long durationMs);
     
+    /**
+     * @brief Set how many locations the current weather cache holds
+     * 
+     * By default only the last location fetched is cached, so a batch
+     * (getCurrentWeatherBatch(), fetchRequests(), the scheduler) can
+     * serve at most one location from the cache. With more entries each
+     * location keeps its own; when all are in use the least recently used
+     * one is replaced. Entries beyond the first are allocated on the heap
+     * (about 300 bytes each); changing the size empties the cache.
+     * 
+     * @param entries Number of locations (1 for the default)
+     * @return false if the memory is not available (the size is unchanged)
+     */
+    bool setWeatherCacheSize(uint16_t entries);
+    
+    /**
+     * @brief Set how long resolved server addresses are reused
+     * 
+     * Requests connect to the cached address without a DNS lookup; the
+     * Host header (and on ESP32 the TLS server name) still carry the host
+     * name. An address that fails to connect is dropped, and when a lookup
+     * fails an expired address is tried rather than failing the request.
+     * On the UNO R4 WiFi, HTTPS connects by name and does not use the cache.
+     * 
+     * @param ttlMs Time to live in milliseconds (0 to look up every request)
+     */
+    void setDnsCacheTtl(unsigned long ttlMs);
+    
+    /**
+     * @brief Resolve the API server ahead of the next request
+     * 
+     * Looks the server up if it is not cached yet and renews cached
+     * addresses within OWM_DNS_REFRESH_MS of expiry, so requests do not
+     * wait for DNS. Returns at once when there is nothing to do: call it
+     * from setup() and loop() (OWM_Scheduler::update() calls it while no
+     * task is due). Nothing renews addresses in the background; without
+     * these calls a request after expiry does the lookup itself.
+     * Does nothing when the cache is off or requests connect by name
+     * (HTTPS on the UNO R4 WiFi).
+     * 
+     * @return true if the server address is cached
+     */
+    bool refreshDns();
+    
     /**
      * @brief Set timeout for HTTP requests
      * @param timeoutMs Timeout in milliseconds (default: 5000ms)
      */
     void setTimeout(unsigned long timeoutMs);
     
+    /**
+     * @brief Select the JSON parser used for an endpoint
+     * 
+     * OWM_PARSER_SAX parses responses in a single pass straight into the
+     * result structs without building an ArduinoJson document, which
+     * saves both time and heap on large responses. The *Each() methods
+     * follow the setting too.
+     * 
+     * @param endpoint Endpoint group
+     * @param parser OWM_PARSER_ARDUINOJSON (default) or OWM_PARSER_SAX
+     */
+    void setParser(OWM_Endpoint endpoint, OWM_Parser parser);
+    
+    /**
+     * @brief Select the JSON parser used for all endpoints
+     * @param parser OWM_PARSER_ARDUINOJSON (default) or OWM_PARSER_SAX
+     */
+    void setParser(OWM_Parser parser);
+    
+    /**
+     * @brief Parse large air pollution lists on both cores
+     * 
+     * When enabled, getAirPollutionHistory(), getAirPollutionForecast()
+     * and parseAirPollutionList() split responses of at least
+     * OWM_PARALLEL_MIN_BYTES at a record boundary and parse the second
+     * half on the other core, using the SAX handlers whichever parser is
+     * selected. Records keep their order; smaller responses are parsed in
+     * one pass with the selected parser.
+     * 
+     * The fetches then download the whole body before parsing instead of
+     * parsing while it arrives, so a response needs its size in heap
+     * (about 190 bytes per hourly record). The *Each() methods always
+     * stream on one core. Has no effect on single-core boards and the
+     * UNO R4 WiFi.
+     * 
+     * @param enable true to enable, false to disable (default)
+     */
+    void setParallelParse(bool enable);
+    
+    /**
+     * @brief Set how many requests batch operations keep in flight
+     * 
+     * Each request in flight has its own keep-alive connection, so
+     * round trips overlap and results arrive as soon as each is ready.
+     * Connections are opened one after another; only the waiting for
+     * responses overlaps. 1 sends one request at a time.
+     * 
+     * Every slot costs heap for the duration of the batch: a WiFiClient,
+     * a TLS client and a SAX parser (a few KB together, mostly the TLS
+     * client object; about 500 bytes more while an OWM_Recorder is
+     * attached), plus the socket buffers of its open connection. With
+     * HTTPS each connection also holds its own TLS session (about 40 KB
+     * on ESP32), so the default of 4 keeps 4 TLS sessions open at once.
+     * If the slots cannot be allocated the batch runs with fewer.
+     * 
+     * @param count 1 to OWM_MAX_CONCURRENCY (default: OWM_DEFAULT_CONCURRENCY)
+     */
+    void setMaxConcurrency(uint8_t count);
+    
     // ========================================================================
     // Geocoding API
     // ========================================================================
@@ -300,6 +637,49 @@ public:
     bool getCurrentWeatherByCity(const char* cityName, const char* countryCode, 
                                  OWM_CurrentWeather* weather);
     
+    /**
+     * @brief Get current weather for many locations
+     * 
+     * Locations found in the cache are served from it (size the cache
+     * with setWeatherCacheSize(); by default it holds only the last
+     * location fetched); the rest are
+     * requested with up to setMaxConcurrency() requests in flight, each
+     * with its own deadline (setTimeout()). A failed location does not
+     * stop the batch. Responses are always parsed with the SAX parser
+     * as they arrive.
+     * 
+     * @param coords Locations
+     * @param count Number of locations
+     * @param results Array of count entries for the weather data
+     * @param status Array of count entries for the per-location result
+     * @param callback Optional, called for every location with data as
+     *                 soon as it is available (completion order); return
+     *                 false to cancel the rest of the batch
+     * @param userData Pointer passed through to the callback
+     * @return Number of locations with OWM_STATUS_OK or OWM_STATUS_CACHED
+     */
+    int getCurrentWeatherBatch(const OWM_Coord* coords, size_t count, 
+                               OWM_CurrentWeather* results, OWM_Status* status,
+                               OWM_CurrentWeatherCallback callback = NULL, 
+                               void* userData = NULL);
+    
+    /**
+     * @brief Get current weather for cities by city id (group query)
+     * 
+     * Requests up to OWM_MAX_GROUP_CITIES cities per /data/2.5/group
+     * call, so a fixed site list needs a twentieth of the requests of
+     * getCurrentWeather(). City ids can be taken from
+     * OWM_CurrentWeather::id or OpenWeatherMap's city list.
+     * 
+     * @param cities Cities with id set (other fields are not used)
+     * @param count Number of cities
+     * @param results Array of count entries; results[i] belongs to
+     *                cities[i], cities the API did not return are zeroed
+     * @return Number of cities with weather data, or -1 on error
+     */
+    int getCurrentWeatherGroup(const OWM_GeoLocation* cities, int count, 
+                               OWM_CurrentWeather* results);
+    
     // ========================================================================
     // Air Pollution API
     // ========================================================================
@@ -338,6 +718,38 @@ public:
                                unsigned long endTime, OWM_AirPollution* history, 
                                int maxItems);
     
+    /**
+     * @brief Stream air pollution forecast records one at a time
+     * @param lat Latitude
+     * @param lon Longitude
+     * @param callback Function called for every record
+     * @param userData Pointer passed through to the callback
+     * @return Number of records in the response, or -1 on error
+     */
+    int airPollutionForecastEach(float lat, float lon, OWM_AirPollutionCallback callback, 
+                                 void* userData = NULL);
+    
+    /**
+     * @brief Stream historical air pollution records one at a time
+     * 
+     * Unlike getAirPollutionHistory() there is no item limit: records are
+     * parsed straight from the connection and only one is held in memory,
+     * so month-long hourly ranges work on any board. Return false from the
+     * callback to stop early; the rest of the response is still read to
+     * count the records, without being stored.
+     * 
+     * @param lat Latitude
+     * @param lon Longitude
+     * @param startTime Start time (Unix timestamp, UTC)
+     * @param endTime End time (Unix timestamp, UTC)
+     * @param callback Function called for every record
+     * @param userData Pointer passed through to the callback
+     * @return Number of records in the response, or -1 on error
+     */
+    int airPollutionHistoryEach(float lat, float lon, unsigned long startTime, 
+                                unsigned long endTime, OWM_AirPollutionCallback callback, 
+                                void* userData = NULL);
+    
     // ========================================================================
     // 5-Day / 3-Hour Forecast API
     // ========================================================================
@@ -363,6 +775,155 @@ public:
     bool getForecastByCity(const char* cityName, const char* countryCode, 
                            OWM_Forecast* forecast, int cnt = 0);
     
+    /**
+     * @brief Stream the 5-day forecast item by item
+     * 
+     * Items are parsed straight from the connection and handed to the
+     * callback one at a time, so only a single OWM_ForecastItem is held
+     * in memory regardless of cnt. Return false from the callback to stop
+     * early; the connection is closed without reading the rest.
+     * 
+     * @param lat Latitude
+     * @param lon Longitude
+     * @param callback Function called for every item
+     * @param userData Pointer passed through to the callback
+     * @param cnt Number of timestamps to retrieve (optional, 0 for all)
+     * @return Number of items delivered to the callback, or -1 on error
+     */
+    int forecastEach(float lat, float lon, OWM_ForecastCallback callback, 
+                     void* userData = NULL, int cnt = 0);
+    
+    // ========================================================================
+    // Combined Requests
+    // ========================================================================
+    
+    /**
+     * @brief Get current weather, air quality and forecast in one call
+     * 
+     * The three parts are requested concurrently (see setMaxConcurrency(),
+     * with 1 they share one keep-alive connection), so a refresh takes
+     * about as long as the slowest part. Parts still valid in the cache
+     * are not requested: current weather and air quality use the same
+     * caches as getCurrentWeather() and getAirPollution(); the forecast
+     * is kept from the last call with the same snapshot, location and
+     * cnt. Each part reports its own status.
+     * 
+     * @param lat Latitude
+     * @param lon Longitude
+     * @param snapshot Snapshot to fill
+     * @param forecastCnt Number of forecast timestamps (optional, 0 for all)
+     * @return true if every part is OWM_STATUS_OK or OWM_STATUS_CACHED
+     */
+    bool getSnapshot(float lat, float lon, OWM_Snapshot* snapshot, int forecastCnt = 0);
+    
+    /**
+     * @brief Run a mixed list of requests concurrently
+     * 
+     * Like getCurrentWeatherBatch(), but every entry may be current
+     * weather, air quality or forecast for its own location. Current
+     * weather and air quality are served from the cache when possible.
+     * Geocoding entries are not supported and get OWM_STATUS_CANCELLED.
+     * 
+     * @param requests Requests; status is set for every entry
+     * @param count Number of requests
+     * @return Number of entries with OWM_STATUS_OK or OWM_STATUS_CACHED
+     */
+    int fetchRequests(OWM_Request* requests, size_t count);
+    
+    // ========================================================================
+    // Request Paths
+    // ========================================================================
+    
+    /*
+     * Build the request path (everything after the host) for an endpoint
+     * with the current units, language and API key. Public so they can be
+     * benchmarked and checked offline.
+     */
+    
+    /**
+     * @brief /data/2.5/weather path
+     */
+    void buildCurrentWeatherPath(float lat, float lon, char* path, size_t size);
+    
+    /**
+     * @brief /data/2.5/air_pollution path
+     */
+    void buildAirPollutionPath(float lat, float lon, char* path, size_t size);
+    
+    /**
+     * @brief /data/2.5/group path for the cities' ids
+     */
+    void buildGroupPath(const OWM_GeoLocation* cities, int count, char* path, size_t size);
+    
+    /**
+     * @brief /data/2.5/forecast path
+     * @param cnt Number of timestamps (0 for all)
+     */
+    void buildForecastPath(float lat, float lon, int cnt, char* path, size_t size);
+    
+    /**
+     * @brief /data/2.5/air_pollution/forecast path
+     */
+    void buildAirPollutionForecastPath(float lat, float lon, char* path, size_t size);
+    
+    /**
+     * @brief /data/2.5/air_pollution/history path
+     */
+    void buildAirPollutionHistoryPath(float lat, float lon, unsigned long startTime, 
+                                      unsigned long endTime, char* path, size_t size);
+    
+    // ========================================================================
+    // Response Parsing
+    // ========================================================================
+    
+    /*
+     * Parse a raw API response body with the parser selected for its
+     * endpoint. The get*() methods use these internally; they are public
+     * so recorded responses can be parsed and benchmarked offline.
+     */
+    
+    /**
+     * @brief Parse a /data/2.5/weather response
+     * @return true on success, false on error
+     */
+    bool parseCurrentWeather(const String& json, OWM_CurrentWeather* weather);
+    
+    /**
+     * @brief Parse a /data/2.5/group response (records in response order)
+     * @return Number of records, or -1 on error
+     */
+    int parseCurrentWeatherGroup(const String& json, OWM_CurrentWeather* list, int maxItems);
+    
+    /**
+     * @brief Parse a /data/2.5/forecast response
+     * @return true on success, false on error
+     */
+    bool parseForecast(const String& json, OWM_Forecast* forecast);
+    
+    /**
+     * @brief Parse the first record of an /data/2.5/air_pollution response
+     * @return true on success, false on error
+     */
+    bool parseAirPollution(const String& json, OWM_AirPollution* pollution);
+    
+    /**
+     * @brief Parse an air pollution forecast or history response
+     * @return Number of records, or -1 on error
+     */
+    int parseAirPollutionList(const String& json, OWM_AirPollution* list, int maxItems);
+    
+    /**
+     * @brief Parse a /geo/1.0/direct or /geo/1.0/reverse response
+     * @return Number of locations, or -1 on error
+     */
+    int parseGeoLocations(const String& json, OWM_GeoLocation* locations, int maxResults);
+    
+    /**
+     * @brief Parse a /geo/1.0/zip response
+     * @return true on success, false on error
+     */
+    bool parseGeoZip(const String& json, OWM_GeoLocation* location);
+    
     // ========================================================================
     // Utility Functions
     // ========================================================================
@@ -394,6 +955,64 @@ public:
      * @return Error message string
      */
     const char* getLastError() const;
+    
+    /**
+     * @brief Get the timing breakdown of the last request
+     * 
+     * After a concurrent call (getCurrentWeatherBatch(), getSnapshot(),
+     * ...) this is the request that completed last. Calling a parse*()
+     * method adds its time to parse and total.
+     * 
+     * @return Durations (microseconds) and byte counts
+     */
+    OWM_Timings getLastTimings() const;
+    
+    /**
+     * @brief Record heap and stack use of every request
+     * 
+     * Off by default: sampling the heap takes a lock on the ESP32 at
+     * every body chunk and JsonDocument allocation.
+     * 
+     * @param enable True to record, see getLastMemoryStats()
+     */
+    void setMemoryStats(bool enable);
+    
+    /**
+     * @brief Get the memory use of the last request
+     * 
+     * Covers the last call into the library: a get*() method with its
+     * requests and parsing, a whole concurrent call, or a single parse*()
+     * call. stackPeak counts from that method's frame down. A result
+     * struct on the caller's stack (8 KB for OWM_Forecast) is not part of it.
+     */
+    OWM_MemoryStats getLastMemoryStats() const;
+    
+    /**
+     * @brief Count every request in a metrics collector (see OWM_Metrics.h)
+     * @param metrics Collector, or NULL to stop collecting
+     */
+    void setMetrics(OWM_Metrics* metrics);
+    
+    /**
+     * @brief Record responses to a file or answer requests from one
+     * 
+     * See OWM_Recorder.h. While the recorder replays, no connection is
+     * made at all.
+     * 
+     * @param recorder Recorder, or NULL to use the network normally
+     */
+    void setRecorder(OWM_Recorder* recorder);
+    
+    /**
+     * @brief Report every step of every request to an observer
+     * 
+     * Events are only sent when the library is built with
+     * OWM_ENABLE_TRACING=1; otherwise the observer is never called.
+     * Events of concurrent requests interleave; group them by requestId.
+     * 
+     * @param observer Observer, or NULL to stop tracing
+     */
+    void setTraceObserver(OWM_TraceObserver* observer);
 
 private:
     char _apiKey[48];
@@ -401,44 +1020,205 @@ private:
     char _lang[8];
     bool _debug;
     bool _useHttps;
+    char _host[64];               // Server set with setServer(), empty for the default
+    uint16_t _port;               // Port set with setServer(), 0 for the default
     int _lastHttpCode;
     char _lastError[64];
     unsigned long _timeout;
+    long _bodyRemaining;      // Body (or current chunk) bytes still to read, -1 if unknown
+    bool _bodyChunked;        // Chunked transfer encoding
+    bool _keepAlive;          // Server keeps the connection open after this response
+    uint8_t _maxConcurrency;
+    uint8_t _parsers[OWM_ENDPOINT_COUNT];
+    bool _parallelParse;
+    OWM_Timings _timings;
+    OWM_Timings* _requestTimings; // Timings of the request being sent or read
+    OWM_Metrics* _metrics;
+    OWM_Recorder* _recorder;
+    bool _parseFailed;            // The current body failed to parse
+    bool _memoryStatsEnabled;
+    OWM_MemoryStats _memoryStats;
+    size_t _startFreeHeap;        // Free heap when the request started
+    uintptr_t _stackBase;         // Stack pointer at the public entry point, 0 outside
+    uint8_t _memoryDepth;         // Nested MemoryScopes
+    size_t _documentBytes;        // Memory held by JsonDocuments now
+    
+    // Allocator of every JsonDocument, so their memory can be counted
+    class DocumentAllocator : public ArduinoJson::Allocator {
+    public:
+        OpenWeatherMap* owner;
+        void* allocate(size_t size) override;
+        void deallocate(void* ptr) override;
+        void* reallocate(void* ptr, size_t newSize) override;
+    };
+    DocumentAllocator _documentAllocator;
+    
+    // Tracing state; present whether or not the hooks are compiled in
+    OWM_TraceObserver* _traceObserver;
+    uint32_t _traceId;            // Request the next events belong to
+    uint32_t _traceLastId;        // Last id handed out
+    uint32_t _traceBase;          // Id of index 0 of the running fan-out call
+    bool _traceOpen;              // _traceId was set but its request has not started yet
+    OWM_Endpoint _traceEndpoint;
+    
+    // Reports PARSE_START now and PARSE_END when it goes out of scope
+    class ParseTrace {
+    public:
+        ParseTrace(OpenWeatherMap* owner);
+        ~ParseTrace();
+    private:
+        OpenWeatherMap* _owner;
+    };
     
     // Cache variables
     unsigned long _cacheDuration;
-    unsigned long _lastWeatherTime;
     unsigned long _lastForecastTime;
     unsigned long _lastAirPollutionTime;
-    float _cachedLat;
-    float _cachedLon;
-    OWM_CurrentWeather _cachedWeather;
-    bool _hasCachedWeather;
+    struct WeatherCacheEntry {
+        float lat;
+        float lon;
+        unsigned long time;         // millis() when stored
+        uint32_t lastUsed;          // _weatherCacheTick of the last store or hit
+        bool used;
+        OWM_CurrentWeather weather;
+    };
+    WeatherCacheEntry _weatherCacheFirst;   // The default single entry
+    WeatherCacheEntry* _weatherCache;       // _weatherCacheSize entries
+    uint16_t _weatherCacheSize;
+    uint32_t _weatherCacheTick;
+    float _cachedAirLat;
+    float _cachedAirLon;
+    OWM_AirPollution _cachedAirPollution;
+    bool _hasCachedAirPollution;
+    
+    // DNS cache
+    struct DnsEntry {
+        char host[64];              // Empty for an unused entry
+        IPAddress address;
+        unsigned long resolvedAt;   // millis() of the lookup
+    };
+    DnsEntry _dns[OWM_DNS_CACHE_SIZE];
+    unsigned long _dnsTtl;
+    unsigned long _dnsFailedAt;     // millis() of the last failed lookup
+    bool _dnsFailed;
+    const OWM_Snapshot* _forecastOwner;   // Snapshot holding the last forecast
+    float _forecastLat;
+    float _forecastLon;
+    int _forecastCnt;
+    
+    // Streaming readers: called with the connection once headers are consumed
+    typedef bool (OpenWeatherMap::*BodyReader)(Client& body, void* context);
+    
+    // Fan-out requests: FanOutBegin builds the path of request index and
+    // returns the handler for its body (NULL to skip it); FanOutEnd gets
+    // the outcome and returns false to cancel the remaining requests
+    typedef OWM_JsonHandler* (OpenWeatherMap::*FanOutBegin)(int index, int slot, char* path, 
+                                                           size_t size, void* context);
+    typedef bool (OpenWeatherMap::*FanOutEnd)(int index, OWM_Status status, void* context);
     
     // HTTP methods
     bool httpGet(const char* host, const char* path, String& response);
-    bool parseHttpResponse(String& response);
+    bool httpGetStream(const char* host, const char* path, BodyReader reader, void* context);
+    bool performRequest(const char* host, const char* path, BodyReader reader, void* context, 
+                        OWM_Status* status);
+    bool httpGetParsed(const char* host, const char* path, OWM_JsonHandler* handler);
+    Client* openConnection(OWM_HttpConnection& connection, const char* host, 
+                           OWM_Timings* timings);
+    void sendRequest(Client& client, const char* host, const char* path, bool keepAlive);
+    bool readResponseHeaders(Client& client, OWM_Status* status);
+    int parseHeaderLine(char* line, size_t len, bool statusLine, bool continued);
+    bool readChunkHeader(Client& client);
+    int readBodyChunk(Client& client, char* buffer, size_t size);
+    bool readStringBody(Client& body, void* context);
+    bool readJsonBody(Client& body, void* context);
+    
+    // Cache helpers
+    bool readWeatherCache(float lat, float lon, OWM_CurrentWeather* weather);
+    void writeWeatherCache(float lat, float lon, const OWM_CurrentWeather* weather);
+    WeatherCacheEntry* findWeatherCache(float lat, float lon);
+    bool readAirPollutionCache(float lat, float lon, OWM_AirPollution* pollution);
+    void writeAirPollutionCache(float lat, float lon, const OWM_AirPollution* pollution);
+    
+    // DNS cache helpers
+    bool resolveHost(const char* host, IPAddress& address, OWM_Timings* timings);
+    bool lookupHost(const char* host, IPAddress& address);
+    DnsEntry* findDnsEntry(const char* host);
+    void forgetHost(const char* host);
+    
+    // Fan-out engine: up to _maxConcurrency requests on separate connections
+    int runFanOut(const char* host, int count, FanOutBegin begin, FanOutEnd end, void* context);
+    bool startSlot(OWM_FanOutSlot& slot, int slotNumber, int index, const char* host, 
+                   FanOutBegin begin, void* context);
+    bool pollSlot(OWM_FanOutSlot& slot, OWM_Status* status, bool* progressed);
+    void finishSlot(OWM_FanOutSlot& slot, OWM_Status status);
+    int readSlotBody(OWM_FanOutSlot& slot, char* buffer, size_t size);
+    bool readSlotLine(OWM_FanOutSlot& slot);
+    
+    // Batch helpers
+    OWM_JsonHandler* beginBatchWeather(int index, int slot, char* path, size_t size, void* context);
+    bool endBatchWeather(int index, OWM_Status status, void* context);
+    OWM_JsonHandler* beginSnapshotPart(int index, int slot, char* path, size_t size, void* context);
+    bool endSnapshotPart(int index, OWM_Status status, void* context);
+    OWM_JsonHandler* beginRequest(int index, int slot, char* path, size_t size, void* context);
+    bool endRequest(int index, OWM_Status status, void* context);
+    
+    // Fetch and parse with the parser selected for the endpoint
+    int fetchGeoLocations(const char* path, OWM_GeoLocation* results, int maxResults);
+    int fetchAirPollutionList(const char* path, OWM_AirPollution* list, int maxItems);
+    int fetchCurrentWeatherGroup(const char* path, OWM_CurrentWeather* list, int maxItems);
+    
+    // Server selected with setServer() or the default hosts
+    const char* apiHost() const;
+    const char* geoHost() const;
     
     // URL building helpers
     void buildUnitsParam(char* buffer, size_t size);
     void buildLangParam(char* buffer, size_t size);
     
     // JSON parsing helpers
-    bool parseCurrentWeather(const String& json, OWM_CurrentWeather* weather);
-    bool parseForecast(const String& json, OWM_Forecast* forecast);
-    bool parseAirPollution(const String& json, OWM_AirPollution* pollution);
-    int parseAirPollutionList(const String& json, OWM_AirPollution* list, int maxItems);
-    int parseGeoLocations(const String& json, OWM_GeoLocation* locations, int maxResults);
-    bool parseGeoZip(const String& json, OWM_GeoLocation* location);
+    bool runParser(const String& json, OWM_JsonHandler* handler);
+    
+    // Streaming JSON helpers
+    int streamJsonList(Client& body, OWM_ListItemHandler& items, OWM_Endpoint endpoint);
+    int readJsonItems(Stream& body, OWM_ListItemHandler& items);
+    int nextJsonChar(Stream& body);
+    bool readForecastStream(Client& body, void* context);
+    int streamAirPollution(const char* path, OWM_AirPollutionCallback callback, void* userData);
+    bool readAirPollutionStream(Client& body, void* context);
+    
+    void parseForecastItem(JsonObject& item, OWM_ForecastItem* fi);
+    void parseAirPollutionItem(JsonObject& item, OWM_AirPollution* pollution);
+    
+    // Metrics helpers
+    void recordRequest(OWM_Endpoint endpoint, OWM_Status status, const OWM_Timings* timings);
+    bool recordParsed(OWM_Endpoint endpoint, bool parsed);
+    void recordCacheHit(OWM_Endpoint endpoint);
+    
+    // Tracing helpers (defined only with OWM_ENABLE_TRACING)
+    void trace(OWM_TraceEventType type, const char* message = NULL, 
+               OWM_Status status = OWM_STATUS_OK);
+    void traceCacheLookup(OWM_Endpoint endpoint, bool hit);
+    void traceRequestStart(OWM_Endpoint endpoint);
+    uint32_t reserveTraceIds(int count);
+    
+    // Memory statistics helpers
+    void beginMemoryStats(uintptr_t stackBase);
+    void sampleMemory();
     
-    void parseWeatherCondition(JsonObject& obj, OWM_WeatherCondition* condition);
-    void parseMainData(JsonObject& obj, OWM_MainData* main);
-    void parseWindData(JsonObject& obj, OWM_WindData* wind);
-    void parseAirComponents(JsonObject& obj, OWM_AirComponents* components);
+    // Starts the memory statistics at the public method it is declared
+    // in, unless it is called from another one
+    class MemoryScope {
+    public:
+        MemoryScope(OpenWeatherMap* owner);
+        ~MemoryScope();
+    private:
+        OpenWeatherMap* _owner;
+    };
     
     void debugPrint(const char* message);
     void debugPrintln(const char* message);
     void setError(const char* error);
+    void setParseError();
 };
 
 #endif // OPENWEATHERMAP_H